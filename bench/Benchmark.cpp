@@ -0,0 +1,72 @@
+#include "bench/Benchmark.h"
+#include "common/Utility/Text/JSON.h"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+
+volatile uint64_t BenchmarkSuite::sink = 0;
+
+BenchmarkSuite::BenchmarkSuite(double inputMinimumSeconds):
+    minimumSeconds(inputMinimumSeconds)
+{
+}
+
+BenchmarkResult BenchmarkSuite::RunMicro(const std::string& name, std::function<void(uint64_t)> operation, double raysPerOperation)
+{
+    // Warm up caches and lazily initialized state.
+    operation(1);
+
+    BenchmarkResult result;
+    result.name = name;
+    result.category = "micro";
+    for (uint64_t iterations = 1; ; iterations *= 2) {
+        const auto startTime = std::chrono::high_resolution_clock::now();
+        operation(iterations);
+        const double elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+        if (elapsed >= minimumSeconds || iterations >= (uint64_t(1) << 40)) {
+            result.operations = iterations;
+            result.seconds = elapsed;
+            break;
+        }
+    }
+
+    result.nanosecondsPerOperation = result.seconds * 1e9 / result.operations;
+    result.raysPerSecond = (result.seconds > 0.0) ? raysPerOperation * result.operations / result.seconds : 0.0;
+    AddResult(result);
+    return result;
+}
+
+void BenchmarkSuite::AddResult(const BenchmarkResult& result)
+{
+    results.push_back(result);
+    std::cout << std::left << std::setw(48) << result.name << std::right << std::setw(14) << std::fixed << std::setprecision(1)
+              << result.nanosecondsPerOperation << " ns/op";
+    if (result.raysPerSecond > 0.0) {
+        std::cout << std::setw(16) << std::setprecision(0) << result.raysPerSecond << " rays/s";
+    }
+    std::cout << std::defaultfloat << std::endl;
+}
+
+bool BenchmarkSuite::WriteJSON(const std::string& filename) const
+{
+    std::ofstream output(filename);
+    if (!output) {
+        std::cerr << "ERROR: Failed to open benchmark output " << filename << std::endl;
+        return false;
+    }
+
+    output << std::setprecision(10) << "{\n  \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchmarkResult& result = results[i];
+        output << (i ? "," : "") << "\n    {\"name\": \"" << JSON::Escape(result.name) << "\", \"category\": \"" << result.category
+               << "\", \"operations\": " << result.operations << ", \"seconds\": " << result.seconds
+               << ", \"ns_per_op\": " << result.nanosecondsPerOperation << ", \"rays_per_second\": " << result.raysPerSecond
+               << ", \"parameters\": {";
+        for (size_t p = 0; p < result.parameters.size(); ++p) {
+            output << (p ? ", " : "") << "\"" << JSON::Escape(result.parameters[p].first) << "\": \"" << JSON::Escape(result.parameters[p].second) << "\"";
+        }
+        output << "}}";
+    }
+    output << "\n  ]\n}\n";
+    return static_cast<bool>(output);
+}
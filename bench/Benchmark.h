@@ -0,0 +1,36 @@
+#pragma once
+
+#include "common/common.h"
+
+struct BenchmarkResult
+{
+    BenchmarkResult() : operations(0), seconds(0.0), nanosecondsPerOperation(0.0), raysPerSecond(0.0) {}
+
+    std::string name;
+    std::string category;
+    uint64_t operations;
+    double seconds;
+    double nanosecondsPerOperation;
+    // Zero for benchmarks that do not trace rays.
+    double raysPerSecond;
+    std::vector<std::pair<std::string, std::string>> parameters;
+};
+
+class BenchmarkSuite
+{
+public:
+    BenchmarkSuite(double inputMinimumSeconds);
+
+    // Runs the operation in batches of doubling size until a single batch takes at least the minimum time.
+    // The operation receives the number of iterations to perform.
+    BenchmarkResult RunMicro(const std::string& name, std::function<void(uint64_t)> operation, double raysPerOperation = 0.0);
+    void AddResult(const BenchmarkResult& result);
+
+    bool WriteJSON(const std::string& filename) const;
+
+    // Results are accumulated here to keep the compiler from optimizing benchmark bodies away.
+    static volatile uint64_t sink;
+private:
+    double minimumSeconds;
+    std::vector<BenchmarkResult> results;
+};
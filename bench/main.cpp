@@ -0,0 +1,384 @@
+#include "bench/Benchmark.h"
+#include "common/RayTracer.h"
+#include "common/core.h"
+#include "common/Utility/Scene/Generation/SceneGenerator.h"
+#include "common/Scene/Geometry/Primitives/Triangle/Triangle.h"
+#include "common/Scene/Geometry/Simple/Box/Box.h"
+#include "common/Intersection/IntersectionState.h"
+#include "common/Utility/Math/FastMath.h"
+#include <cstring>
+#include <random>
+#include <thread>
+
+namespace
+{
+// Rays starting on a sphere around the box and aimed at random points inside it, so roughly all of them
+// reach the box and a realistic fraction hit the geometry inside.
+std::vector<Ray> GenerateRaysTowardBox(const Box& box, size_t count, unsigned int seed)
+{
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    std::normal_distribution<float> normal;
+
+    const glm::vec3 center = box.Center();
+    const float radius = glm::length(box.maxVertex - box.minVertex);
+    std::vector<Ray> rays;
+    rays.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const glm::vec3 origin = center + radius * glm::normalize(glm::vec3(normal(generator), normal(generator), normal(generator)));
+        const glm::vec3 target = glm::mix(box.minVertex, box.maxVertex, glm::vec3(unit(generator), unit(generator), unit(generator)));
+        rays.emplace_back(origin, target - origin);
+    }
+    return rays;
+}
+
+void RunTriangleBenchmark(BenchmarkSuite& suite)
+{
+    MeshObject mesh;
+    Triangle triangle(&mesh);
+    triangle.SetVertexPosition(0, glm::vec3(-1.f, -1.f, 0.f));
+    triangle.SetVertexPosition(1, glm::vec3(1.f, -1.f, 0.f));
+    triangle.SetVertexPosition(2, glm::vec3(0.f, 1.f, 0.f));
+    triangle.Finalize();
+
+    const SceneObject parent;
+    std::vector<Ray> rays = GenerateRaysTowardBox(Box(glm::vec3(-1.5f, -1.5f, -0.5f), glm::vec3(1.5f, 1.5f, 0.5f)), 4096, 1);
+    IntersectionState state;
+    suite.RunMicro("Triangle::Trace", [&](uint64_t iterations) {
+        uint64_t hits = 0;
+        for (uint64_t i = 0; i < iterations; ++i) {
+            state.intersectionT = std::numeric_limits<float>::max();
+            hits += triangle.Trace(&parent, &rays[i % rays.size()], &state);
+        }
+        BenchmarkSuite::sink += hits;
+    }, 1.0);
+}
+
+void RunBoxBenchmark(BenchmarkSuite& suite)
+{
+    const Box box(glm::vec3(-1.f), glm::vec3(1.f));
+    std::vector<Ray> rays = GenerateRaysTowardBox(Box(glm::vec3(-2.f), glm::vec3(2.f)), 4096, 2);
+    IntersectionState state;
+    suite.RunMicro("Box::Trace", [&](uint64_t iterations) {
+        uint64_t hits = 0;
+        for (uint64_t i = 0; i < iterations; ++i) {
+            state.intersectionT = std::numeric_limits<float>::max();
+            hits += box.Trace(nullptr, &rays[i % rays.size()], &state);
+        }
+        BenchmarkSuite::sink += hits;
+    }, 1.0);
+}
+
+void RunTextureBenchmark(BenchmarkSuite& suite)
+{
+    const int size = 2048;
+    std::mt19937 generator(3);
+    unsigned char* data = new unsigned char[size * size * 4];
+    for (int i = 0; i < size * size * 4; ++i) {
+        data[i] = static_cast<unsigned char>(generator());
+    }
+    Texture2D texture(data, size, size);
+
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    std::vector<glm::vec2> coordinates(1 << 16);
+    for (size_t i = 0; i < coordinates.size(); ++i) {
+        coordinates[i] = glm::vec2(unit(generator), unit(generator));
+    }
+
+    suite.RunMicro("Texture2D::Sample", [&](uint64_t iterations) {
+        glm::vec4 total;
+        for (uint64_t i = 0; i < iterations; ++i) {
+            total += texture.Sample(coordinates[i & (coordinates.size() - 1)]);
+        }
+        BenchmarkSuite::sink += static_cast<uint64_t>(total.x + total.y + total.z + total.w);
+    });
+
+    // A footprint of about 4 texels blends the first two mip levels.
+    const glm::vec2 dUVdx(4.f / size, 0.f);
+    const glm::vec2 dUVdy(0.f, 3.f / size);
+    suite.RunMicro("Texture2D::SampleGrad", [&](uint64_t iterations) {
+        glm::vec4 total;
+        for (uint64_t i = 0; i < iterations; ++i) {
+            total += texture.SampleGrad(coordinates[i & (coordinates.size() - 1)], dUVdx, dUVdy);
+        }
+        BenchmarkSuite::sink += static_cast<uint64_t>(total.x + total.y + total.z + total.w);
+    });
+
+    // Batches of 256 lookups through the base class, as a shading batch would make them.
+    const Texture& baseTexture = texture;
+    const size_t batchSize = 256;
+    std::vector<glm::vec4> batchOutput(batchSize);
+    std::vector<glm::vec2> batchDUVdx(batchSize, dUVdx);
+    std::vector<glm::vec2> batchDUVdy(batchSize, dUVdy);
+    suite.RunMicro("Texture2D::SampleBatch", [&](uint64_t iterations) {
+        float total = 0.f;
+        for (uint64_t i = 0; i < iterations; i += batchSize) {
+            baseTexture.SampleBatch(&coordinates[i & (coordinates.size() - 1)], batchOutput.data(), batchSize);
+            total += batchOutput[0].x;
+        }
+        BenchmarkSuite::sink += static_cast<uint64_t>(total);
+    });
+    suite.RunMicro("Texture2D::SampleGradBatch", [&](uint64_t iterations) {
+        float total = 0.f;
+        for (uint64_t i = 0; i < iterations; i += batchSize) {
+            baseTexture.SampleGradBatch(&coordinates[i & (coordinates.size() - 1)], batchDUVdx.data(), batchDUVdy.data(), batchOutput.data(), batchSize);
+            total += batchOutput[0].x;
+        }
+        BenchmarkSuite::sink += static_cast<uint64_t>(total);
+    });
+
+    // The same lookups on the compact formats, mostly to see the cost of decoding.
+    const TextureFormat formats[] = { TextureFormat::R8, TextureFormat::RG8, TextureFormat::RGB8, TextureFormat::RGBA16F, TextureFormat::BC1 };
+    for (TextureFormat format : formats) {
+        unsigned char* formatData = new unsigned char[size * size * 4];
+        for (int i = 0; i < size * size * 4; ++i) {
+            formatData[i] = static_cast<unsigned char>(generator());
+        }
+        const Texture2D formatTexture(formatData, size, size, format);
+        const std::string formatName = TextureFormats::GetFormatName(format);
+        suite.RunMicro("Texture2D::Sample[" + formatName + "]", [&](uint64_t iterations) {
+            glm::vec4 total;
+            for (uint64_t i = 0; i < iterations; ++i) {
+                total += formatTexture.Sample(coordinates[i & (coordinates.size() - 1)]);
+            }
+            BenchmarkSuite::sink += static_cast<uint64_t>(total.x + total.y + total.z + total.w);
+        });
+    }
+}
+
+// libm against the FastMath approximations over arrays, where the approximations vectorize.
+void RunMathBenchmark(BenchmarkSuite& suite)
+{
+    std::mt19937 generator(4);
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    std::vector<float> inputs(4096);
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        inputs[i] = unit(generator);
+    }
+    std::vector<float> outputs(inputs.size());
+
+    auto runMath = [&](const std::string& name, std::function<void(const float*, float*, size_t)> function) {
+        suite.RunMicro(name, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i += inputs.size()) {
+                function(inputs.data(), outputs.data(), inputs.size());
+            }
+            BenchmarkSuite::sink += static_cast<uint64_t>(outputs[0] * 1000.f);
+        });
+    };
+    runMath("expf", [](const float* x, float* y, size_t count) {
+        for (size_t i = 0; i < count; ++i) y[i] = expf(-4.f * x[i]);
+    });
+    runMath("FastMath::Exp (HIGH)", [](const float* x, float* y, size_t count) {
+        for (size_t i = 0; i < count; ++i) y[i] = FastMath::Exp<FastMath::Accuracy::HIGH>(-4.f * x[i]);
+    });
+    runMath("FastMath::Exp (LOW)", [](const float* x, float* y, size_t count) {
+        for (size_t i = 0; i < count; ++i) y[i] = FastMath::Exp<FastMath::Accuracy::LOW>(-4.f * x[i]);
+    });
+    runMath("powf", [](const float* x, float* y, size_t count) {
+        for (size_t i = 0; i < count; ++i) y[i] = powf(x[i], 0.6f);
+    });
+    runMath("FastMath::Pow (HIGH)", [](const float* x, float* y, size_t count) {
+        for (size_t i = 0; i < count; ++i) y[i] = FastMath::Pow<FastMath::Accuracy::HIGH>(x[i], 0.6f);
+    });
+    runMath("powf (integer)", [](const float* x, float* y, size_t count) {
+        for (size_t i = 0; i < count; ++i) y[i] = powf(x[i], 15.f);
+    });
+    runMath("FastMath::IntPow", [](const float* x, float* y, size_t count) {
+        for (size_t i = 0; i < count; ++i) y[i] = FastMath::IntPow<15>(x[i]);
+    });
+    runMath("atan2f", [](const float* x, float* y, size_t count) {
+        for (size_t i = 0; i < count; ++i) y[i] = atan2f(x[i] - 0.5f, x[count - 1 - i] - 0.5f);
+    });
+    runMath("FastMath::Atan2 (HIGH)", [](const float* x, float* y, size_t count) {
+        for (size_t i = 0; i < count; ++i) y[i] = FastMath::Atan2<FastMath::Accuracy::HIGH>(x[i] - 0.5f, x[count - 1 - i] - 0.5f);
+    });
+}
+
+void RunMeshBenchmark(BenchmarkSuite& suite, const std::string& name, const std::string& filename)
+{
+    std::vector<std::shared_ptr<MeshObject>> meshes = MeshLoader::LoadMesh(filename);
+    if (meshes.empty()) {
+        std::cerr << "WARNING: Skipping " << name << " benchmarks, failed to load " << filename << std::endl;
+        return;
+    }
+
+    std::shared_ptr<BlinnPhongMaterial> material = std::make_shared<BlinnPhongMaterial>();
+    std::shared_ptr<SceneObject> object = std::make_shared<SceneObject>();
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        meshes[i]->SetMaterial(material);
+        object->AddMeshObject(meshes[i]);
+    }
+
+    // Meshes are only rebuilt on Finalize after their acceleration data is recreated.
+    suite.RunMicro("BVH Build (" + name + ")", [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            object->CreateAccelerationData(AccelerationTypes::BVH);
+            object->Finalize();
+        }
+    });
+
+    Scene scene;
+    scene.AddSceneObject(object);
+    scene.GenerateAccelerationData(AccelerationTypes::BVH);
+    scene.Finalize();
+
+    std::vector<Ray> rays = GenerateRaysTowardBox(object->GetBoundingBox(), 1 << 14, 4);
+    suite.RunMicro("BVH Traversal (" + name + ")", [&](uint64_t iterations) {
+        uint64_t hits = 0;
+        for (uint64_t i = 0; i < iterations; ++i) {
+            // Tracing marks missed objects on the ray, so every trace needs a fresh copy.
+            Ray ray = rays[i % rays.size()];
+            IntersectionState state(0, 0);
+            hits += scene.Trace(&ray, &state);
+        }
+        BenchmarkSuite::sink += hits;
+    }, 1.0);
+}
+
+BenchmarkResult MakeFrameResult(const std::string& name, const std::string& category, const RayTracer& rayTracer, glm::ivec2 resolution, uint64_t rays)
+{
+    BenchmarkResult result;
+    result.name = name;
+    result.category = category;
+    result.operations = static_cast<uint64_t>(resolution.x) * resolution.y;
+    result.seconds = rayTracer.GetLastRenderSeconds();
+    result.nanosecondsPerOperation = result.seconds * 1e9 / result.operations;
+    result.raysPerSecond = (result.seconds > 0.0) ? rays / result.seconds : 0.0;
+    result.parameters.emplace_back("width", std::to_string(resolution.x));
+    result.parameters.emplace_back("height", std::to_string(resolution.y));
+    return result;
+}
+
+uint64_t RenderCountingRays(RayTracer& rayTracer)
+{
+    const uint64_t startRays = Diagnostics::Get()->GetTotalStat(DiagnosticsType::RAYS_CREATED);
+    rayTracer.Render();
+    return Diagnostics::Get()->GetTotalStat(DiagnosticsType::RAYS_CREATED) - startRays;
+}
+
+void RunFrameBenchmarks(BenchmarkSuite& suite)
+{
+    const int hardwareThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    std::vector<int> threadCounts = { 1 };
+    if (hardwareThreads >= 2) {
+        threadCounts.push_back(2);
+    }
+    if (hardwareThreads > 2) {
+        threadCounts.push_back(hardwareThreads);
+    }
+    const std::vector<glm::ivec2> resolutions = { glm::ivec2(240, 135), glm::ivec2(480, 270), glm::ivec2(960, 540) };
+
+    RayTracer rayTracer;
+    rayTracer.SetOutputFilename("raytracer_bench.png");
+    rayTracer.Initialize();
+    for (const glm::ivec2& resolution : resolutions) {
+        for (int threads : threadCounts) {
+            rayTracer.SetResolution(resolution.x, resolution.y);
+            rayTracer.SetThreadCount(threads);
+
+            const uint64_t rays = RenderCountingRays(rayTracer);
+            BenchmarkResult result = MakeFrameResult("Frame " + std::to_string(resolution.x) + "x" + std::to_string(resolution.y) + " (" + std::to_string(threads) + " threads)",
+                "macro", rayTracer, resolution, rays);
+            result.parameters.emplace_back("threads", std::to_string(threads));
+            suite.AddResult(result);
+        }
+    }
+}
+
+// Build and trace time of generated scenes as the triangle count doubles, for every distribution.
+void RunScalingBenchmarks(BenchmarkSuite& suite, uint64_t maximumTriangles)
+{
+    const glm::ivec2 resolution(480, 270);
+    const SceneGenerator::Distribution distributions[] = {
+        SceneGenerator::Distribution::UNIFORM_CLUTTER, SceneGenerator::Distribution::THIN_TRUSSES, SceneGenerator::Distribution::INSTANCED
+    };
+
+    RayTracer rayTracer;
+    rayTracer.SetResolution(resolution.x, resolution.y);
+    rayTracer.SetOutputFilename("raytracer_bench_scaling.png");
+    for (SceneGenerator::Distribution distribution : distributions) {
+        for (uint64_t triangles = 1 << 17; triangles <= maximumTriangles; triangles *= 2) {
+            SceneGenerator::Settings settings;
+            settings.distribution = distribution;
+            settings.totalTriangles = triangles;
+            const std::string suffix = " (" + SceneGenerator::GetDistributionName(distribution) + ", " + std::to_string(triangles) + " triangles)";
+
+            std::shared_ptr<Scene> scene = SceneGenerator::GenerateScene(settings);
+            const auto buildStartTime = std::chrono::high_resolution_clock::now();
+            scene->Finalize();
+            BenchmarkResult build;
+            build.name = "Scene Build" + suffix;
+            build.category = "scaling";
+            build.operations = triangles;
+            build.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - buildStartTime).count();
+            build.nanosecondsPerOperation = build.seconds * 1e9 / build.operations;
+            build.raysPerSecond = 0.0;
+            build.parameters.emplace_back("distribution", SceneGenerator::GetDistributionName(distribution));
+            build.parameters.emplace_back("triangles", std::to_string(triangles));
+            suite.AddResult(build);
+
+            rayTracer.SetScene(scene, SceneGenerator::GetSceneDescription(settings));
+            rayTracer.Initialize();
+            const uint64_t rays = RenderCountingRays(rayTracer);
+            BenchmarkResult trace = MakeFrameResult("Scene Trace" + suffix, "scaling", rayTracer, resolution, rays);
+            trace.parameters.emplace_back("distribution", SceneGenerator::GetDistributionName(distribution));
+            trace.parameters.emplace_back("triangles", std::to_string(triangles));
+            suite.AddResult(trace);
+        }
+    }
+}
+}
+
+int main(int argc, char** argv)
+{
+    bool runMicro = false;
+    bool runMacro = false;
+    bool runScaling = false;
+    uint64_t maximumTriangles = 1 << 20;
+    double minimumSeconds = 0.5;
+    std::string outputFilename = "raytracer_bench.json";
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--micro")) {
+            runMicro = true;
+        } else if (!strcmp(argv[i], "--macro")) {
+            runMacro = true;
+        } else if (!strcmp(argv[i], "--scaling")) {
+            runScaling = true;
+        } else if (!strcmp(argv[i], "--max-triangles") && i + 1 < argc) {
+            maximumTriangles = strtoull(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--min-time") && i + 1 < argc) {
+            minimumSeconds = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--output") && i + 1 < argc) {
+            outputFilename = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--micro] [--macro] [--scaling [--max-triangles N]] [--min-time seconds] [--output results.json]" << std::endl;
+            return 1;
+        }
+    }
+
+    // Without a selection, run the micro and frame benchmarks. Scaling runs take much longer and are opt-in.
+    if (!runMicro && !runMacro && !runScaling) {
+        runMicro = runMacro = true;
+    }
+
+    BenchmarkSuite suite(minimumSeconds);
+    if (runMicro) {
+        RunTriangleBenchmark(suite);
+        RunBoxBenchmark(suite);
+        RunTextureBenchmark(suite);
+        RunMathBenchmark(suite);
+        RunMeshBenchmark(suite, "ISS", "iss/ISSComplete.fbx");
+        RunMeshBenchmark(suite, "Soyuz", "soyuz/soyuz.obj");
+    }
+
+    if (runMacro) {
+        RunFrameBenchmarks(suite);
+    }
+
+    if (runScaling) {
+        RunScalingBenchmarks(suite, maximumTriangles);
+    }
+
+    return suite.WriteJSON(outputFilename) ? 0 : 1;
+}
@@ -15,6 +15,8 @@ bool BVHAcceleration::Trace(const SceneObject* parentObject, Ray* inputRay, Inte
 
 void BVHAcceleration::InternalInitialization()
 {
+    PROFILE_ZONE(zone, "BVH Build");
+    DIAGNOSTICS_PHASE(phase, DiagnosticsPhase::BVH_BUILD);
 #if !DISABLE_ACCELERATION_CREATION_TIMER
     DIAGNOSTICS_TIMER(timer, "BVH Creation Time");
 #endif
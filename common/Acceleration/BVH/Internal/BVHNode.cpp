@@ -50,6 +50,7 @@ void BVHNode::CreateParentNode(std::vector<std::shared_ptr<class AccelerationNod
 
 bool BVHNode::Trace(const class SceneObject* parentObject, class Ray* inputRay, struct IntersectionState* outputIntersection) const
 {
+    DIAGNOSTICS_STAT(DiagnosticsType::NODES_VISITED);
     float previousIntersectionT = outputIntersection ? outputIntersection->intersectionT : 0.f;
     if (!boundingBox.Trace(parentObject, inputRay, outputIntersection)) {
         if (outputIntersection) {
@@ -99,6 +99,7 @@ bool VoxelGrid::Trace(const SceneObject* parentObject, Ray* inputRay, Intersecti
 #if DEBUG_VOXEL_GRID
         std::cout << "Trace Voxel: " << glm::to_string(currentVoxelIndex) << std::endl;
 #endif
+        DIAGNOSTICS_STAT(DiagnosticsType::NODES_VISITED);
         IntersectionState tempIntersection;
         tempIntersection.TestAndCopyLimits(outputIntersection);
         bool hitVoxel = grid[currentVoxelIndex[0]][currentVoxelIndex[1]][currentVoxelIndex[2]].Trace(parentObject, inputRay, &tempIntersection);
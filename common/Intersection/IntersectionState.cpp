@@ -1,5 +1,6 @@
 #include "common/Intersection/IntersectionState.h"
 #include "common/Scene/Geometry/Primitives/PrimitiveBase.h"
+#include "common/Rendering/Textures/Texture.h"
 
 glm::vec3 IntersectionState::ComputeNormal() const
 {
@@ -8,6 +9,10 @@ glm::vec3 IntersectionState::ComputeNormal() const
 
     const glm::mat3 normalTransform = glm::mat3(glm::transpose(glm::inverse(primitiveParent->GetObjectToWorldMatrix())));
 
+    if (intersectedPrimitive->HasSurfaceParametrization()) {
+        return glm::normalize(normalTransform * intersectedPrimitive->GetSurfaceNormal(ComputeObjectPosition()));
+    }
+
     if (intersectedPrimitive->HasVertexNormals()) {
         // If the mesh has normals, linearly interpolate the normals to get the normal to use.
         glm::vec3 retNormal;
@@ -30,14 +35,90 @@ glm::vec3 IntersectionState::ComputeNormal() const
     return glm::normalize(normalTransform * intersectedPrimitive->GetPrimitiveNormal());
 }
 
+glm::vec3 IntersectionState::ComputeObjectPosition() const
+{
+    assert(hasIntersection && primitiveParent);
+    return glm::vec3(primitiveParent->GetWorldToObjectMatrix() * glm::vec4(intersectionRay.GetRayPosition(intersectionT), 1.f));
+}
+
 glm::vec2 IntersectionState::ComputeUV() const
 {
     assert(hasIntersection && intersectedPrimitive && primitiveParent);
     assert(primitiveIntersectionWeights.size() == static_cast<size_t>(intersectedPrimitive->GetTotalVertices()));
 
+    if (intersectedPrimitive->HasSurfaceParametrization()) {
+        return intersectedPrimitive->GetSurfaceUV(ComputeObjectPosition());
+    }
+
     glm::vec2 retUV;
     for (int i = 0; i < intersectedPrimitive->GetTotalVertices(); ++i) {
         retUV += primitiveIntersectionWeights[i] * intersectedPrimitive->GetVertexUV(i);
     }
     return retUV;
-}
\ No newline at end of file
+}
+
+bool IntersectionState::ComputeUVDifferentials(glm::vec2& dUVdx, glm::vec2& dUVdy) const
+{
+    assert(hasIntersection && intersectedPrimitive && primitiveParent);
+    if (!intersectionRay.HasDifferentials()) {
+        return false;
+    }
+
+    if (intersectedPrimitive->HasSurfaceParametrization()) {
+        // Difference the uv at the offset points on the tangent plane, the shorter way around in u.
+        const RayDifferential surface = intersectionRay.TransferDifferentials(intersectionT, ComputeNormal());
+        const glm::mat4 worldToObject = primitiveParent->GetWorldToObjectMatrix();
+        const glm::vec3 objectPosition = ComputeObjectPosition();
+        const glm::vec2 uv = intersectedPrimitive->GetSurfaceUV(objectPosition);
+        auto uvOffset = [&](const glm::vec3& offset) {
+            glm::vec2 result = intersectedPrimitive->GetSurfaceUV(objectPosition + glm::vec3(worldToObject * glm::vec4(offset, 0.f))) - uv;
+            result.x -= roundf(result.x);
+            return result;
+        };
+        dUVdx = uvOffset(surface.dPdx);
+        dUVdy = uvOffset(surface.dPdy);
+        return true;
+    }
+
+    if (intersectedPrimitive->GetTotalVertices() != 3) {
+        return false;
+    }
+
+    const glm::mat4 objectToWorld = primitiveParent->GetObjectToWorldMatrix();
+    const glm::vec3 p0 = glm::vec3(objectToWorld * glm::vec4(intersectedPrimitive->GetVertexPosition(0), 1.f));
+    const glm::vec3 edge1 = glm::vec3(objectToWorld * glm::vec4(intersectedPrimitive->GetVertexPosition(1), 1.f)) - p0;
+    const glm::vec3 edge2 = glm::vec3(objectToWorld * glm::vec4(intersectedPrimitive->GetVertexPosition(2), 1.f)) - p0;
+    const glm::vec3 faceNormal = glm::cross(edge1, edge2);
+    if (glm::length2(faceNormal) < SMALL_EPSILON * SMALL_EPSILON) {
+        return false;
+    }
+    const RayDifferential surface = intersectionRay.TransferDifferentials(intersectionT, glm::normalize(faceNormal));
+
+    // Express the position offsets in terms of the two edges, i.e. as offsets of the barycentric weights.
+    const float e11 = glm::dot(edge1, edge1);
+    const float e12 = glm::dot(edge1, edge2);
+    const float e22 = glm::dot(edge2, edge2);
+    const float invDeterminant = 1.f / (e11 * e22 - e12 * e12);
+    auto barycentricOffset = [&](const glm::vec3& offset) {
+        const float d1 = glm::dot(edge1, offset);
+        const float d2 = glm::dot(edge2, offset);
+        return glm::vec2(e22 * d1 - e12 * d2, e11 * d2 - e12 * d1) * invDeterminant;
+    };
+
+    const glm::vec2 uv0 = intersectedPrimitive->GetVertexUV(0);
+    const glm::mat2 uvEdges(intersectedPrimitive->GetVertexUV(1) - uv0, intersectedPrimitive->GetVertexUV(2) - uv0);
+    dUVdx = uvEdges * barycentricOffset(surface.dPdx);
+    dUVdy = uvEdges * barycentricOffset(surface.dPdy);
+    return true;
+}
+
+glm::vec4 IntersectionState::SampleTexture(const Texture* texture) const
+{
+    assert(texture);
+    const glm::vec2 uv = ComputeUV();
+    glm::vec2 dUVdx, dUVdy;
+    if (ComputeUVDifferentials(dUVdx, dUVdy)) {
+        return texture->SampleGrad(uv, dUVdx, dUVdy);
+    }
+    return texture->Sample(uv);
+}
@@ -44,5 +44,14 @@ struct IntersectionState
 
     // Utility Functions
     glm::vec3 ComputeNormal() const;
+    // Hit point in the object space of the primitive's parent.
+    glm::vec3 ComputeObjectPosition() const;
     glm::vec2 ComputeUV() const;
+
+    // Screen-space derivatives of the UV at the hit, from the differentials of the intersection ray. Returns false
+    // when the ray carries no differentials.
+    bool ComputeUVDifferentials(glm::vec2& dUVdx, glm::vec2& dUVdy) const;
+
+    // Samples the texture at the hit UV, filtered over the pixel footprint when it is known.
+    glm::vec4 SampleTexture(const class Texture* texture) const;
 };
\ No newline at end of file
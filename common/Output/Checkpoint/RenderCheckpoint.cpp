@@ -0,0 +1,135 @@
+#include "common/Output/Checkpoint/RenderCheckpoint.h"
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+const char CHECKPOINT_MAGIC[8] = { 'S', 'T', 'C', 'K', 'P', 'T', '\0', '\0' };
+const uint32_t CHECKPOINT_VERSION = 2;
+
+// 64-bit FNV-1a.
+uint64_t HashString(const std::string& input)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : input) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+}
+
+RenderCheckpoint::RenderCheckpoint(const std::string& inputFilename, int inputWidth, int inputHeight, int inputTileSize, int inputLayerCount, uint32_t inputLayout, const std::string& settings, float inputFlushInterval):
+    filename(inputFilename), width(inputWidth), height(inputHeight), tileSize(inputTileSize),
+    tilesX((inputWidth + inputTileSize - 1) / inputTileSize), tilesY((inputHeight + inputTileSize - 1) / inputTileSize),
+    layerCount(inputLayerCount), layout(inputLayout), settingsHash(HashString(settings)), flushInterval(inputFlushInterval),
+    layers(nullptr), coverage(nullptr), doneTiles(nullptr), doneTilesOffset(0)
+{
+}
+
+bool RenderCheckpoint::Open(bool resume)
+{
+    const size_t pixelCount = static_cast<size_t>(width) * height;
+    const size_t layersOffset = sizeof(Header);
+    const size_t coverageOffset = layersOffset + layerCount * pixelCount * sizeof(glm::vec3);
+    doneTilesOffset = coverageOffset + pixelCount;
+    const size_t fileSize = doneTilesOffset + GetTileCount();
+
+    // Check the existing file before mapping it, which resizes it.
+    Header expected;
+    memset(&expected, 0, sizeof(expected));
+    memcpy(expected.magic, CHECKPOINT_MAGIC, sizeof(expected.magic));
+    expected.version = CHECKPOINT_VERSION;
+    expected.width = width;
+    expected.height = height;
+    expected.tileSize = tileSize;
+    expected.layerCount = layerCount;
+    expected.layout = layout;
+    expected.settingsHash = settingsHash;
+    bool keepTiles = false;
+    if (resume) {
+        MappedFile existing;
+        if (!existing.Open(filename)) {
+            std::cout << "No checkpoint " << filename << " to resume, starting over" << std::endl;
+        } else if (existing.GetSize() != fileSize || memcmp(existing.GetData(), &expected, sizeof(expected)) != 0) {
+            std::cout << "Checkpoint " << filename << " is for different settings, starting over" << std::endl;
+        } else {
+            keepTiles = true;
+        }
+    }
+
+    if (!file.OpenWritable(filename, fileSize)) {
+        std::cerr << "ERROR: Could not create checkpoint " << filename << std::endl;
+        return false;
+    }
+    unsigned char* data = file.GetWritableData();
+    layers = reinterpret_cast<glm::vec3*>(data + layersOffset);
+    coverage = data + coverageOffset;
+    doneTiles = data + doneTilesOffset;
+    if (!keepTiles) {
+        memset(doneTiles, 0, GetTileCount());
+        memcpy(data, &expected, sizeof(expected));
+        if (!file.Flush(0, fileSize)) {
+            std::cerr << "ERROR: Could not write checkpoint " << filename << std::endl;
+            file.Close();
+            return false;
+        }
+    }
+    lastFlushTime = std::chrono::steady_clock::now();
+    return true;
+}
+
+void RenderCheckpoint::Remove()
+{
+    {
+        std::lock_guard<std::mutex> lock(flushMutex);
+        pendingTiles.clear();
+    }
+    file.Close();
+    layers = nullptr;
+    coverage = doneTiles = nullptr;
+    std::remove(filename.c_str());
+}
+
+int RenderCheckpoint::GetDoneTileCount() const
+{
+    int count = 0;
+    for (int tile = 0; tile < GetTileCount(); ++tile) {
+        count += IsTileDone(tile);
+    }
+    return count;
+}
+
+void RenderCheckpoint::MarkTileDone(int tile)
+{
+    std::lock_guard<std::mutex> lock(flushMutex);
+    pendingTiles.push_back(tile);
+    if (std::chrono::steady_clock::now() - lastFlushTime >= flushInterval) {
+        FlushLocked();
+    }
+}
+
+bool RenderCheckpoint::Flush()
+{
+    std::lock_guard<std::mutex> lock(flushMutex);
+    return FlushLocked();
+}
+
+bool RenderCheckpoint::FlushLocked()
+{
+    lastFlushTime = std::chrono::steady_clock::now();
+    if (pendingTiles.empty()) {
+        return true;
+    }
+
+    // The pixels have to be on disk before the flags that say they are valid.
+    if (!file.Flush(0, doneTilesOffset)) {
+        std::cerr << "ERROR: Could not write checkpoint " << filename << std::endl;
+        return false;
+    }
+    for (int tile : pendingTiles) {
+        doneTiles[tile] = 1;
+    }
+    pendingTiles.clear();
+    return file.Flush(doneTilesOffset, GetTileCount());
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "common/common.h"
+#include "common/Utility/Texture/MappedFile.h"
+#include <chrono>
+#include <mutex>
+
+// Memory-mapped record of the tiles of a render finished so far, so a killed render can resume instead of starting
+// over. Each pixel holds layerCount colors, e.g. the image and its AOVs, and a coverage flag, written straight into
+// the mapping. A tile only counts as done once MarkTileDone has flushed its pixels to disk, which happens at most
+// every flushInterval seconds, so a crash loses at most that much work.
+class RenderCheckpoint
+{
+public:
+    // layout identifies what the layers hold, and settings what was rendered into them, e.g. the scene and the render
+    // settings; only its hash is stored. Only a checkpoint with the same size, tiles, layout and settings is resumed.
+    RenderCheckpoint(const std::string& filename, int width, int height, int tileSize, int layerCount, uint32_t layout, const std::string& settings, float flushInterval);
+
+    // Maps the file, keeping the tiles it already has done when resuming and starting over otherwise.
+    bool Open(bool resume);
+    // Deletes the file once the output it was for has been written.
+    void Remove();
+
+    int GetTileCount() const { return tilesX * tilesY; }
+    int GetDoneTileCount() const;
+    bool IsTileDone(int tile) const { return doneTiles[tile] != 0; }
+    // Call after all pixels of a tile have been set. Flushes the tiles marked so far if the interval has passed.
+    void MarkTileDone(int tile);
+    // Flushes the tiles marked so far.
+    bool Flush();
+
+    glm::vec3 GetPixel(int layer, int x, int y) const { return layers[static_cast<size_t>(layer) * width * height + y * width + x]; }
+    void SetPixel(int layer, int x, int y, const glm::vec3& value) { layers[static_cast<size_t>(layer) * width * height + y * width + x] = value; }
+    bool GetPixelCoverage(int x, int y) const { return coverage[y * width + x] != 0; }
+    void SetPixelCoverage(int x, int y, bool covered) { coverage[y * width + x] = covered; }
+
+private:
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        int32_t width;
+        int32_t height;
+        int32_t tileSize;
+        int32_t layerCount;
+        uint32_t layout;
+        uint64_t settingsHash;
+    };
+
+    bool FlushLocked();
+
+    std::string filename;
+    int width;
+    int height;
+    int tileSize;
+    int tilesX;
+    int tilesY;
+    int layerCount;
+    uint32_t layout;
+    uint64_t settingsHash;
+    std::chrono::duration<float> flushInterval;
+
+    MappedFile file;
+    // Pointers into the mapping, which has the header, then the layers one after another, the coverage and the done
+    // flag of each tile.
+    glm::vec3* layers;
+    uint8_t* coverage;
+    uint8_t* doneTiles;
+    size_t doneTilesOffset;
+
+    std::mutex flushMutex;
+    // Tiles marked done but not flushed yet.
+    std::vector<int> pendingTiles;
+    std::chrono::steady_clock::time_point lastFlushTime;
+};
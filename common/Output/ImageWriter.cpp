@@ -1,10 +1,16 @@
 #include "common/Output/ImageWriter.h"
+#include "common/Output/PostProcess/PostProcessStage.h"
+#include "common/Output/ToneMapping/ToneMapper.h"
+#include "common/Utility/Math/FastMath.h"
+#include "common/Utility/Threading/ThreadPool.h"
+#include <cstring>
 #include <locale>
+#include <fstream>
 
 using namespace std;
 
 // Ctor/Dtor
-ImageWriter::ImageWriter(std::string inFile, int inWidth, int inHeight) : mWidth(inWidth), mHeight(inHeight)
+ImageWriter::ImageWriter(std::string inFile, int inWidth, int inHeight) : mWidth(inWidth), mHeight(inHeight), mCoverage(inWidth * inHeight, 0), mSRGBEncoding(false), mCostData(nullptr)
 {
     // Initialize Free Image and get it ready to do stuff
     FreeImage_Initialise();
@@ -25,6 +31,7 @@ ImageWriter::ImageWriter(std::string inFile, int inWidth, int inHeight) : mWidth
 ImageWriter::~ImageWriter()
 {
     delete[] mHDRData;
+    delete[] mCostData;
     FreeImage_DeInitialise();
 }
 
@@ -40,14 +47,120 @@ void ImageWriter::SetPixelColor(glm::vec3 inColor, int inX, int inY)
     mHDRData[linearIdx] = inColor;
 }
 
-void ImageWriter::CopyHDRToBitmap()
+void ImageWriter::AddPostProcessStage(std::shared_ptr<PostProcessStage> stage)
 {
-    for (int x = 0; x < mWidth; ++x) {
-        for (int y = 0; y < mHeight; ++y) {
-            int linearIdx = y * mWidth + x;
-            SetFinalPixelColor(mHDRData[linearIdx], x, y);
+    assert(stage);
+    mPostProcessStages.push_back(stage);
+}
+
+void ImageWriter::ClearPostProcessStages()
+{
+    mPostProcessStages.clear();
+}
+
+void ImageWriter::SetPixelCoverage(bool covered, int inX, int inY)
+{
+    mCoverage[inY * mWidth + inX] = covered;
+}
+
+namespace
+{
+const int BAND_ROWS = 16;
+
+// Linear values are rounded to this many steps before the sRGB table lookup. The encoding rises by at most 12.92 / 255
+// per linear 1 / 255, so neighbouring entries are less than one 8-bit step apart.
+const int SRGB_TABLE_SIZE = 4096;
+
+const std::vector<BYTE>& GetSRGBTable()
+{
+    static const std::vector<BYTE> table = []() {
+        std::vector<BYTE> values(SRGB_TABLE_SIZE);
+        for (int i = 0; i < SRGB_TABLE_SIZE; ++i) {
+            const float linear = static_cast<float>(i) / (SRGB_TABLE_SIZE - 1);
+            const float encoded = (linear <= 0.0031308f) ? 12.92f * linear : 1.055f * std::pow(linear, 1.f / 2.4f) - 0.055f;
+            values[i] = static_cast<BYTE>(std::min(encoded * 255.f + 0.5f, 255.f));
+        }
+        return values;
+    }();
+    return table;
+}
+
+// Runs function(firstRow, endRow) over bands of the rows on the shared thread pool and waits for all of them.
+template <typename Function>
+void ForEachRowBand(int rows, Function function)
+{
+    std::vector<std::future<void>> bands;
+    for (int firstRow = 0; firstRow < rows; firstRow += BAND_ROWS) {
+        const int endRow = std::min(firstRow + BAND_ROWS, rows);
+        bands.push_back(ThreadPool::Get().Submit([=]() { function(firstRow, endRow); }));
+    }
+    for (auto& band : bands) {
+        band.get();
+    }
+}
+}
+
+void ImageWriter::ApplyPostProcess()
+{
+    PROFILE_ZONE(zone, "Post Process");
+    mPostProcessedData.assign(mHDRData, mHDRData + mWidth * mHeight);
+    ForEachRowBand(mHeight, [&](int firstRow, int endRow) {
+        for (const auto& stage : mPostProcessStages) {
+            stage->Apply(mWidth, mHeight, firstRow, endRow, &mPostProcessedData[firstRow * mWidth], &mCoverage[firstRow * mWidth]);
         }
+    });
+}
+
+void ImageWriter::SetToneMapper(std::shared_ptr<ToneMapper> toneMapper)
+{
+    mToneMapper = toneMapper;
+}
+
+void ImageWriter::SetSRGBEncoding(bool enabled)
+{
+    mSRGBEncoding = enabled;
+}
+
+void ImageWriter::CopyHDRToBitmap()
+{
+    PROFILE_ZONE(zone, "Copy HDR To Bitmap");
+    if (!m_pOutBitmap) {
+        return;
     }
+    static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "Rows are converted as flat arrays of floats");
+    const glm::vec3* source = GetFinalHDRData();
+    const int rowValues = 3 * mWidth;
+    const std::vector<BYTE>& srgbTable = GetSRGBTable();
+
+    ForEachRowBand(mHeight, [&](int firstRow, int endRow) {
+        std::vector<float> values(rowValues);
+        std::vector<int32_t> quantized(rowValues);
+        for (int y = firstRow; y < endRow; ++y) {
+            memcpy(values.data(), source + y * mWidth, rowValues * sizeof(float));
+            if (mToneMapper) {
+                mToneMapper->MapValues(values.data(), rowValues);
+            }
+
+            // Linear values are truncated like SetFinalPixelColor does.
+            const float scale = mSRGBEncoding ? static_cast<float>(SRGB_TABLE_SIZE - 1) : 255.f;
+            const float offset = mSRGBEncoding ? 0.5f : 0.f;
+            for (int i = 0; i < rowValues; ++i) {
+                quantized[i] = static_cast<int32_t>(FastMath::Saturate(values[i]) * scale + offset);
+            }
+            if (mSRGBEncoding) {
+                for (int i = 0; i < rowValues; ++i) {
+                    quantized[i] = srgbTable[quantized[i]];
+                }
+            }
+
+            BYTE* scanline = FreeImage_GetScanLine(m_pOutBitmap, mHeight - y - 1);
+            for (int x = 0; x < mWidth; ++x) {
+                scanline[3 * x + FI_RGBA_RED] = static_cast<BYTE>(quantized[3 * x]);
+                scanline[3 * x + FI_RGBA_GREEN] = static_cast<BYTE>(quantized[3 * x + 1]);
+                scanline[3 * x + FI_RGBA_BLUE] = static_cast<BYTE>(quantized[3 * x + 2]);
+            }
+        }
+    });
 }
 
 // Simple Call to Set Pixel Color
@@ -62,11 +175,12 @@ void ImageWriter::SetFinalPixelColor(glm::vec3 inColor, int inX, int inY)
 }
 
 // Manual call to save file 
-void ImageWriter::SaveImage()
+bool ImageWriter::SaveImage()
 {
+    PROFILE_ZONE(zone, "Write Output");
     FREE_IMAGE_FORMAT fm = FIF_JPEG;
     if (m_pOutBitmap == NULL)
-        return;
+        return false;
 
     // Determine extension provided and save properly
     // Determine last period (right before the extension -- if none, default to JPEG)
@@ -84,14 +198,247 @@ void ImageWriter::SaveImage()
             fm = FIF_BMP;
         else if (sub == "PNG")
             fm = FIF_PNG;
-        else {
+        else if (sub == "PFM" || sub == "EXR") {
+            const FREE_IMAGE_FORMAT floatFormat = (sub == "EXR") ? FIF_EXR : FIF_PFM;
+            const bool saved = SaveFloatImage(floatFormat, m_sFileName, GetFinalHDRData(), false);
+            if (saved) {
+                m_pOutBitmap = NULL;
+            }
+            SaveAOVImages(floatFormat, m_sFileName.substr(indx));
+            return saved;
+        } else {
             m_sFileName = m_sFileName.replace(indx + 1, sub.length(), "jpg");
         }
     }
 
-    if (FreeImage_Save(fm, m_pOutBitmap, m_sFileName.c_str(), 0)) {
+    const bool saved = FreeImage_Save(fm, m_pOutBitmap, m_sFileName.c_str(), 0) != FALSE;
+    if (saved) {
         // At this point we have saved successfully
         // Make sure m_pOutBitmap is NULL so we don't try to save it again
         m_pOutBitmap = NULL;
     }
+    SaveAOVImages(FIF_EXR, ".exr");
+    return saved;
+}
+
+const glm::vec3* ImageWriter::GetFinalHDRData() const
+{
+    return mPostProcessedData.empty() ? mHDRData : mPostProcessedData.data();
+}
+
+bool ImageWriter::SaveFloatImage(FREE_IMAGE_FORMAT format, const std::string& filename, const glm::vec3* data, bool singleChannel) const
+{
+    FIBITMAP* bitmap = FreeImage_AllocateT(singleChannel ? FIT_FLOAT : FIT_RGBF, mWidth, mHeight);
+    if (!bitmap) {
+        std::cerr << "ERROR: Float bitmap failed to initialize." << std::endl;
+        return false;
+    }
+
+    for (int y = 0; y < mHeight; ++y) {
+        BYTE* scanline = FreeImage_GetScanLine(bitmap, mHeight - y - 1);
+        const glm::vec3* row = data + y * mWidth;
+        if (singleChannel) {
+            float* values = reinterpret_cast<float*>(scanline);
+            for (int x = 0; x < mWidth; ++x) {
+                values[x] = row[x].x;
+            }
+        } else {
+            FIRGBF* values = reinterpret_cast<FIRGBF*>(scanline);
+            for (int x = 0; x < mWidth; ++x) {
+                values[x].red = row[x].r;
+                values[x].green = row[x].g;
+                values[x].blue = row[x].b;
+            }
+        }
+    }
+
+    // EXR defaults to half floats, which depth in particular does not survive.
+    const bool saved = FreeImage_Save(format, bitmap, filename.c_str(), (format == FIF_EXR) ? EXR_FLOAT : 0) != FALSE;
+    if (!saved) {
+        std::cerr << "ERROR: Failed to save " << filename << std::endl;
+    }
+    FreeImage_Unload(bitmap);
+    return saved;
+}
+
+void ImageWriter::EnableAOV(ImageAOV aov)
+{
+    std::vector<glm::vec3>& data = mAOVData[static_cast<int>(aov)];
+    if (data.empty()) {
+        data.resize(static_cast<size_t>(mWidth) * mHeight);
+    }
+}
+
+bool ImageWriter::IsAOVEnabled(ImageAOV aov) const
+{
+    return !mAOVData[static_cast<int>(aov)].empty();
+}
+
+bool ImageWriter::HasAOVs() const
+{
+    for (int aov = 0; aov < static_cast<int>(ImageAOV::COUNT); ++aov) {
+        if (!mAOVData[aov].empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ImageWriter::SetPixelAOV(ImageAOV aov, const glm::vec3& value, int inX, int inY)
+{
+    std::vector<glm::vec3>& data = mAOVData[static_cast<int>(aov)];
+    assert(!data.empty());
+    data[inY * mWidth + inX] = value;
+}
+
+glm::vec3 ImageWriter::GetPixelAOV(ImageAOV aov, int inX, int inY) const
+{
+    const std::vector<glm::vec3>& data = mAOVData[static_cast<int>(aov)];
+    assert(!data.empty());
+    return data[inY * mWidth + inX];
+}
+
+const char* ImageWriter::GetAOVName(ImageAOV aov)
+{
+    switch (aov) {
+    case ImageAOV::DEPTH:
+        return "depth";
+    case ImageAOV::NORMAL:
+        return "normal";
+    case ImageAOV::ALBEDO:
+        return "albedo";
+    default:
+        return "unknown";
+    }
+}
+
+bool ImageWriter::ParseAOV(const std::string& name, ImageAOV& output)
+{
+    for (int aov = 0; aov < static_cast<int>(ImageAOV::COUNT); ++aov) {
+        if (name == GetAOVName(static_cast<ImageAOV>(aov))) {
+            output = static_cast<ImageAOV>(aov);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ImageWriter::SaveAOVImages(FREE_IMAGE_FORMAT format, const std::string& extension) const
+{
+    const std::string baseName = GetFileNameWithoutExtension();
+    for (int aov = 0; aov < static_cast<int>(ImageAOV::COUNT); ++aov) {
+        if (mAOVData[aov].empty()) {
+            continue;
+        }
+        const ImageAOV type = static_cast<ImageAOV>(aov);
+        SaveFloatImage(format, baseName + "." + GetAOVName(type) + extension, mAOVData[aov].data(), type == ImageAOV::DEPTH);
+    }
+}
+
+void ImageWriter::EnableCostOutput()
+{
+    if (mCostData) {
+        return;
+    }
+    mCostData = new glm::vec4[mWidth * mHeight];
+}
+
+void ImageWriter::SetPixelCost(const glm::vec4& cost, int inX, int inY)
+{
+    assert(mCostData);
+    int linearIdx = inY * mWidth + inX;
+    mCostData[linearIdx] = cost;
+}
+
+namespace
+{
+// Maps [0, 1] onto a black -> blue -> cyan -> yellow -> red -> white ramp.
+glm::vec3 ComputeFalseColor(float t)
+{
+    static const glm::vec3 ramp[] = {
+        glm::vec3(0.f, 0.f, 0.f),
+        glm::vec3(0.f, 0.f, 1.f),
+        glm::vec3(0.f, 1.f, 1.f),
+        glm::vec3(1.f, 1.f, 0.f),
+        glm::vec3(1.f, 0.f, 0.f),
+        glm::vec3(1.f, 1.f, 1.f)
+    };
+    const int segments = static_cast<int>(sizeof(ramp) / sizeof(ramp[0])) - 1;
+    const float scaled = glm::clamp(t, 0.f, 1.f) * segments;
+    const int index = std::min(static_cast<int>(scaled), segments - 1);
+    return glm::mix(ramp[index], ramp[index + 1], scaled - index);
+}
+}
+
+std::string ImageWriter::GetFileNameWithoutExtension() const
+{
+    size_t indx = m_sFileName.find_last_of(".");
+    if (indx == string::npos) {
+        return m_sFileName;
+    }
+    return m_sFileName.substr(0, indx);
+}
+
+// PFM stores scanlines bottom to top.
+bool ImageWriter::SaveRawChannel(const std::string& filename, int channel) const
+{
+    std::ofstream output(filename, std::ios::binary);
+    if (!output) {
+        return false;
+    }
+    output << "Pf\n" << mWidth << " " << mHeight << "\n-1.0\n";
+    std::vector<float> scanline(mWidth);
+    for (int y = mHeight - 1; y >= 0; --y) {
+        for (int x = 0; x < mWidth; ++x) {
+            scanline[x] = mCostData[y * mWidth + x][channel];
+        }
+        output.write(reinterpret_cast<const char*>(scanline.data()), scanline.size() * sizeof(float));
+    }
+    return static_cast<bool>(output);
+}
+
+void ImageWriter::SaveCostImages()
+{
+    PROFILE_ZONE(zone, "Write Cost Output");
+    if (!mCostData) {
+        return;
+    }
+
+    static const char* channelNames[] = { "nodes", "triangles", "rays", "time" };
+    const std::string baseName = GetFileNameWithoutExtension();
+    for (int channel = 0; channel < 4; ++channel) {
+        float maxCost = 0.f;
+        for (int i = 0; i < mWidth * mHeight; ++i) {
+            maxCost = std::max(maxCost, mCostData[i][channel]);
+        }
+        const float normalization = (maxCost > 0.f) ? 1.f / maxCost : 0.f;
+
+        FIBITMAP* costBitmap = FreeImage_Allocate(mWidth, mHeight, 24);
+        if (!costBitmap) {
+            std::cerr << "ERROR: Cost bitmap failed to initialize." << std::endl;
+            return;
+        }
+
+        for (int y = 0; y < mHeight; ++y) {
+            for (int x = 0; x < mWidth; ++x) {
+                const glm::vec3 color = ComputeFalseColor(mCostData[y * mWidth + x][channel] * normalization);
+                RGBQUAD quad;
+                quad.rgbRed = static_cast<BYTE>(color.r * 255.f);
+                quad.rgbGreen = static_cast<BYTE>(color.g * 255.f);
+                quad.rgbBlue = static_cast<BYTE>(color.b * 255.f);
+                FreeImage_SetPixelColor(costBitmap, x, mHeight - y - 1, &quad);
+            }
+        }
+
+        const std::string channelName = baseName + ".cost." + channelNames[channel];
+        if (!FreeImage_Save(FIF_PNG, costBitmap, (channelName + ".png").c_str(), 0)) {
+            std::cerr << "ERROR: Failed to save cost image " << channelName << ".png" << std::endl;
+        }
+        FreeImage_Unload(costBitmap);
+
+        if (!SaveRawChannel(channelName + ".pfm", channel)) {
+            std::cerr << "ERROR: Failed to save raw cost data " << channelName << ".pfm" << std::endl;
+        }
+        std::cout << "Cost " << channelNames[channel] << ": max " << maxCost << " per pixel" << std::endl;
+    }
 }
@@ -2,6 +2,20 @@
 
 #include "common/common.h"
 #include "FreeImage.h"
+
+class PostProcessStage;
+class ToneMapper;
+
+// Extra per-pixel outputs for compositing: camera distance (infinite where nothing is hit), world-space normal and
+// unlit diffuse color.
+enum class ImageAOV
+{
+    DEPTH,
+    NORMAL,
+    ALBEDO,
+    COUNT
+};
+
 // Image Writer Class
 // Use the FreeImage library to write an image to a file
 // Assume (0, 0) is the top left of the image.
@@ -15,12 +29,49 @@ public:
     // this function will stored in a float array to support HDR.
     void SetPixelColor(glm::vec3, int, int);
 
+    // Post-process stages are added onto the HDR colors by ApplyPostProcess, in the order they were added. The result
+    // goes to a separate buffer, which CopyHDRToBitmap uses from then on, so the stages can be changed and applied
+    // again without touching the traced colors.
+    void AddPostProcessStage(std::shared_ptr<PostProcessStage> stage);
+    void ClearPostProcessStages();
+    // Marks the pixel as covered by geometry that hides the stages for which IsHiddenByCoverage is true.
+    void SetPixelCoverage(bool covered, int inX, int inY);
+    void ApplyPostProcess();
+
+    // Applied to the HDR colors by CopyHDRToBitmap before they are clamped to [0, 1]. None by default.
+    void SetToneMapper(std::shared_ptr<ToneMapper> toneMapper);
+    // Stores the clamped colors sRGB encoded instead of linearly, which is the default.
+    void SetSRGBEncoding(bool enabled);
+
+    // Tone maps and quantizes the HDR colors, after post-processing if it was applied, straight into the bitmap's
+    // scanlines. Rows are converted in parallel on the shared thread pool.
     void CopyHDRToBitmap();
     // Assume color will be passed in as a 0-1 float
     void SetFinalPixelColor(glm::vec3, int, int);
 
     // Explicit Call to Finish and Save File -- Otherwise done at destructor
-    void SaveImage();
+    // File names ending in .pfm or .exr store the HDR colors as floats, post-processed if that was applied but not tone
+    // mapped or clamped, and need no CopyHDRToBitmap. Returns whether the image was saved.
+    bool SaveImage();
+
+    // Enabled AOVs are saved by SaveImage next to the image as <name>.<aov>.pfm or .exr, depending on its format, and
+    // as EXR next to 8-bit images. Depth has a single channel, stored in x.
+    void EnableAOV(ImageAOV aov);
+    bool IsAOVEnabled(ImageAOV aov) const;
+    bool HasAOVs() const;
+    void SetPixelAOV(ImageAOV aov, const glm::vec3& value, int inX, int inY);
+    glm::vec3 GetPixelAOV(ImageAOV aov, int inX, int inY) const;
+
+    // AOV names as used in file names: "depth", "normal" and "albedo".
+    static const char* GetAOVName(ImageAOV aov);
+    static bool ParseAOV(const std::string& name, ImageAOV& output);
+
+    // Optional per-pixel cost output. Each cost is stored as (nodes visited, triangles tested, rays spawned, seconds).
+    // SaveCostImages writes one false-coloured image per channel (normalized to the channel maximum) next to the
+    // main output along with the raw float values as a greyscale PFM.
+    void EnableCostOutput();
+    void SetPixelCost(const glm::vec4& cost, int inX, int inY);
+    void SaveCostImages();
 
 private:
     // File name that we want to output to
@@ -31,6 +82,26 @@ private:
     // Float data
     glm::vec3* mHDRData;
 
+    // HDR data with the post-process stages applied, empty until ApplyPostProcess.
+    std::vector<glm::vec3> mPostProcessedData;
+    std::vector<std::shared_ptr<PostProcessStage>> mPostProcessStages;
+    std::vector<uint8_t> mCoverage;
+
+    std::shared_ptr<ToneMapper> mToneMapper;
+    bool mSRGBEncoding;
+
     // Bitmap file
     FIBITMAP*	m_pOutBitmap;
+
+    // Per-pixel cost data, NULL unless cost output is enabled.
+    glm::vec4* mCostData;
+
+    // Per-pixel AOV data, empty unless enabled.
+    std::vector<glm::vec3> mAOVData[static_cast<int>(ImageAOV::COUNT)];
+
+    const glm::vec3* GetFinalHDRData() const;
+    bool SaveFloatImage(FREE_IMAGE_FORMAT format, const std::string& filename, const glm::vec3* data, bool singleChannel) const;
+    void SaveAOVImages(FREE_IMAGE_FORMAT format, const std::string& extension) const;
+    std::string GetFileNameWithoutExtension() const;
+    bool SaveRawChannel(const std::string& filename, int channel) const;
 };
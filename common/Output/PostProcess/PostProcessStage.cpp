@@ -0,0 +1,81 @@
+#include "common/Output/PostProcess/PostProcessStage.h"
+
+void PostProcessStage::Apply(int width, int height, int firstRow, int endRow, glm::vec3* output, const uint8_t* coverage) const
+{
+    const int factor = std::max(1, GetDownsampleFactor());
+    const bool hidden = IsHiddenByCoverage();
+    std::vector<glm::vec3> exact(width);
+
+    if (factor == 1) {
+        for (int y = firstRow; y < endRow; ++y) {
+            EvaluateRow(width, height, static_cast<float>(y), 0.f, 1.f, width, exact.data());
+            glm::vec3* outputRow = output + (y - firstRow) * width;
+            const uint8_t* coverageRow = coverage + (y - firstRow) * width;
+            for (int x = 0; x < width; ++x) {
+                const float weight = hidden ? 1.f - coverageRow[x] : 1.f;
+                outputRow[x] += weight * exact[x];
+            }
+        }
+        return;
+    }
+
+    // Grid points sit on every factor-th pixel, with one more row and column past the image where the size is not a
+    // multiple of the factor, so every pixel lies inside a grid cell.
+    const int gridWidth = (width + factor - 2) / factor + 1;
+    const int gridHeight = (height + factor - 2) / factor + 1;
+    const int firstGridRow = firstRow / factor;
+    const int endGridRow = std::min((endRow - 1) / factor + 2, gridHeight);
+    std::vector<glm::vec3> grid(static_cast<size_t>(endGridRow - firstGridRow) * gridWidth);
+    for (int j = firstGridRow; j < endGridRow; ++j) {
+        EvaluateRow(width, height, static_cast<float>(j * factor), 0.f, static_cast<float>(factor), gridWidth, &grid[static_cast<size_t>(j - firstGridRow) * gridWidth]);
+    }
+
+    std::vector<int> columns(width);
+    std::vector<float> columnWeights(width);
+    for (int x = 0; x < width; ++x) {
+        columns[x] = x / factor;
+        columnWeights[x] = static_cast<float>(x - columns[x] * factor) / factor;
+    }
+
+    glm::ivec2 exactRows, exactColumns;
+    GetFullResolutionBands(width, height, exactRows, exactColumns);
+    exactRows = glm::clamp(exactRows, 0, height);
+    exactColumns = glm::clamp(exactColumns, 0, width);
+
+    for (int y = firstRow; y < endRow; ++y) {
+        // Interpolated everywhere first, then the exact bands replace the interpolation.
+        int exactBegin = exactColumns.x;
+        int exactEnd = exactColumns.y;
+        if (y >= exactRows.x && y < exactRows.y) {
+            exactBegin = 0;
+            exactEnd = width;
+        }
+
+        const int j = y / factor;
+        const float rowWeight = static_cast<float>(y - j * factor) / factor;
+        const glm::vec3* top = &grid[static_cast<size_t>(j - firstGridRow) * gridWidth];
+        const glm::vec3* bottom = &grid[static_cast<size_t>(std::min(j + 1, endGridRow - 1) - firstGridRow) * gridWidth];
+        glm::vec3* outputRow = output + (y - firstRow) * width;
+        const uint8_t* coverageRow = coverage + (y - firstRow) * width;
+        for (int x = 0; x < width; ++x) {
+            const int i = columns[x];
+            const int next = std::min(i + 1, gridWidth - 1);
+            const glm::vec3 upper = glm::mix(top[i], top[next], columnWeights[x]);
+            const glm::vec3 lower = glm::mix(bottom[i], bottom[next], columnWeights[x]);
+            const float weight = hidden ? 1.f - coverageRow[x] : 1.f;
+            outputRow[x] += weight * glm::mix(upper, lower, rowWeight);
+        }
+
+        if (exactEnd > exactBegin) {
+            EvaluateRow(width, height, static_cast<float>(y), static_cast<float>(exactBegin), 1.f, exactEnd - exactBegin, exact.data());
+            for (int x = exactBegin; x < exactEnd; ++x) {
+                const int i = columns[x];
+                const int next = std::min(i + 1, gridWidth - 1);
+                const glm::vec3 upper = glm::mix(top[i], top[next], columnWeights[x]);
+                const glm::vec3 lower = glm::mix(bottom[i], bottom[next], columnWeights[x]);
+                const float weight = hidden ? 1.f - coverageRow[x] : 1.f;
+                outputRow[x] += weight * (exact[x - exactBegin] - glm::mix(upper, lower, rowWeight));
+            }
+        }
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "common/common.h"
+
+// Image-space effect added onto the traced HDR colors by ImageWriter::ApplyPostProcess. Stages only see pixel
+// coordinates, so they run after tracing, over whole rows at a time, and can be re-run without tracing again.
+class PostProcessStage
+{
+public:
+    virtual ~PostProcessStage() {}
+
+    // Adds the effect to the rows from firstRow up to endRow of a width x height image. output and coverage hold
+    // those rows only, so images can be processed in bands; downsampled effects evaluate the grid rows each band needs.
+    void Apply(int width, int height, int firstRow, int endRow, glm::vec3* output, const uint8_t* coverage) const;
+
+    // Writes the effect at the count points (x0 + i * xStep, y) of a width x height image into output. Coordinates
+    // are in pixels with (0, 0) at the top left, and may fall outside the image when the stage is downsampled.
+    virtual void EvaluateRow(int width, int height, float y, float x0, float xStep, int count, glm::vec3* output) const = 0;
+
+    // The effect is evaluated on every this many pixels in each direction and bilinearly upsampled, which is only
+    // valid for effects that are smooth at that scale.
+    virtual int GetDownsampleFactor() const { return 1; }
+
+    // Rows from rows.x up to, but not including, rows.y, and columns likewise, where a downsampled effect is too sharp
+    // to upsample, e.g. around a cusp. They are evaluated at full resolution instead. Both are empty by default.
+    virtual void GetFullResolutionBands(int width, int height, glm::ivec2& rows, glm::ivec2& columns) const
+    {
+        rows = columns = glm::ivec2(0);
+    }
+
+    // Whether pixels marked as covered with ImageWriter::SetPixelCoverage hide the effect.
+    virtual bool IsHiddenByCoverage() const { return false; }
+};
@@ -0,0 +1,124 @@
+#include "common/Output/Streaming/StreamingImageWriter.h"
+#include "common/Output/PostProcess/PostProcessStage.h"
+
+StreamingImageWriter::StreamingImageWriter(const std::string& inputFilename, int inputWidth, int inputHeight, int inputBandHeight, int inputMaxOpenBands):
+    filename(inputFilename), width(inputWidth), height(inputHeight), bandHeight(inputBandHeight), maxOpenBands(std::max(1, inputMaxOpenBands)),
+    writtenBands((inputHeight + inputBandHeight - 1) / inputBandHeight, 0), firstUnwrittenBand(0), peakOpenBands(0),
+    file(inputFilename, std::ios::binary), dataOffset(0), writeFailed(false)
+{
+    if (!file) {
+        std::cerr << "ERROR: Failed to open " << filename << " for streaming output." << std::endl;
+        return;
+    }
+    // PFM stores scanlines bottom to top; the negative scale marks little-endian floats.
+    file << "PF\n" << width << " " << height << "\n-1.0\n";
+    dataOffset = file.tellp();
+}
+
+bool StreamingImageWriter::IsOpen() const
+{
+    return file.is_open() && dataOffset > 0;
+}
+
+void StreamingImageWriter::AddPostProcessStage(std::shared_ptr<PostProcessStage> stage)
+{
+    assert(stage);
+    postProcessStages.push_back(stage);
+}
+
+void StreamingImageWriter::SubmitTile(int x, int y, int tileWidth, int tileHeight, const glm::vec3* colors, const uint8_t* coverage)
+{
+    const int band = y / bandHeight;
+    const int bandStart = band * bandHeight;
+    assert(y + tileHeight <= std::min(bandStart + bandHeight, height));
+
+    Band* data;
+    {
+        std::unique_lock<std::mutex> lock(bandMutex);
+        bandWritten.wait(lock, [&]() { return band < firstUnwrittenBand + maxOpenBands; });
+        std::unique_ptr<Band>& entry = openBands[band];
+        if (!entry) {
+            const int rows = std::min(bandHeight, height - bandStart);
+            entry.reset(new Band);
+            entry->colors.resize(static_cast<size_t>(width) * rows);
+            entry->coverage.resize(static_cast<size_t>(width) * rows);
+            entry->missingPixels = width * rows;
+            peakOpenBands = std::max(peakOpenBands, static_cast<int>(openBands.size()));
+        }
+        data = entry.get();
+    }
+
+    // Tiles cover disjoint pixels, and the band stays open until the last of them is in.
+    for (int row = 0; row < tileHeight; ++row) {
+        const size_t offset = static_cast<size_t>(y + row - bandStart) * width + x;
+        std::copy(colors + row * tileWidth, colors + (row + 1) * tileWidth, &data->colors[offset]);
+        std::copy(coverage + row * tileWidth, coverage + (row + 1) * tileWidth, &data->coverage[offset]);
+    }
+
+    std::unique_ptr<Band> finishedBand;
+    {
+        std::lock_guard<std::mutex> lock(bandMutex);
+        data->missingPixels -= tileWidth * tileHeight;
+        if (data->missingPixels == 0) {
+            auto entry = openBands.find(band);
+            finishedBand = std::move(entry->second);
+            openBands.erase(entry);
+        }
+    }
+    if (!finishedBand) {
+        return;
+    }
+
+    const int rows = static_cast<int>(finishedBand->colors.size()) / width;
+    for (const auto& stage : postProcessStages) {
+        stage->Apply(width, height, bandStart, bandStart + rows, finishedBand->colors.data(), finishedBand->coverage.data());
+    }
+    WriteBand(band, *finishedBand);
+    finishedBand.reset();
+
+    {
+        std::lock_guard<std::mutex> lock(bandMutex);
+        writtenBands[band] = 1;
+        while (firstUnwrittenBand < static_cast<int>(writtenBands.size()) && writtenBands[firstUnwrittenBand]) {
+            ++firstUnwrittenBand;
+        }
+    }
+    bandWritten.notify_all();
+}
+
+void StreamingImageWriter::WriteBand(int band, const Band& data)
+{
+    const int rows = static_cast<int>(data.colors.size()) / width;
+    const int lastRow = band * bandHeight + rows - 1;
+    const std::streamsize rowBytes = static_cast<std::streamsize>(width) * sizeof(glm::vec3);
+
+    // The band's rows are consecutive in the file, last row first.
+    std::lock_guard<std::mutex> lock(fileMutex);
+    if (!IsOpen()) {
+        writeFailed = true;
+        return;
+    }
+    file.seekp(dataOffset + static_cast<std::streamoff>(height - 1 - lastRow) * rowBytes);
+    for (int row = rows - 1; row >= 0; --row) {
+        file.write(reinterpret_cast<const char*>(&data.colors[static_cast<size_t>(row) * width]), rowBytes);
+    }
+    writeFailed = writeFailed || !file;
+}
+
+bool StreamingImageWriter::Finish()
+{
+    {
+        std::lock_guard<std::mutex> lock(bandMutex);
+        if (firstUnwrittenBand != static_cast<int>(writtenBands.size())) {
+            std::cerr << "ERROR: Not every band of " << filename << " was completed." << std::endl;
+            return false;
+        }
+    }
+    std::lock_guard<std::mutex> lock(fileMutex);
+    file.flush();
+    if (writeFailed || !file) {
+        std::cerr << "ERROR: Failed to write " << filename << "." << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "common/common.h"
+#include <condition_variable>
+#include <fstream>
+#include <map>
+#include <mutex>
+
+class PostProcessStage;
+
+// Writes a render to a float PFM file band by band as its tiles come in, for frames too large to keep whole like
+// ImageWriter does. Only bands with tiles still missing are held in memory: a tile more than maxOpenBands bands past
+// the first unfinished one waits until that band has been written. The post-process stages are applied to each band
+// before it is written; there is no tone mapping or clamping.
+class StreamingImageWriter
+{
+public:
+    StreamingImageWriter(const std::string& filename, int width, int height, int bandHeight, int maxOpenBands);
+
+    bool IsOpen() const;
+    void AddPostProcessStage(std::shared_ptr<PostProcessStage> stage);
+
+    // Copies in a finished tile of tileWidth x tileHeight colors and coverage flags, stored row by row. Tiles must
+    // not span bands. Safe to call from several threads.
+    void SubmitTile(int x, int y, int tileWidth, int tileHeight, const glm::vec3* colors, const uint8_t* coverage);
+
+    // Flushes the file. Fails if any band is missing tiles or could not be written.
+    bool Finish();
+
+    // The most bands that were held at once, for checking the memory bound.
+    int GetPeakOpenBands() const { return peakOpenBands; }
+
+private:
+    struct Band
+    {
+        std::vector<glm::vec3> colors;
+        std::vector<uint8_t> coverage;
+        int missingPixels;
+    };
+
+    void WriteBand(int band, const Band& data);
+
+    std::string filename;
+    int width;
+    int height;
+    int bandHeight;
+    int maxOpenBands;
+    std::vector<std::shared_ptr<PostProcessStage>> postProcessStages;
+
+    std::mutex bandMutex;
+    std::condition_variable bandWritten;
+    std::map<int, std::unique_ptr<Band>> openBands;
+    std::vector<uint8_t> writtenBands;
+    // Every band before this one has been written.
+    int firstUnwrittenBand;
+    int peakOpenBands;
+
+    std::mutex fileMutex;
+    std::ofstream file;
+    std::streamoff dataOffset;
+    bool writeFailed;
+};
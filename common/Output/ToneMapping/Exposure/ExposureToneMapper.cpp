@@ -0,0 +1,9 @@
+#include "common/Output/ToneMapping/Exposure/ExposureToneMapper.h"
+
+void ExposureToneMapper::MapValues(float* values, int count) const
+{
+    const float scale = exposureScale;
+    for (int i = 0; i < count; ++i) {
+        values[i] *= scale;
+    }
+}
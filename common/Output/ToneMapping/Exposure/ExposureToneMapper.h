@@ -0,0 +1,10 @@
+#pragma once
+
+#include "common/Output/ToneMapping/ToneMapper.h"
+
+// Only scales by the exposure; everything brighter than 1 afterwards clips.
+class ExposureToneMapper : public ToneMapper
+{
+public:
+    virtual void MapValues(float* values, int count) const override;
+};
@@ -0,0 +1,13 @@
+#include "common/Output/ToneMapping/Filmic/FilmicToneMapper.h"
+#include "common/Utility/Math/FastMath.h"
+
+void FilmicToneMapper::MapValues(float* values, int count) const
+{
+    // The fit was made for colors pre-exposed by 0.6.
+    const float scale = 0.6f * exposureScale;
+    for (int i = 0; i < count; ++i) {
+        // Negative values would reach the curve's pole.
+        const float x = FastMath::MaxNonNegative(values[i] * scale, 0.f);
+        values[i] = (x * (2.51f * x + 0.03f)) / (x * (2.43f * x + 0.59f) + 0.14f);
+    }
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "common/Output/ToneMapping/ToneMapper.h"
+
+// Narkowicz's rational fit of the ACES filmic curve: a toe that deepens the shadows and a shoulder that rolls the
+// highlights off smoothly towards 1.
+class FilmicToneMapper : public ToneMapper
+{
+public:
+    virtual void MapValues(float* values, int count) const override;
+};
@@ -0,0 +1,22 @@
+#include "common/Output/ToneMapping/Reinhard/ReinhardToneMapper.h"
+
+ReinhardToneMapper::ReinhardToneMapper():
+    whitePoint(4.f)
+{
+}
+
+void ReinhardToneMapper::SetWhitePoint(float input)
+{
+    assert(input > 0.f);
+    whitePoint = input;
+}
+
+void ReinhardToneMapper::MapValues(float* values, int count) const
+{
+    const float scale = exposureScale;
+    const float inverseWhite2 = 1.f / (whitePoint * whitePoint);
+    for (int i = 0; i < count; ++i) {
+        const float x = values[i] * scale;
+        values[i] = x * (1.f + x * inverseWhite2) / (1.f + x);
+    }
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "common/Output/ToneMapping/ToneMapper.h"
+
+// Extended Reinhard curve x (1 + x / white^2) / (1 + x), which reaches 1 at the white point.
+class ReinhardToneMapper : public ToneMapper
+{
+public:
+    ReinhardToneMapper();
+
+    // Exposed value that maps to 1, 4 by default.
+    void SetWhitePoint(float input);
+
+    virtual void MapValues(float* values, int count) const override;
+
+private:
+    float whitePoint;
+};
@@ -0,0 +1,36 @@
+#include "common/Output/ToneMapping/ToneMapper.h"
+#include "common/Output/ToneMapping/Exposure/ExposureToneMapper.h"
+#include "common/Output/ToneMapping/Reinhard/ReinhardToneMapper.h"
+#include "common/Output/ToneMapping/Filmic/FilmicToneMapper.h"
+
+ToneMapper::ToneMapper():
+    exposure(0.f), exposureScale(1.f)
+{
+}
+
+ToneMapper::~ToneMapper()
+{
+}
+
+void ToneMapper::SetExposure(float stops)
+{
+    exposure = stops;
+    exposureScale = std::exp2(stops);
+}
+
+float ToneMapper::GetExposure() const
+{
+    return exposure;
+}
+
+std::shared_ptr<ToneMapper> ToneMapper::Create(const std::string& name)
+{
+    if (name == "exposure") {
+        return std::make_shared<ExposureToneMapper>();
+    } else if (name == "reinhard") {
+        return std::make_shared<ReinhardToneMapper>();
+    } else if (name == "filmic") {
+        return std::make_shared<FilmicToneMapper>();
+    }
+    return nullptr;
+}
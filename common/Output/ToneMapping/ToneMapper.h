@@ -0,0 +1,26 @@
+#pragma once
+
+#include "common/common.h"
+
+// Maps HDR colors into [0, 1] before ImageWriter quantizes them. Operators work on each channel separately, over
+// flat arrays of floats, so their loops vectorize.
+class ToneMapper
+{
+public:
+    ToneMapper();
+    virtual ~ToneMapper();
+
+    // Scales the colors by 2^stops before the operator's curve.
+    void SetExposure(float stops);
+    float GetExposure() const;
+
+    // Maps count channel values in place. Results outside [0, 1] are clamped afterwards.
+    virtual void MapValues(float* values, int count) const = 0;
+
+    // Creates the operator called "exposure", "reinhard" or "filmic", or returns null for any other name.
+    static std::shared_ptr<ToneMapper> Create(const std::string& name);
+
+protected:
+    float exposure;
+    float exposureScale;
+};
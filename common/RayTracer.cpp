@@ -4,7 +4,13 @@
 #include "common/Scene/Geometry/Ray/Ray.h"
 #include "common/Intersection/IntersectionState.h"
 #include "common/Output/ImageWriter.h"
+#include "common/Output/Checkpoint/RenderCheckpoint.h"
+#include "common/Output/PostProcess/PostProcessStage.h"
+#include "common/Output/Streaming/StreamingImageWriter.h"
+#include "common/Output/ToneMapping/ToneMapper.h"
 #include "common/Rendering/Renderer.h"
+#include "common/Rendering/Renderer/Photon/PhotonMappingRenderer.h"
+#include "common/Sampling/ColorSampler.h"
 
 #include "common/Scene/Camera/Perspective/PerspectiveCamera.h"
 
@@ -12,6 +18,17 @@
 #include "assimp/material.h"
 
 #include "common/Scene/Geometry/Primitives/Triangle/Triangle.h"
+#include "common/Scene/Geometry/Primitives/Sphere/Sphere.h"
+#include "common/Scene/Geometry/Mesh/MeshObject.h"
+#include "common/Rendering/Material/Material.h"
+#include "common/Utility/Threading/ThreadPool.h"
+#include "common/Utility/Math/FastMath.h"
+#include "common/Utility/Math/LookupTable2D.h"
+
+#include <atomic>
+#include <mutex>
+#include <sstream>
+#include <thread>
 
 // #define WIDTH 3840
 // #define HEIGHT 2160
@@ -23,94 +40,425 @@
 #define EZ -3000
 #define ER 10000
 
+// Pixels are rendered in square tiles that worker threads pull from a shared queue.
+#define TILE_SIZE 32
+
 #define SUN_X 0.324f
 #define SUN_Y 0.229f
 
+// The sun flare is added after tracing, evaluated on every this many pixels and bilinearly upsampled, except for
+// within this many pixels of the sun's row and column: its rays along them are too sharp.
+#define FLARE_DOWNSAMPLE 4
+#define FLARE_EXACT_RADIUS 16
+
+// Progressive rendering starts with one sample per this many pixels in each direction and halves that every pass.
+// Must divide TILE_SIZE.
+#define PROGRESSIVE_START_BLOCK 16
+
+// With checkpointing on, finished tiles are flushed to the checkpoint file at most this often.
+#define CHECKPOINT_INTERVAL_SECONDS 30.f
+
+// Writes per-pixel cost heatmaps (nodes visited, triangles tested, rays spawned, time) next to the output image.
+#define OUTPUT_COST_IMAGES 0
+
+// Maps the earth textures from tiled .ttex files next to the images instead of decoding the images on every start.
+// The files are written on the first start, or again when the format below changes.
+#define TILED_EARTH_TEXTURES 1
+// Pages the tiled earth textures in through the texture cache, which keeps them within its memory budget, instead of
+// mapping them. For the full-resolution 21600x21600 cloud maps on machines without the address space or memory.
+#define CACHED_EARTH_TEXTURES 0
+
+// Stores the earth color maps block compressed (BC1, 4 bits per texel) instead of RGB8.
+#define COMPRESSED_EARTH_TEXTURES 0
+
+// With a nonzero cloud tolerance, every this many earth pixels also run the full per-layer loop, and the render reports
+// how far the adaptive loop was off for them. 1 checks every earth pixel.
+#define CLOUD_ERROR_SAMPLE_INTERVAL 64
+
+// A nonzero cloud tolerance (see RayTracer::SetCloudTolerance) samples one cloud layer per this many cloud map
+// repeats of pixel footprint, up to CLOUD_MAX_LAYER_STRIDE layers at a time.
+#define CLOUD_STRIDE_FOOTPRINT 1.f
+#define CLOUD_MAX_LAYER_STRIDE 4
+
+// Math in the earth shading. 0 calls libm throughout. 1 uses FastMath's HIGH approximations, integer powers by
+// multiplication and a table for the atmosphere color. 2 uses the LOW approximations and a coarser table.
+#define EARTH_MATH_ACCURACY 1
+
+#if OUTPUT_COST_IMAGES && !DIAGNOSTICS_ON
+#error "OUTPUT_COST_IMAGES requires DIAGNOSTICS_ON."
+#endif
+
 
 struct MagicIntersection {
     bool intersected;
     glm::vec3 normal;
     glm::vec2 uv;
     float atmo;
+    // Screen-space uv derivatives, zero when the ray has no differentials.
+    glm::vec2 duvdx;
+    glm::vec2 duvdy;
 };
 
-std::shared_ptr<Texture2D> wmask;
-std::shared_ptr<Texture2D> eland;
-std::shared_ptr<Texture2D> eclou[2];
-std::shared_ptr<Texture2D> eclou_normal[2];
+std::shared_ptr<Texture> wmask;
+std::shared_ptr<Texture> eland;
+std::shared_ptr<Texture> eclou[2];
+std::shared_ptr<Texture> eclou_normal[2];
+#if COMPRESSED_EARTH_TEXTURES
+const TextureFormat EARTH_COLOR_FORMAT = TextureFormat::BC1;
+#else
+const TextureFormat EARTH_COLOR_FORMAT = TextureFormat::RGB8;
+#endif
+
+#if EARTH_MATH_ACCURACY == 2
+const FastMath::Accuracy EARTH_MATH = FastMath::Accuracy::LOW;
+const int ATMOSPHERE_TABLE_SIZE = 32;
+#else
+const FastMath::Accuracy EARTH_MATH = FastMath::Accuracy::HIGH;
+const int ATMOSPHERE_TABLE_SIZE = 128;
+#endif
+
+// Atmosphere color away from the limb over (surf_dot, spec_dot), filled by Initialize.
+LookupTable2D<glm::vec3> atmosphereTable;
+
+float earth_exp(float x) {
+#if EARTH_MATH_ACCURACY
+    return FastMath::Exp<EARTH_MATH>(x);
+#else
+    return expf(x);
+#endif
+}
+
+float earth_pow(float x, float y) {
+#if EARTH_MATH_ACCURACY
+    return FastMath::Pow<EARTH_MATH>(x, y);
+#else
+    return powf(x, y);
+#endif
+}
+
+template <int N>
+float earth_ipow(float x) {
+#if EARTH_MATH_ACCURACY
+    return FastMath::IntPow<N>(x);
+#else
+    return powf(x, (float) N);
+#endif
+}
 
-MagicIntersection magic_intersect(Ray *ray)
+// Starts loading on the loader threads.
+TextureLoader::TextureFuture load_earth_texture(const std::string& filename, TextureFormat format) {
+#if TILED_EARTH_TEXTURES
+    return TextureLoader::LoadTiledTextureAsync(filename, format, CACHED_EARTH_TEXTURES ? TiledTexture::AccessMode::CACHED : TiledTexture::AccessMode::MEMORY_MAPPED);
+#else
+    return TextureLoader::LoadTextureAsync(filename, format);
+#endif
+}
+
+// Earth surface data for the earth shading, from a hit on the earth sphere. atmo, the distance of the ray from the
+// earth in hundreds of units (negative when it hits), is also set without a hit; EarthHaloStage computes the same.
+MagicIntersection magic_intersect(Ray* ray, const IntersectionState* earthHit)
 {
     glm::vec3 ray_pos = ray->GetRayPosition(0);
-    glm::vec3 ray_dir = ray->GetRayDirection();
-    glm::vec3 ray_dir_norm = glm::normalize(ray_dir);
+    glm::vec3 ray_dir_norm = glm::normalize(ray->GetRayDirection());
 
     glm::vec3 magic_pos(EX, EY, EZ);
     glm::vec3 magic_pos_raysp = magic_pos - ray_pos;
-    float ray_T = glm::dot(magic_pos_raysp, ray_dir_norm);
-    glm::vec3 proj = ray_T * ray_dir_norm;
-    glm::vec3 diff = magic_pos_raysp - proj;
-
-    float difflen = glm::length(diff);
-    bool intersected = ray_T > 0 && difflen < ER;
-    MagicIntersection inter = {intersected};
-    inter.atmo = (difflen - ER) / 100.f;
-    if (intersected) {
-        float otherleg = sqrt(ER * ER - difflen * difflen);
-        glm::vec3 int_pt = proj - ray_dir_norm * otherleg;
-        glm::vec3 rad_vec = int_pt - magic_pos_raysp;
-        glm::vec3 normal = glm::normalize(rad_vec);
-        inter.normal = normal;
-
-        float uvx = atan2f(normal.z, normal.y) / 2 / M_PI;
-        float uvy = asinf(normal.x) / M_PI + 0.5;
-        glm::vec2 uv(fmodf(uvx + 0.235, 1.0), uvy);
-        inter.uv = uv;
+    glm::vec3 diff = magic_pos_raysp - glm::dot(magic_pos_raysp, ray_dir_norm) * ray_dir_norm;
+    MagicIntersection inter = {earthHit != nullptr};
+    inter.atmo = (glm::length(diff) - ER) / 100.f;
+    if (earthHit) {
+        inter.normal = earthHit->ComputeNormal();
+        // make_earth lines the sphere up so that its u is 0.5 where the earth textures expect 0.235.
+        glm::vec2 uv = earthHit->ComputeUV();
+        inter.uv = glm::vec2(fmodf(uv.x - 0.265f, 1.f), uv.y);
+        earthHit->ComputeUVDifferentials(inter.duvdx, inter.duvdy);
     }
     return inter;
 }
 
-glm::vec3 magic_hugeland(glm::vec2 uv) {
+glm::vec3 magic_hugeland(glm::vec2 uv, glm::vec2 duvdx, glm::vec2 duvdy) {
     float x = fmodf(uv.x * 4.f - 0.5f, 1.f);
     float y = fmodf(uv.y * 2.f - 0.5f, 1.f);
-    glm::vec3 samp = glm::vec3(eland->Sample(glm::vec2(x, y)));
+    const glm::vec2 scale(4.f, 2.f);
+    glm::vec3 samp = glm::vec3(eland->SampleGrad(glm::vec2(x, y), duvdx * scale, duvdy * scale));
     return samp;
 }
 
-float magic_watermask(glm::vec2 uv) {
+float magic_watermask(glm::vec2 uv, glm::vec2 duvdx, glm::vec2 duvdy) {
     float x = fmodf(uv.x * 4.f - 0.5f, 1.f);
     float y = fmodf(uv.y * 2.f - 0.5f, 1.f);
-    glm::vec3 samp = glm::vec3(wmask->Sample(glm::vec2(x, y)));
+    const glm::vec2 scale(4.f, 2.f);
+    glm::vec3 samp = glm::vec3(wmask->SampleGrad(glm::vec2(x, y), duvdx * scale, duvdy * scale));
     return (samp.r + samp.g + samp.b) / 3.f;
 }
 
-glm::vec3 magic_clouds(glm::vec2 uv) {
+glm::vec3 magic_clouds(glm::vec2 uv, glm::vec2 duvdx, glm::vec2 duvdy) {
     int c = (int) (uv.x * 64.f) % 2;
     float x = fmodf(uv.x * 64.f, 1.f);
     float y = fmodf(uv.y * 32.f, 1.f);
-    glm::vec4 samp = eclou[c]->Sample(glm::vec2(x, y));
+    const glm::vec2 scale(64.f, 32.f);
+    glm::vec4 samp = eclou[c]->SampleGrad(glm::vec2(x, y), duvdx * scale, duvdy * scale);
     return glm::vec3(samp);
 }
 
-glm::vec3 magic_cloudnormal(glm::vec2 uv) {
+glm::vec3 magic_cloudnormal(glm::vec2 uv, glm::vec2 duvdx, glm::vec2 duvdy) {
     int c = (int) (uv.x * 64.f) % 2;
     float x = fmodf(uv.x * 64.f, 1.f);
     float y = fmodf(uv.y * 32.f, 1.f);
-    glm::vec3 samp = glm::vec3(eclou_normal[c]->Sample(glm::vec2(x, y)));
+    const glm::vec2 scale(64.f, 32.f);
+    glm::vec3 samp = glm::vec3(eclou_normal[c]->SampleGrad(glm::vec2(x, y), duvdx * scale, duvdy * scale));
     return (samp - glm::vec3(0.5f, 0.5f, 0.5f)) * glm::vec3(-1.f, 1.f, 1.f);
 }
 
-std::shared_ptr<Camera> make_camera() {
-    std::shared_ptr<PerspectiveCamera> camera = std::make_shared<PerspectiveCamera>((float) WIDTH / HEIGHT, 45.f);
+const int CLOUD_LAYERS = 100;
+const glm::vec3 CLOUD_TINT(0.7f, 0.9f, 1.f);
+const glm::vec3 CLOUD_GLINT_COLOR(1.f, .85f, .6f);
+
+glm::vec2 cloud_layer_offset(int layer) {
+    return (float) layer * glm::vec2(0.015, 0.05);
+}
+
+float cloud_layer_weight(int layer) {
+    return 0.5f + 0.5f * layer / (float) CLOUD_LAYERS;
+}
+
+float cloud_alpha(glm::vec3 cloudColor) {
+    return earth_pow((cloudColor.r + cloudColor.g + cloudColor.b) / 3.f, 0.6f);
+}
+
+// Per-pixel terms shared by all cloud layers.
+struct CloudLighting {
+    glm::vec3 ray_dir;
+    glm::vec3 sun_dir;
+    glm::vec3 normal;
+    glm::mat3 cloutrans;
+    float surf_dot;
+    float spec;
+    float fresnel;
+    // powf(spec, 0.2) for the glints.
+    float glint_spec;
+};
+
+CloudLighting make_cloud_lighting(const MagicIntersection& mi, glm::vec3 ray_dir, glm::vec3 sun_dir, float surf_dot, float spec, float fresnel) {
+    glm::vec3 right(1.f, 0.f, 0.f);
+    glm::vec3 back = glm::cross(right, mi.normal);
+    CloudLighting lighting = { ray_dir, sun_dir, mi.normal, glm::mat3(back, right, mi.normal), surf_dot, spec, fresnel, earth_pow(spec, 0.2f) };
+    return lighting;
+}
+
+// Exposure and sun glint of a cloud layer with the given world-space normal.
+void cloud_layer_lighting(const CloudLighting& l, glm::vec3 cloudNormal, float& cloud_expo, float& glint) {
+    float clou_dot = glm::dot(cloudNormal, l.ray_dir);
+    float cloudiff = earth_ipow<2>(glm::max(0.f, glm::dot(cloudNormal, l.sun_dir) + 0.5f));
+    float clouspec = l.spec + glm::max(0.f, earth_ipow<15>(glm::dot(l.sun_dir, l.ray_dir - clou_dot * l.normal)));
+    float cloufresnel = earth_ipow<8>(1.f + l.surf_dot + clou_dot);
+    // float cloud_expo = 2.f * cloudiff * cloufresnel + 2.f * cloufresnel + fresnel + 2.f * clouspec;
+    cloud_expo = 1.f * (l.spec + l.fresnel) * (cloudiff + cloufresnel + clouspec);
+    glint = glm::clamp(5.f * l.glint_spec * (cloudiff + cloufresnel) - 2.f, 0.f, 1.f);
+}
+
+// Lit color and alpha of one cloud layer.
+glm::vec3 cloud_layer_color(const MagicIntersection& mi, const CloudLighting& lighting, int layer, float& cloudAlpha) {
+    glm::vec2 ofs = cloud_layer_offset(layer);
+    glm::vec3 cloudColor = magic_clouds(mi.uv + ofs, mi.duvdx, mi.duvdy);
+    cloudAlpha = cloud_alpha(cloudColor);
+    cloudColor *= CLOUD_TINT;
+    glm::vec3 cloudNormal = lighting.cloutrans * magic_cloudnormal(mi.uv + ofs, mi.duvdx, mi.duvdy);
+    float cloud_expo, glint;
+    cloud_layer_lighting(lighting, cloudNormal, cloud_expo, glint);
+    cloudColor *= cloud_layer_weight(layer) * cloud_expo;
+    cloudColor += glint * CLOUD_GLINT_COLOR;
+    return cloudColor;
+}
+
+// Reference: composites all layers over sampleColor, sampling both cloud maps for every layer.
+glm::vec3 composite_cloud_layers(const MagicIntersection& mi, const CloudLighting& lighting, glm::vec3 sampleColor) {
+    for (int i = 1; i <= CLOUD_LAYERS; i += 1) {
+        float cloudAlpha;
+        glm::vec3 cloudColor = cloud_layer_color(mi, lighting, i, cloudAlpha);
+        sampleColor += cloudAlpha * (cloudColor - sampleColor);
+    }
+    return sampleColor;
+}
+
+// Number of consecutive layers one sample stands in for. Once the pixel footprint covers a good part of a cloud map
+// repeat, the filtered layers are nearly alike.
+int cloud_layer_stride(const MagicIntersection& mi) {
+    const glm::vec2 scale(64.f, 32.f);
+    float footprint = glm::max(glm::length(mi.duvdx * scale), glm::length(mi.duvdy * scale));
+    return glm::clamp(1 + (int) (footprint / CLOUD_STRIDE_FOOTPRINT), 1, CLOUD_MAX_LAYER_STRIDE);
+}
+
+// Composites the layers front to back and stops once less than tolerance of the light behind them gets through.
+// Stopping replaces the skipped layers and the ground by the ground color, which changes the result by at most the
+// remaining transmittance times their brightest color. A nonzero tolerance also merges layers by their footprint (see
+// cloud_layer_stride), whose error depends on how alike the merged layers are rather than on the tolerance; the render
+// measures it on a sample of the pixels (see CLOUD_ERROR_SAMPLE_INTERVAL). Returns the number of layers sampled in
+// layerCount.
+glm::vec3 composite_cloud_layers_adaptive(const MagicIntersection& mi, const CloudLighting& lighting, glm::vec3 groundColor, float tolerance, int& layerCount) {
+    const int stride = (tolerance > 0.f) ? cloud_layer_stride(mi) : 1;
+    glm::vec3 sampleColor;
+    float transmittance = 1.f;
+    layerCount = 0;
+    for (int i = CLOUD_LAYERS; i >= 1 && transmittance >= tolerance; i -= stride) {
+        float cloudAlpha;
+        glm::vec3 cloudColor = cloud_layer_color(mi, lighting, i, cloudAlpha);
+        // A sample standing in for n layers covers like n of them stacked.
+        const int covered = std::min(stride, i);
+        if (covered > 1) {
+            cloudAlpha = 1.f - powf(1.f - cloudAlpha, (float) covered);
+        }
+        sampleColor += transmittance * cloudAlpha * cloudColor;
+        transmittance *= 1.f - cloudAlpha;
+        ++layerCount;
+    }
+    return sampleColor + transmittance * groundColor;
+}
+
+// Cloud layers sampled for the earth pixels one render worker shaded. Each worker sums its own pixels, and the sums
+// are merged once it is done.
+struct CloudStatistics {
+    size_t earthPixels = 0;
+    size_t layerSum = 0;
+    // Distance between the adaptive and the full per-layer composite over the checked pixels, and the length of the
+    // latter.
+    size_t checkedPixels = 0;
+    double errorSum = 0.0;
+    double referenceSum = 0.0;
+    float maxError = 0.f;
+
+    void Merge(const CloudStatistics& other) {
+        earthPixels += other.earthPixels;
+        layerSum += other.layerSum;
+        checkedPixels += other.checkedPixels;
+        errorSum += other.errorSum;
+        referenceSum += other.referenceSum;
+        maxError = std::max(maxError, other.maxError);
+    }
+};
+
+float surface_spec(float spec_dot) {
+    return glm::max(0.f, earth_ipow<15>(spec_dot));
+}
+
+float surface_fresnel(float surf_dot) {
+    return glm::max(earth_ipow<7>(1.03f + surf_dot), 0.f);
+}
+
+// Atmosphere color without the glow at the limb, shifting from blue to red towards the sun glint.
+glm::vec3 atmosphere_color(float fresnel, float spec) {
+    glm::vec3 batmocol = 1.4f * powf(fresnel, .4f) * glm::vec3(0.45f, 0.5f, 0.65f);
+    glm::vec3 ratmocol = 1.4f * powf(fresnel, .4f) * glm::vec3(0.7f, 0.6f, 0.5f);
+    float coeff = powf(spec, 0.8f);
+    return coeff * ratmocol + (1.f - coeff) * batmocol;
+}
+
+// Both powers are smooth in the dot products they are computed from, unlike in fresnel and spec themselves, so the
+// table is indexed by those. surf_dot is at most 0 on the visible side of the sphere; spec is 0 for negative spec_dot.
+LookupTable2D<glm::vec3> make_atmosphere_table() {
+    return LookupTable2D<glm::vec3>([](float surf_dot, float spec_dot) {
+        return atmosphere_color(surface_fresnel(surf_dot), surface_spec(spec_dot));
+    }, glm::vec2(-1.f, 0.f), glm::vec2(0.f, 1.f), ATMOSPHERE_TABLE_SIZE, ATMOSPHERE_TABLE_SIZE);
+}
+
+// Streamed output is always PFM, next to where the image would go.
+std::string get_streaming_filename(const std::string& outputFilename) {
+    return outputFilename.substr(0, outputFilename.find_last_of('.')) + ".pfm";
+}
+
+std::string get_checkpoint_filename(const std::string& outputFilename) {
+    return outputFilename + ".checkpoint";
+}
+
+std::shared_ptr<Camera> make_camera(int width, int height) {
+    std::shared_ptr<PerspectiveCamera> camera = std::make_shared<PerspectiveCamera>((float) width / height, 45.f);
     camera->SetZFar(1e20);
     return camera;
 }
 
+// Sun flare around (SUN_X, SUN_Y).
+class SunFlareStage : public PostProcessStage
+{
+public:
+    virtual void EvaluateRow(int width, int height, float y, float x0, float xStep, int count, glm::vec3* output) const override
+    {
+        const float dy = fabsf(y / height - SUN_Y);
+        const float flare_y = earth_pow(dy, 0.7f);
+        for (int i = 0; i < count; ++i) {
+            const float dx = fabsf(((x0 + i * xStep) / width - SUN_X) * 0.8f);
+            float flare = 1.f / FastMath::MaxNonNegative(0.01f, earth_pow(dx, 0.7f) + flare_y);
+            float funnysig = 1.f - 1.f / (1.f + earth_exp(-6.f * sqrtf(dx * dx + dy * dy) + 6.f));
+            output[i] = (0.2f * flare * funnysig) * glm::vec3(0.6f, 0.7f, 0.8f);
+        }
+    }
+
+    virtual int GetDownsampleFactor() const override { return FLARE_DOWNSAMPLE; }
+
+    virtual void GetFullResolutionBands(int width, int height, glm::ivec2& rows, glm::ivec2& columns) const override
+    {
+        const int sunRow = static_cast<int>(SUN_Y * height);
+        const int sunColumn = static_cast<int>(SUN_X * width);
+        rows = glm::ivec2(sunRow - FLARE_EXACT_RADIUS, sunRow + FLARE_EXACT_RADIUS + 1);
+        columns = glm::ivec2(sunColumn - FLARE_EXACT_RADIUS, sunColumn + FLARE_EXACT_RADIUS + 1);
+    }
+};
+
+// Glow of the atmosphere around the earth, behind the station. It ends sharply at the limb, so it is evaluated for
+// every pixel, from the same rays as the camera's: before normalization those are affine in the pixel coordinates.
+class EarthHaloStage : public PostProcessStage
+{
+public:
+    explicit EarthHaloStage(const Camera& camera) :
+        origin(camera.GetPosition())
+    {
+        const glm::vec3 forward = glm::vec3(camera.GetForwardDirection());
+        auto planeTarget = [&](glm::vec2 coordinates) {
+            const glm::vec3 direction = camera.GenerateRayForNormalizedCoordinates(coordinates)->GetRayDirection();
+            return direction / glm::dot(direction, forward);
+        };
+        topLeft = planeTarget(glm::vec2(0.f, 0.f));
+        right = planeTarget(glm::vec2(1.f, 0.f)) - topLeft;
+        down = planeTarget(glm::vec2(0.f, 1.f)) - topLeft;
+    }
+
+    virtual void EvaluateRow(int width, int height, float y, float x0, float xStep, int count, glm::vec3* output) const override
+    {
+        // Written out per component in locals, which unlike the glm vector functions and members vectorizes.
+        const glm::vec3 magic_pos_raysp = glm::vec3(EX, EY, EZ) - origin;
+        const glm::vec3 rowStart = topLeft + (y / height) * down;
+        const glm::vec3 rowStep = right;
+        for (int i = 0; i < count; ++i) {
+            const float u = (x0 + i * xStep) / width;
+            const float dirX = rowStart.x + u * rowStep.x;
+            const float dirY = rowStart.y + u * rowStep.y;
+            const float dirZ = rowStart.z + u * rowStep.z;
+            const float dirLength2 = dirX * dirX + dirY * dirY + dirZ * dirZ;
+            // Distance of the earth's centre from the ray, as in magic_intersect.
+            const float along = magic_pos_raysp.x * dirX + magic_pos_raysp.y * dirY + magic_pos_raysp.z * dirZ;
+            const float diffX = magic_pos_raysp.x - along * dirX / dirLength2;
+            const float diffY = magic_pos_raysp.y - along * dirY / dirLength2;
+            const float diffZ = magic_pos_raysp.z - along * dirZ / dirLength2;
+            const float atmo = (sqrtf(diffX * diffX + diffY * diffY + diffZ * diffZ) - ER) / 100.f;
+            // The absolute value keeps the exponential finite where the halo is masked off.
+            const float halo = FastMath::MaskPositive(atmo, 2.f * earth_exp(-fabsf(atmo) * 3.f));
+            output[i] = halo * glm::vec3(0.3f, 0.5f, 0.8f);
+        }
+    }
+
+    virtual bool IsHiddenByCoverage() const override { return true; }
+
+private:
+    glm::vec3 origin;
+    glm::vec3 topLeft;
+    glm::vec3 right;
+    glm::vec3 down;
+};
+
 std::shared_ptr<SceneObject> make_soyuz() {
     std::shared_ptr<BlinnPhongMaterial> material = std::make_shared<BlinnPhongMaterial>();
     material->SetDiffuse(glm::vec3(1.f, 1.f, 1.f) * .5f);
     material->SetSpecular(glm::vec3(1.f, 1.f, 1.f) * .8f, 0.5f);
-    material->SetTexture("diffuseTexture", TextureLoader::LoadTexture("soyuz/Soyuz Diffuse Color.png"));
+    material->SetTexture("diffuseTexture", TextureLoader::LoadTextureAsync("soyuz/Soyuz Diffuse Color.png"));
 
     std::vector<std::shared_ptr<MeshObject>> mesh = MeshLoader::LoadMesh("soyuz/soyuz.obj");
     for (auto m: mesh) m->SetMaterial(material);
@@ -176,13 +524,38 @@ std::shared_ptr<SceneObject> make_iss() {
     return object;
 }
 
-std::shared_ptr<Scene> make_scene(glm::vec3 sunpos) {
+// Returns the earth sphere's primitive in earthPrimitive.
+std::shared_ptr<SceneObject> make_earth(const PrimitiveBase*& earthPrimitive) {
+    // Only reflections and shadows see this material. Camera rays that hit the earth get magic_intersect's shading.
+    std::shared_ptr<BlinnPhongMaterial> material = std::make_shared<BlinnPhongMaterial>();
+    material->SetDiffuse(glm::vec3(0.25f, 0.35f, 0.5f));
+    std::shared_ptr<MeshObject> mesh = std::make_shared<MeshObject>(material);
+    mesh->SetName("Earth");
+    std::shared_ptr<Sphere> sphere = std::make_shared<Sphere>(mesh.get(), ER);
+    mesh->AddPrimitive(sphere);
+    mesh->CreateAccelerationData(AccelerationTypes::NONE);
+    earthPrimitive = sphere.get();
+
+    std::shared_ptr<SceneObject> object = std::make_shared<SceneObject>();
+    object->AddMeshObject(mesh);
+    object->SetName("Earth");
+    object->SetPosition(glm::vec3(EX, EY, EZ));
+    // Turns the sphere's poles onto the x axis and its u = 0.5 meridian onto +y, where the earth textures have
+    // their poles and the 0.235 meridian.
+    object->Rotate(glm::normalize(glm::vec3(1.f, 1.f, 1.f)), -2.f * PI / 3.f);
+    object->CreateAccelerationData(AccelerationTypes::NONE);
+    return object;
+}
+
+std::shared_ptr<Scene> make_scene(glm::vec3 sunpos, const PrimitiveBase*& earthPrimitive) {
+    PROFILE_ZONE(zone, "Build Scene");
     std::shared_ptr<SceneObject> iss = make_iss();
     std::shared_ptr<SceneObject> soyuz = make_soyuz();
 
     std::shared_ptr<Scene> scene = std::make_shared<Scene>();
     scene->AddSceneObject(iss);
     scene->AddSceneObject(soyuz);
+    scene->AddSceneObject(make_earth(earthPrimitive));
     scene->GenerateAccelerationData(AccelerationTypes::BVH);
 
     // Lights
@@ -201,123 +574,668 @@ std::shared_ptr<Scene> make_scene(glm::vec3 sunpos) {
     return scene;
 }
 
+RayTracer::RayTracer():
+    width(WIDTH), height(HEIGHT), threadCount(0), cloudTolerance(0.f), outputFilename("output.png"), samplesPerPixel(1), srgbOutput(false), streamingOutput(false), checkpointing(false), resumeRender(false), progressive(false), progressiveTimeBudget(0.f), progressiveTargetChange(0.f), photonCount(0), photonGatherCount(0), photonGatherRadius(0.f), finalGatherRays(0), lastRenderSeconds(0.0), earthPrimitive(nullptr)
+{
+}
+
+void RayTracer::SetResolution(int inputWidth, int inputHeight)
+{
+    width = inputWidth;
+    height = inputHeight;
+}
+
+void RayTracer::SetThreadCount(int input)
+{
+    threadCount = input;
+}
+
+void RayTracer::SetCloudTolerance(float input)
+{
+    cloudTolerance = input;
+}
+
+void RayTracer::SetOutputFilename(const std::string& input)
+{
+    outputFilename = input;
+}
+
+void RayTracer::SetToneMapper(std::shared_ptr<ToneMapper> input)
+{
+    toneMapper = std::move(input);
+}
+
+void RayTracer::SetSRGBOutput(bool input)
+{
+    srgbOutput = input;
+}
+
+void RayTracer::SetStreamingOutput(bool input)
+{
+    streamingOutput = input;
+}
+
+void RayTracer::SetSampler(std::shared_ptr<ColorSampler> input, int inputSamplesPerPixel)
+{
+    sampler = std::move(input);
+    samplesPerPixel = std::max(1, inputSamplesPerPixel);
+}
+
+void RayTracer::SetProgressive(bool input, float timeBudgetSeconds, float targetChange)
+{
+    progressive = input;
+    progressiveTimeBudget = timeBudgetSeconds;
+    progressiveTargetChange = targetChange;
+}
+
+void RayTracer::SetCheckpointing(bool input, bool resume)
+{
+    checkpointing = input;
+    resumeRender = input && resume;
+}
+
+void RayTracer::SetPhotonMapping(size_t storedPhotons, int gatherPhotons, float gatherRadius, int gatherRays)
+{
+    photonCount = storedPhotons;
+    photonGatherCount = gatherPhotons;
+    photonGatherRadius = gatherRadius;
+    finalGatherRays = gatherRays;
+    renderer.reset();
+}
+
+void RayTracer::EnableAOV(ImageAOV aov)
+{
+    if (std::find(aovs.begin(), aovs.end(), aov) == aovs.end()) {
+        aovs.push_back(aov);
+    }
+}
+
+void RayTracer::SetScene(std::shared_ptr<Scene> input, const std::string& description)
+{
+    scene = std::move(input);
+    sceneDescription = description;
+    renderer.reset();
+    earthPrimitive = nullptr;
+}
+
 void RayTracer::Run()
 {
-    std::shared_ptr<Camera> camera = make_camera();
+    Initialize();
+    Render();
+}
+
+void RayTracer::Initialize()
+{
+    // Only the built-in scene has the earth; a scene from SetScene needs neither its textures nor the atmosphere.
+    const bool hasEarth = !scene || earthPrimitive;
+
+    // Decode the earth textures while the meshes load and the acceleration structures build.
+    std::vector<TextureLoader::TextureFuture> earthTextures;
+    if (hasEarth && !eland) {
+        earthTextures.push_back(load_earth_texture("earth/land.jpg", EARTH_COLOR_FORMAT));
+        earthTextures.push_back(load_earth_texture("earth/water.jpg", TextureFormat::R8));
+        earthTextures.push_back(load_earth_texture("earth/cloud.W.jpg" /*"earth/cloud.W.2001210.21600x21600.jpg"*/, EARTH_COLOR_FORMAT));
+        // The normals are stored around 0.5 and are not unit length, so RG8 reconstruction does not apply.
+        earthTextures.push_back(load_earth_texture("earth/cloud.W.normal.png", TextureFormat::RGB8));
+        earthTextures.push_back(load_earth_texture("earth/cloud.E.jpg", EARTH_COLOR_FORMAT));
+        earthTextures.push_back(load_earth_texture("earth/cloud.E.normal.png", TextureFormat::RGB8));
+    }
+#if EARTH_MATH_ACCURACY
+    if (hasEarth && atmosphereTable.IsEmpty()) {
+        atmosphereTable = make_atmosphere_table();
+    }
+#endif
+
+    if (!scene) {
+        std::shared_ptr<Camera> camera = make_camera(width, height);
+        glm::vec2 sun_coords = glm::vec2(SUN_X, SUN_Y);
+        const PrimitiveBase* earth = nullptr;
+        SetScene(make_scene(camera->GenerateRayForNormalizedCoordinates(sun_coords)->GetRayPosition(10000), earth), "station");
+        earthPrimitive = earth;
+    }
+
+    if (!earthTextures.empty()) {
+        PROFILE_ZONE(textureZone, "Wait For Earth Textures");
+        eland = earthTextures[0].get();
+        wmask = earthTextures[1].get();
+        eclou[0] = earthTextures[2].get();
+        eclou_normal[0] = earthTextures[3].get();
+        eclou[1] = earthTextures[4].get();
+        eclou_normal[1] = earthTextures[5].get();
+        std::cout << "Earth textures loaded" << std::endl;
+    }
+}
+
+void RayTracer::Render()
+{
+    assert(scene);
+    if (!renderer) {
+        if (photonCount > 0) {
+            PhotonMappingRenderer::Settings photonSettings;
+            photonSettings.storedPhotons = photonCount;
+            if (photonGatherCount > 0) {
+                photonSettings.gatherPhotons = photonGatherCount;
+            }
+            photonSettings.maxGatherRadius = photonGatherRadius;
+            photonSettings.finalGatherRays = finalGatherRays;
+            renderer = std::make_shared<PhotonMappingRenderer>(scene, photonSettings);
+        } else {
+            renderer = std::make_shared<BackwardRenderer>(scene);
+        }
+        renderer->InitializeRenderer();
+    }
+    std::shared_ptr<Camera> camera = make_camera(width, height);
 
     glm::vec2 sun_coords = glm::vec2(SUN_X, SUN_Y);
     glm::vec3 sun_dir = glm::normalize(camera->GenerateRayForNormalizedCoordinates(sun_coords)->GetRayDirection());
     float sun_int = 8.f;
 
-    std::shared_ptr<Scene> scene = make_scene(camera->GenerateRayForNormalizedCoordinates(sun_coords)->GetRayPosition(10000));
-    std::shared_ptr<Renderer> renderer = std::make_shared<BackwardRenderer>(scene);
-
-    std::cout << "land" << std::endl;
-    eland = TextureLoader::LoadTexture("earth/land.jpg");
-    std::cout << "water" << std::endl;
-    wmask = TextureLoader::LoadTexture("earth/water.jpg");
-    std::cout << "W" << std::endl;
-    eclou[0] = TextureLoader::LoadTexture("earth/cloud.W.jpg" /*"earth/cloud.W.2001210.21600x21600.jpg"*/);
-    eclou_normal[0] = TextureLoader::LoadTexture("earth/cloud.W.normal.png");
-    std::cout << "E" << std::endl;
-    eclou[1] = TextureLoader::LoadTexture("earth/cloud.E.jpg");
-    eclou_normal[1] = TextureLoader::LoadTexture("earth/cloud.E.normal.png");
-    std::cout << "done" << std::endl;
+    const int workerCount = (threadCount > 0) ? threadCount : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
 
     // Prepare for Output
-    ImageWriter imageWriter("output.png", WIDTH, HEIGHT);
-
-    for (int r = 0; r < HEIGHT; ++r) {
-        for (int c = 0; c < WIDTH; ++c) {
-            glm::vec3 sampleColor;
-
-            glm::vec2 normalizedCoordinates((float) c / WIDTH, (float) r / HEIGHT);
-            std::shared_ptr<Ray> cameraRay = camera->GenerateRayForNormalizedCoordinates(normalizedCoordinates);
-            assert(cameraRay);
-
-            // Solar flare brightness. Drawn at the end.
-            float x = c;
-            float y = r;
-            glm::vec2 flaredist = glm::abs(glm::vec2((x / WIDTH - SUN_X) * 0.8f, y / HEIGHT - SUN_Y));
-            float flare = 1.f / glm::max(0.01f, powf(flaredist.x, 0.7) + powf(flaredist.y, 0.7f));
-            float funnysig = 1.f - 1.f / (1.f + expf(-6 * glm::length(flaredist) + 6));
-            flare *= funnysig;
-
-            // Sample sphere.
-            MagicIntersection mi = magic_intersect(cameraRay.get());
-
-            glm::vec3 ray_dir = glm::normalize(cameraRay->GetRayDirection());
-
-            if (mi.intersected) {
-                glm::vec3 landColor = magic_hugeland(mi.uv);
-                
-                // exposure comp
-                float expo = sun_int * glm::max(0.f, glm::dot(mi.normal, sun_dir) + 0.1f); //expf(-1.f + 0.4 * powf(1.f - glm::dot(mi.normal, -ray_dir), 3.f));
-                landColor *= expo;
-
-                float surf_dot = glm::dot(ray_dir, mi.normal);
-                float spec = glm::max(0.f, powf(glm::dot(sun_dir, ray_dir - surf_dot * mi.normal), 15.f));
-                float watery = magic_watermask(mi.uv);
-                float fresnel = glm::max(powf(1.03f + surf_dot, 7.f), 0.f);
-
-                sampleColor += landColor;
-                sampleColor += watery * (fresnel + 0.7f * spec) * glm::vec3(0.8f, 0.9f, 1.f);
-
-                for (int i = 1; i <= 100; i += 1) {
-                    glm::vec2 ofs = (float) i * glm::vec2(0.015, 0.05);
-                    glm::vec3 right(1.f, 0.f, 0.f);
-                    glm::vec3 back = glm::cross(right, mi.normal);
-                    glm::mat3 cloutrans = glm::mat3(back, right, mi.normal);
-                    glm::vec3 cloudColor = magic_clouds(mi.uv + ofs);
-                    float cloudAlpha = powf((cloudColor.r + cloudColor.g + cloudColor.b) / 3.f, 0.6f);
-                    cloudColor *= glm::vec3(0.7f, 0.9f, 1.f);
-                    glm::vec3 cloudNormal = cloutrans * magic_cloudnormal(mi.uv + ofs);
-                    float clou_dot = glm::dot(cloudNormal, ray_dir);
-                    float cloudiff = powf(glm::max(0.f, glm::dot(cloudNormal, sun_dir) + 0.5f), 2.f);
-                    float clouspec = spec + glm::max(0.f, powf(glm::dot(sun_dir, ray_dir - clou_dot * mi.normal), 15.f));
-                    float cloufresnel = powf(1.f + surf_dot + clou_dot, 8.f);
-                    // float cloud_expo = 2.f * cloudiff * cloufresnel + 2.f * cloufresnel + fresnel + 2.f * clouspec;
-                    float cloud_expo = 1.f * (spec + fresnel) * (cloudiff + cloufresnel + clouspec);
-                    cloudColor *= (0.5f + 0.5f * i / 100.f) * cloud_expo;
-                    cloudColor += glm::clamp(5.f * powf(spec, 0.2) * (cloudiff + cloufresnel) - 2.f, 0.f, 1.f) * glm::vec3(1.f, .85f, .6f);
-                    sampleColor += cloudAlpha * (cloudColor - sampleColor);
+    std::vector<std::shared_ptr<PostProcessStage>> postProcessStages;
+    postProcessStages.push_back(std::make_shared<SunFlareStage>());
+    if (earthPrimitive) {
+        postProcessStages.push_back(std::make_shared<EarthHaloStage>(*camera));
+    }
+    auto createImageWriter = [&]() {
+        std::unique_ptr<ImageWriter> writer(new ImageWriter(outputFilename, width, height));
+        writer->SetToneMapper(toneMapper);
+        writer->SetSRGBEncoding(srgbOutput);
+        for (const auto& stage : postProcessStages) {
+            writer->AddPostProcessStage(stage);
+        }
+        return writer;
+    };
+    const bool progressiveRender = progressive && !streamingOutput && !checkpointing;
+    if (progressive && !progressiveRender) {
+        std::cout << "Progressive rendering does not work with streaming or checkpoints, rendering in one pass" << std::endl;
+    }
+    if (sampler && !progressiveRender && sampler->GetMaxSampleCount(samplesPerPixel, 2) != samplesPerPixel) {
+        std::cout << "The sampler takes up to " << sampler->GetMaxSampleCount(samplesPerPixel, 2) << " samples per pixel instead of " << samplesPerPixel << std::endl;
+    }
+    std::unique_ptr<ImageWriter> imageWriter;
+    std::unique_ptr<StreamingImageWriter> streamingWriter;
+    if (streamingOutput) {
+        // Each band is one row of tiles. Workers take tiles in order, so two bands per worker leave room for slow tiles.
+        streamingWriter.reset(new StreamingImageWriter(get_streaming_filename(outputFilename), width, height, TILE_SIZE, 2 * workerCount));
+        if (!streamingWriter->IsOpen()) {
+            return;
+        }
+        for (const auto& stage : postProcessStages) {
+            streamingWriter->AddPostProcessStage(stage);
+        }
+    } else {
+        imageWriter = createImageWriter();
+        for (ImageAOV aov : aovs) {
+            imageWriter->EnableAOV(aov);
+        }
+#if OUTPUT_COST_IMAGES
+        imageWriter->EnableCostOutput();
+#endif
+    }
+    // The checkpoint stores the color and the enabled AOVs of each pixel, the latter as the layers after the color.
+    std::unique_ptr<RenderCheckpoint> checkpoint;
+    std::vector<ImageAOV> checkpointAOVs;
+    if (checkpointing) {
+        uint32_t aovMask = 0;
+        for (int aov = 0; imageWriter && aov < static_cast<int>(ImageAOV::COUNT); ++aov) {
+            if (imageWriter->IsAOVEnabled(static_cast<ImageAOV>(aov))) {
+                checkpointAOVs.push_back(static_cast<ImageAOV>(aov));
+                aovMask |= 1u << aov;
+            }
+        }
+        // Everything besides the size and the layers that changes the pixels.
+        std::ostringstream settings;
+        settings << "scene " << sceneDescription << "; sampler " << (sampler ? sampler->GetDescription() : "none") << " samples " << samplesPerPixel
+            << "; photons " << photonCount << " gather " << photonGatherCount << " radius " << photonGatherRadius << " final gather " << finalGatherRays
+            << "; cloud tolerance " << cloudTolerance;
+        checkpoint.reset(new RenderCheckpoint(get_checkpoint_filename(outputFilename), width, height, TILE_SIZE, 1 + static_cast<int>(checkpointAOVs.size()), aovMask, settings.str(), CHECKPOINT_INTERVAL_SECONDS));
+        if (!checkpoint->Open(resumeRender)) {
+            return;
+        }
+        if (checkpoint->GetDoneTileCount() > 0) {
+            std::cout << "Resuming with " << checkpoint->GetDoneTileCount() << " of " << checkpoint->GetTileCount() << " tiles done" << std::endl;
+        }
+    }
+    // Totals of the workers' cloud statistics.
+    CloudStatistics cloudStatistics;
+    std::mutex cloudStatisticsMutex;
+    auto mergeCloudStatistics = [&](const CloudStatistics& workerStatistics) {
+        std::lock_guard<std::mutex> lock(cloudStatisticsMutex);
+        cloudStatistics.Merge(workerStatistics);
+    };
+
+    // Traces and shades the camera ray through (x, y) in pixels, where pixel (c, r) is centered on (c, r). Only center
+    // samples add to the cloud statistics, in workerStatistics; other samples pass null. aovValues, if not null,
+    // receives the value of each AOV.
+    auto traceSample = [&](float x, float y, CloudStatistics* workerStatistics, uint8_t& covered, glm::vec3* aovValues) {
+        glm::vec3 sampleColor;
+
+        glm::vec2 normalizedCoordinates(x / width, y / height);
+        std::shared_ptr<Ray> cameraRay = camera->GenerateRayForNormalizedCoordinates(normalizedCoordinates, glm::vec2(1.f / width, 1.f / height));
+        assert(cameraRay);
+
+        // Sample scene. The earth is part of it, but gets its own shading below instead of the renderer's.
+        IntersectionState rayIntersection(1, 0);
+        rayIntersection.remainingReflectionBounces = 5;
+        bool didHitScene;
+        {
+            DIAGNOSTICS_PHASE(tracePhase, DiagnosticsPhase::PRIMARY_TRACING);
+            didHitScene = scene->Trace(cameraRay.get(), &rayIntersection);
+        }
+        const bool didHitEarth = didHitScene && rayIntersection.intersectedPrimitive == earthPrimitive;
+
+        // Sample sphere.
+        MagicIntersection mi = magic_intersect(cameraRay.get(), didHitEarth ? &rayIntersection : nullptr);
+
+        glm::vec3 ray_dir = glm::normalize(cameraRay->GetRayDirection());
+        glm::vec3 earthAlbedo;
+
+        if (mi.intersected) {
+            DIAGNOSTICS_PHASE(earthPhase, DiagnosticsPhase::EARTH_SHADING);
+            glm::vec3 landColor = magic_hugeland(mi.uv, mi.duvdx, mi.duvdy);
+            earthAlbedo = landColor;
+            
+            // exposure comp
+            float expo = sun_int * glm::max(0.f, glm::dot(mi.normal, sun_dir) + 0.1f); //expf(-1.f + 0.4 * powf(1.f - glm::dot(mi.normal, -ray_dir), 3.f));
+            landColor *= expo;
+
+            float surf_dot = glm::dot(ray_dir, mi.normal);
+            float spec_dot = glm::dot(sun_dir, ray_dir - surf_dot * mi.normal);
+            float spec = surface_spec(spec_dot);
+            float watery = magic_watermask(mi.uv, mi.duvdx, mi.duvdy);
+            float fresnel = surface_fresnel(surf_dot);
+
+            sampleColor += landColor;
+            sampleColor += watery * (fresnel + 0.7f * spec) * glm::vec3(0.8f, 0.9f, 1.f);
+
+            const CloudLighting cloudLighting = make_cloud_lighting(mi, ray_dir, sun_dir, surf_dot, spec, fresnel);
+            const glm::vec3 groundColor = sampleColor;
+            int cloudLayers = 0;
+            sampleColor = composite_cloud_layers_adaptive(mi, cloudLighting, groundColor, cloudTolerance, cloudLayers);
+            if (workerStatistics) {
+                if (cloudTolerance > 0.f && workerStatistics->earthPixels % CLOUD_ERROR_SAMPLE_INTERVAL == 0) {
+                    const glm::vec3 referenceColor = composite_cloud_layers(mi, cloudLighting, groundColor);
+                    const float error = glm::length(sampleColor - referenceColor);
+                    ++workerStatistics->checkedPixels;
+                    workerStatistics->errorSum += error;
+                    workerStatistics->referenceSum += glm::length(referenceColor);
+                    workerStatistics->maxError = std::max(workerStatistics->maxError, error);
+                }
+                ++workerStatistics->earthPixels;
+                workerStatistics->layerSum += cloudLayers;
+            }
+
+            float atmothick = earth_exp(mi.atmo / 4.f);
+#if EARTH_MATH_ACCURACY
+            glm::vec3 atmocol = atmosphereTable.Sample(surf_dot, spec_dot);
+#else
+            glm::vec3 atmocol = atmosphere_color(fresnel, spec);
+#endif
+            atmocol += earth_exp(mi.atmo * 8.f) * glm::vec3(1.f, 1.f, 1.f);
+            sampleColor += atmothick * (atmocol - sampleColor);
+        }
+
+        // Use the intersection data to compute the BRDF response.
+        if (didHitScene && !didHitEarth) {
+            sampleColor = renderer->ComputeSampleColor(rayIntersection, *cameraRay.get());
+        }
+
+        // The halo and the sun flare are added by the post-process stages.
+        covered = didHitScene && !didHitEarth;
+
+        if (aovValues) {
+            // Camera rays are normalized, so the hit distance is the depth along the ray.
+            const float depth = didHitScene ? rayIntersection.intersectionT : std::numeric_limits<float>::infinity();
+            glm::vec3 normal;
+            glm::vec3 albedo;
+            if (didHitEarth) {
+                normal = mi.normal;
+                albedo = earthAlbedo;
+            } else if (didHitScene) {
+                normal = rayIntersection.ComputeNormal();
+                albedo = rayIntersection.intersectedPrimitive->GetParentMeshObject()->GetMaterial()->ComputeAlbedo(rayIntersection);
+            }
+            aovValues[static_cast<int>(ImageAOV::DEPTH)] = glm::vec3(depth);
+            aovValues[static_cast<int>(ImageAOV::NORMAL)] = normal;
+            aovValues[static_cast<int>(ImageAOV::ALBEDO)] = albedo;
+        }
+        return sampleColor;
+    };
+
+    auto renderPixel = [&](int c, int r, uint8_t& covered, CloudStatistics& workerStatistics) {
+#if OUTPUT_COST_IMAGES
+        const DiagnosticsCounters pixelStartStats = Diagnostics::Get()->GetThreadStats();
+        const auto pixelStartTime = std::chrono::high_resolution_clock::now();
+#endif
+        const bool hasAOVs = imageWriter && imageWriter->HasAOVs();
+        glm::vec3 aovValues[static_cast<int>(ImageAOV::COUNT)];
+        const glm::vec3 sampleColor = traceSample(static_cast<float>(c), static_cast<float>(r), &workerStatistics, covered, hasAOVs ? aovValues : nullptr);
+        for (int aov = 0; hasAOVs && aov < static_cast<int>(ImageAOV::COUNT); ++aov) {
+            if (imageWriter->IsAOVEnabled(static_cast<ImageAOV>(aov))) {
+                imageWriter->SetPixelAOV(static_cast<ImageAOV>(aov), aovValues[aov], c, r);
+            }
+        }
+
+#if OUTPUT_COST_IMAGES
+        const DiagnosticsCounters& pixelEndStats = Diagnostics::Get()->GetThreadStats();
+        const std::chrono::duration<float> pixelTime = std::chrono::high_resolution_clock::now() - pixelStartTime;
+        auto statDelta = [&](DiagnosticsType type) {
+            const size_t index = static_cast<size_t>(type);
+            return static_cast<float>(pixelEndStats[index] - pixelStartStats[index]);
+        };
+        if (imageWriter) {
+            imageWriter->SetPixelCost(glm::vec4(statDelta(DiagnosticsType::NODES_VISITED), statDelta(DiagnosticsType::TRIANGLE_INTERSECTIONS), statDelta(DiagnosticsType::RAYS_CREATED), pixelTime.count()), c, r);
+        }
+#endif
+        return sampleColor;
+    };
+
+    const int tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    const int tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+    const int totalTiles = tilesX * tilesY;
+    std::atomic<int> nextTile(0);
+    const auto renderStartTime = std::chrono::high_resolution_clock::now();
+
+    // Lets the sampler add samples to the pixels of a tile. Samplers that use the neighbourhood judge from the center
+    // samples in tileColors and around the tile, which are traced again into neighbourhoodColors; the others
+    // supersample every pixel, and the border is not traced.
+    std::atomic<int> supersampledPixels(0);
+    const bool usesNeighbourhood = sampler && sampler->UsesNeighbourhood();
+    auto supersampleTile = [&](int startC, int startR, int tileWidth, int tileHeight, std::vector<glm::vec3>& tileColors, std::vector<glm::vec3>& neighbourhoodColors) {
+        const int paddedWidth = tileWidth + 2;
+        neighbourhoodColors.resize(usesNeighbourhood ? paddedWidth * (tileHeight + 2) : 0);
+        for (int pr = 0; usesNeighbourhood && pr < tileHeight + 2; ++pr) {
+            for (int pc = 0; pc < paddedWidth; ++pc) {
+                const int c = glm::clamp(startC + pc - 1, 0, width - 1);
+                const int r = glm::clamp(startR + pr - 1, 0, height - 1);
+                if (c >= startC && c < startC + tileWidth && r >= startR && r < startR + tileHeight) {
+                    neighbourhoodColors[pr * paddedWidth + pc] = tileColors[(r - startR) * tileWidth + (c - startC)];
+                } else {
+                    uint8_t covered;
+                    neighbourhoodColors[pr * paddedWidth + pc] = traceSample(static_cast<float>(c), static_cast<float>(r), nullptr, covered, nullptr);
                 }
+            }
+        }
 
-                float atmothick = expf(mi.atmo / 4.0);
-                glm::vec3 batmocol = 1.4f * powf(fresnel, .4f) * glm::vec3(0.45f, 0.5f, 0.65f) + expf(mi.atmo * 8.f) * glm::vec3(1.f, 1.f, 1.f);
-                glm::vec3 ratmocol = 1.4f * powf(fresnel, .4f) * glm::vec3(0.7f, 0.6f, 0.5f) + expf(mi.atmo * 8.f) * glm::vec3(1.f, 1.f, 1.f);
-                float coeff = powf(spec, 0.8f);
-                glm::vec3 atmocol = coeff * ratmocol + (1.f - coeff) * batmocol;
-                sampleColor += atmothick * (atmocol - sampleColor);
+        int tileSupersampled = 0;
+        for (int r = startR; r < startR + tileHeight; ++r) {
+            for (int c = startC; c < startC + tileWidth; ++c) {
+                if (usesNeighbourhood) {
+                    glm::vec3 neighbourhood[9];
+                    for (int i = 0; i < 9; ++i) {
+                        neighbourhood[i] = neighbourhoodColors[(r - startR + i / 3) * paddedWidth + (c - startC + i % 3)];
+                    }
+                    if (!sampler->NeedsSupersampling(neighbourhood)) {
+                        continue;
+                    }
+                }
+                tileColors[(r - startR) * tileWidth + (c - startC)] = sampler->ComputeSamplesAndColor(samplesPerPixel, 2, static_cast<uint32_t>(r * width + c), [&](glm::vec3 offset) {
+                    uint8_t covered;
+                    return traceSample(c + offset.x, r + offset.y, nullptr, covered, nullptr);
+                }, glm::vec3(-0.5f, -0.5f, 0.f), glm::vec3(0.5f, 0.5f, 0.f));
+                ++tileSupersampled;
+            }
+        }
+        supersampledPixels += tileSupersampled;
+    };
+
+    auto renderTiles = [&]() {
+        std::vector<glm::vec3> tileColors(TILE_SIZE * TILE_SIZE);
+        std::vector<uint8_t> tileCoverage(TILE_SIZE * TILE_SIZE);
+        std::vector<glm::vec3> neighbourhoodColors;
+        CloudStatistics workerStatistics;
+        for (int tile = nextTile++; tile < totalTiles; tile = nextTile++) {
+            PROFILE_ZONE(tileZone, "Render Tile");
+            const int startC = (tile % tilesX) * TILE_SIZE;
+            const int startR = (tile / tilesX) * TILE_SIZE;
+            const int tileWidth = std::min(TILE_SIZE, width - startC);
+            const int tileHeight = std::min(TILE_SIZE, height - startR);
+            const bool restored = checkpoint && checkpoint->IsTileDone(tile);
+            for (int r = startR; r < startR + tileHeight; ++r) {
+                for (int c = startC; c < startC + tileWidth; ++c) {
+                    const int index = (r - startR) * tileWidth + (c - startC);
+                    if (restored) {
+                        tileColors[index] = checkpoint->GetPixel(0, c, r);
+                        tileCoverage[index] = checkpoint->GetPixelCoverage(c, r);
+                        for (size_t layer = 0; layer < checkpointAOVs.size(); ++layer) {
+                            imageWriter->SetPixelAOV(checkpointAOVs[layer], checkpoint->GetPixel(static_cast<int>(layer) + 1, c, r), c, r);
+                        }
+                        continue;
+                    }
+                    tileColors[index] = renderPixel(c, r, tileCoverage[index], workerStatistics);
+                }
+            }
+            if (sampler && !restored) {
+                supersampleTile(startC, startR, tileWidth, tileHeight, tileColors, neighbourhoodColors);
+            }
+            if (checkpoint && !restored) {
+                for (int r = startR; r < startR + tileHeight; ++r) {
+                    for (int c = startC; c < startC + tileWidth; ++c) {
+                        const int index = (r - startR) * tileWidth + (c - startC);
+                        checkpoint->SetPixel(0, c, r, tileColors[index]);
+                        checkpoint->SetPixelCoverage(c, r, tileCoverage[index] != 0);
+                        for (size_t layer = 0; layer < checkpointAOVs.size(); ++layer) {
+                            checkpoint->SetPixel(static_cast<int>(layer) + 1, c, r, imageWriter->GetPixelAOV(checkpointAOVs[layer], c, r));
+                        }
+                    }
+                }
+                checkpoint->MarkTileDone(tile);
             }
 
-            // Halo
-            if (mi.atmo > 0) {
-                sampleColor += 2.f * expf(-mi.atmo * 3.f) * glm::vec3(0.3f, 0.5f, 0.8f);
+            if (streamingWriter) {
+                streamingWriter->SubmitTile(startC, startR, tileWidth, tileHeight, tileColors.data(), tileCoverage.data());
+                continue;
+            }
+            for (int r = startR; r < startR + tileHeight; ++r) {
+                for (int c = startC; c < startC + tileWidth; ++c) {
+                    const int index = (r - startR) * tileWidth + (c - startC);
+                    imageWriter->SetPixelColor(tileColors[index], c, r);
+                    imageWriter->SetPixelCoverage(tileCoverage[index] != 0, c, r);
+                }
+            }
+        }
+        mergeCloudStatistics(workerStatistics);
+    };
+
+    // Progressive rendering traces the pixels on a lattice with a spacing of block pixels in every tile, halving block
+    // every pass and skipping the pixels traced by earlier passes. In between, the lattices are upsampled.
+    std::vector<glm::vec3> progressiveSamples;
+    std::vector<uint8_t> progressiveCoverage;
+    std::vector<uint8_t> progressiveSampled;
+    // Spacing of the finest lattice finished in each tile.
+    std::vector<int> tileBlocks;
+    std::atomic<bool> pastDeadline(false);
+
+    auto renderProgressiveTiles = [&](int block, bool firstPass) {
+        CloudStatistics workerStatistics;
+        for (int tile = nextTile++; tile < totalTiles; tile = nextTile++) {
+            // The first pass always finishes, so that every pixel has samples to upsample.
+            const std::chrono::duration<float> elapsed = std::chrono::high_resolution_clock::now() - renderStartTime;
+            if (!firstPass && progressiveTimeBudget > 0.f && elapsed.count() > progressiveTimeBudget) {
+                pastDeadline = true;
+                break;
+            }
+            PROFILE_ZONE(tileZone, "Render Tile");
+            const int startC = (tile % tilesX) * TILE_SIZE;
+            const int startR = (tile / tilesX) * TILE_SIZE;
+            const int endC = std::min(startC + TILE_SIZE, width);
+            const int endR = std::min(startR + TILE_SIZE, height);
+            for (int r = startR; r < endR; r += block) {
+                for (int c = startC; c < endC; c += block) {
+                    const int index = r * width + c;
+                    if (!progressiveSampled[index]) {
+                        progressiveSamples[index] = renderPixel(c, r, progressiveCoverage[index], workerStatistics);
+                        progressiveSampled[index] = 1;
+                    }
+                }
             }
+            tileBlocks[tile] = block;
+        }
+        mergeCloudStatistics(workerStatistics);
+    };
+
+    // Index of the lattice sample at or before a pixel.
+    auto progressiveSource = [&](int c, int r) {
+        const int block = tileBlocks[(r / TILE_SIZE) * tilesX + c / TILE_SIZE];
+        return (r - r % block) * width + (c - c % block);
+    };
+
+    // Interpolates bilinearly between the lattice samples around each pixel, leaving out those not traced yet.
+    auto upsampleProgressive = [&](std::vector<glm::vec3>& output) {
+        for (int r = 0; r < height; ++r) {
+            for (int c = 0; c < width; ++c) {
+                const int block = tileBlocks[(r / TILE_SIZE) * tilesX + c / TILE_SIZE];
+                const int c0 = c - c % block;
+                const int r0 = r - r % block;
+                const float fc = static_cast<float>(c - c0) / block;
+                const float fr = static_cast<float>(r - r0) / block;
+                glm::vec3 sum;
+                float weightSum = 0.f;
+                for (int corner = 0; corner < 4; ++corner) {
+                    const int sc = c0 + (corner & 1) * block;
+                    const int sr = r0 + (corner >> 1) * block;
+                    if (sc >= width || sr >= height || !progressiveSampled[sr * width + sc]) {
+                        continue;
+                    }
+                    const float weight = ((corner & 1) ? fc : 1.f - fc) * ((corner >> 1) ? fr : 1.f - fr);
+                    sum += weight * progressiveSamples[sr * width + sc];
+                    weightSum += weight;
+                }
+                // The sample at (c0, r0) always has a nonzero weight.
+                output[r * width + c] = sum / weightSum;
+            }
+        }
+    };
 
-            // Sample scene.
-            IntersectionState rayIntersection(1, 0);
-            rayIntersection.remainingReflectionBounces = 5;
-            bool didHitScene = scene->Trace(cameraRay.get(), &rayIntersection);
+    auto copyProgressive = [&](ImageWriter& writer, const std::vector<glm::vec3>& colors) {
+        for (int r = 0; r < height; ++r) {
+            for (int c = 0; c < width; ++c) {
+                writer.SetPixelColor(colors[r * width + c], c, r);
+                writer.SetPixelCoverage(progressiveCoverage[progressiveSource(c, r)] != 0, c, r);
+            }
+        }
+    };
+
+    auto runWorkers = [&](const std::function<void()>& work) {
+        // The calling thread renders alongside the workers.
+        std::vector<std::thread> workers;
+        for (int i = 1; i < workerCount; ++i) {
+            workers.emplace_back([&work, i]() {
+                PROFILE_SET_THREAD_NAME("Render Worker " + std::to_string(i));
+                work();
+                DIAGNOSTICS_FLUSH_THREAD();
+            });
+        }
+        work();
+        for (size_t i = 0; i < workers.size(); ++i) {
+            workers[i].join();
+        }
+    };
+
+    if (progressiveRender) {
+        PROFILE_ZONE(renderZone, "Render");
+        progressiveSamples.resize(width * height);
+        progressiveCoverage.resize(width * height);
+        progressiveSampled.assign(width * height, 0);
+        tileBlocks.assign(totalTiles, PROGRESSIVE_START_BLOCK);
+        std::vector<glm::vec3> upsampled(width * height);
+        std::vector<glm::vec3> previous;
+        for (int block = PROGRESSIVE_START_BLOCK; block >= 1; block /= 2) {
+            nextTile = 0;
+            runWorkers([&]() { renderProgressiveTiles(block, block == PROGRESSIVE_START_BLOCK); });
+            upsampleProgressive(upsampled);
+
+            // How much the pass changed the image: the mean absolute change in luminance relative to the mean.
+            float change = std::numeric_limits<float>::infinity();
+            if (!previous.empty()) {
+                const glm::vec3 luminanceWeights(0.2126f, 0.7152f, 0.0722f);
+                double changeSum = 0.0;
+                double luminanceSum = 0.0;
+                for (size_t i = 0; i < upsampled.size(); ++i) {
+                    changeSum += fabsf(glm::dot(upsampled[i] - previous[i], luminanceWeights));
+                    luminanceSum += glm::dot(upsampled[i], luminanceWeights);
+                }
+                change = (luminanceSum > 0.0) ? static_cast<float>(changeSum / luminanceSum) : 0.f;
+            }
+            const std::chrono::duration<float> elapsed = std::chrono::high_resolution_clock::now() - renderStartTime;
+            std::cout << "Pass with 1 sample per " << block << "x" << block << " pixels done after " << elapsed.count() << " s";
+            if (!previous.empty()) {
+                std::cout << ", changing the image by " << change;
+            }
+            std::cout << (pastDeadline ? ", out of time" : "") << std::endl;
+            if (pastDeadline || block == 1 || change < progressiveTargetChange) {
+                break;
+            }
 
-            // Use the intersection data to compute the BRDF response.
-            if (didHitScene) {
-                sampleColor = renderer->ComputeSampleColor(rayIntersection, *cameraRay.get());
+            // Intermediate image, overwritten by the next pass.
+            std::unique_ptr<ImageWriter> preview = createImageWriter();
+            copyProgressive(*preview, upsampled);
+            preview->ApplyPostProcess();
+            preview->CopyHDRToBitmap();
+            preview->SaveImage();
+            previous = upsampled;
+        }
+
+        copyProgressive(*imageWriter, upsampled);
+        for (int aov = 0; aov < static_cast<int>(ImageAOV::COUNT); ++aov) {
+            if (!imageWriter->IsAOVEnabled(static_cast<ImageAOV>(aov))) {
+                continue;
+            }
+            for (int r = 0; r < height; ++r) {
+                for (int c = 0; c < width; ++c) {
+                    const int source = progressiveSource(c, r);
+                    imageWriter->SetPixelAOV(static_cast<ImageAOV>(aov), imageWriter->GetPixelAOV(static_cast<ImageAOV>(aov), source % width, source / width), c, r);
+                }
             }
+        }
+    } else {
+        PROFILE_ZONE(renderZone, "Render");
+        runWorkers(renderTiles);
+    }
+    lastRenderSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - renderStartTime).count();
+    if (sampler) {
+        std::cout << "Supersampled " << supersampledPixels << " of " << width * height << " pixels" << std::endl;
+    }
+    if (checkpoint) {
+        checkpoint->Flush();
+    }
 
-            // Sun flare.
-            sampleColor += 0.2f * (flare) * glm::vec3(0.6f, 0.7f, 0.8f);
+    if (cloudStatistics.earthPixels) {
+        const size_t earthPixels = cloudStatistics.earthPixels;
+        std::cout << "Cloud layers sampled per earth pixel: " << static_cast<double>(cloudStatistics.layerSum) / earthPixels
+            << " of " << CLOUD_LAYERS << " (tolerance " << cloudTolerance << ")" << std::endl;
+    }
+    if (cloudStatistics.checkedPixels && cloudStatistics.referenceSum > 0.0) {
+        const size_t checkedPixels = cloudStatistics.checkedPixels;
+        std::cout << "Cloud composite error over " << checkedPixels << " checked earth pixels: mean " << cloudStatistics.errorSum / checkedPixels
+            << " (" << 100.0 * cloudStatistics.errorSum / cloudStatistics.referenceSum << "% of the mean color), max " << cloudStatistics.maxError << std::endl;
+    }
 
-            imageWriter.SetPixelColor(sampleColor, c, r);
+    if (streamingWriter) {
+        if (streamingWriter->Finish()) {
+            std::cout << "Streamed " << get_streaming_filename(outputFilename) << ", holding up to " << streamingWriter->GetPeakOpenBands()
+                << " of " << tilesY << " bands at once" << std::endl;
+            if (checkpoint) {
+                checkpoint->Remove();
+            }
         }
+        return;
     }
 
-    // Now copy whatever is in the HDR data and store it in the bitmap that we will save (aka everything will get clamped to be [0.0, 1.0]).
-    imageWriter.CopyHDRToBitmap();
+    imageWriter->ApplyPostProcess();
+
+    // Now tone map whatever is in the HDR data and store it in the bitmap that we will save (aka everything will get clamped to be [0.0, 1.0]).
+    imageWriter->CopyHDRToBitmap();
 
-    // Save image.
-    imageWriter.SaveImage();
+    // Save image. The checkpoint is kept if that fails, so the render can be resumed to try again.
+    if (imageWriter->SaveImage() && checkpoint) {
+        checkpoint->Remove();
+    }
+#if OUTPUT_COST_IMAGES
+    imageWriter->SaveCostImages();
+#endif
 }
 
 // void RayTracer::Run()
@@ -2,7 +2,86 @@
 
 #include "common/common.h"
 
+// Defined in ImageWriter.h.
+enum class ImageAOV;
+
 class RayTracer {
 public:
+    RayTracer();
+
+    // Run is Initialize followed by Render. Initialize builds the scene and, for the built-in one, loads the earth
+    // textures once; Render can then be called repeatedly, e.g. with different resolutions or thread counts.
     void Run();
+    void Initialize();
+    void Render();
+
+    void SetResolution(int inputWidth, int inputHeight);
+    // Number of threads used to render tiles. 0 uses one thread per hardware thread.
+    void SetThreadCount(int input);
+    // Lets the earth's per-layer cloud loop stop once the layers in front pass less than this fraction of the light
+    // behind them, and merge layers where the pixel footprint is large. 0 composites every layer. The merging is not
+    // bounded by the tolerance, so the render reports the error it measured against the full loop.
+    void SetCloudTolerance(float input);
+    void SetOutputFilename(const std::string& input);
+    // Tone mapping operator applied to the output, none by default, which clamps.
+    void SetToneMapper(std::shared_ptr<class ToneMapper> input);
+    // Stores the output sRGB encoded instead of linearly.
+    void SetSRGBOutput(bool input);
+    // Writes the output as a float PFM, band by band while rendering, instead of keeping the whole frame for an 8-bit
+    // image. Tone mapping and sRGB encoding do not apply.
+    void SetStreamingOutput(bool input);
+    // Takes one sample at the center of each pixel, then lets the sampler resample the pixels it picks with up to
+    // samplesPerPixel samples, or fewer if the sampler cannot take that many (see ColorSampler::GetMaxSampleCount),
+    // which Render reports. No sampler by default. Progressive renders are not supersampled.
+    void SetSampler(std::shared_ptr<class ColorSampler> input, int samplesPerPixel);
+    // Renders in passes, starting with one sample per 16x16 pixels and halving that every pass, and overwrites the output
+    // with an upsampled image after each. Stops once timeBudgetSeconds have passed, if nonzero, or once a pass changes
+    // the mean luminance by less than targetChange relative to it. Not combined with streaming or checkpoints.
+    void SetProgressive(bool input, float timeBudgetSeconds, float targetChange);
+    // Records finished tiles in <output>.checkpoint while rendering, which is deleted once the output is written. With
+    // resume, the tiles already in it are taken from there instead of being rendered again.
+    void SetCheckpointing(bool input, bool resume);
+    // Adds indirect diffuse light from a map of about storedPhotons photons, built before the first Render, see
+    // PhotonMappingRenderer. Each estimate gathers gatherPhotons photons, 0 for the default, within gatherRadius, 0 for
+    // any distance, and with gatherRays above 0 is made where that many rays from the shading point land. 0 photons
+    // renders direct light only, the default.
+    void SetPhotonMapping(size_t storedPhotons, int gatherPhotons, float gatherRadius, int gatherRays);
+    // Also saves the given AOV next to the output, see ImageWriter::EnableAOV. Not written when streaming.
+    void EnableAOV(ImageAOV aov);
+    // Replaces the built-in station scene, e.g. with one from SceneGenerator. The scene must already be finalized.
+    // description tells it apart from other scenes, e.g. SceneGenerator::GetSceneDescription, so that a checkpoint
+    // of another scene is not resumed.
+    void SetScene(std::shared_ptr<class Scene> input, const std::string& description);
+
+    // Wall-clock time spent tracing tiles during the last Render, excluding output.
+    double GetLastRenderSeconds() const { return lastRenderSeconds; }
+private:
+    int width;
+    int height;
+    int threadCount;
+    float cloudTolerance;
+    std::string outputFilename;
+    std::shared_ptr<class ToneMapper> toneMapper;
+    std::shared_ptr<class ColorSampler> sampler;
+    int samplesPerPixel;
+    bool srgbOutput;
+    bool streamingOutput;
+    bool checkpointing;
+    bool resumeRender;
+    bool progressive;
+    float progressiveTimeBudget;
+    float progressiveTargetChange;
+    size_t photonCount;
+    int photonGatherCount;
+    float photonGatherRadius;
+    int finalGatherRays;
+    std::vector<ImageAOV> aovs;
+    double lastRenderSeconds;
+    // The earth sphere when the scene is the built-in one, null otherwise. Camera rays hitting it get the earth shading
+    // instead of the renderer's, and the image gets the atmosphere halo.
+    const class PrimitiveBase* earthPrimitive;
+
+    std::shared_ptr<class Scene> scene;
+    std::string sceneDescription;
+    std::shared_ptr<class Renderer> renderer;
 };
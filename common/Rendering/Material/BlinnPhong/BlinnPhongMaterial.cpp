@@ -21,9 +21,14 @@ void BlinnPhongMaterial::SetSpecular(glm::vec3 inputColor, float inputShininess)
     shininess = inputShininess;
 }
 
+glm::vec3 BlinnPhongMaterial::ComputeAlbedo(const IntersectionState& intersection) const
+{
+    return (textureStorage.find("diffuseTexture") != textureStorage.end()) ? glm::vec3(intersection.SampleTexture(textureStorage.at("diffuseTexture").get())) : diffuseColor;
+}
+
 glm::vec3 BlinnPhongMaterial::ComputeDiffuse(const IntersectionState& intersection, const glm::vec3& lightColor, const float NdL, const float NdH, const float NdV, const float VdH) const
 {
-    const glm::vec3 useDiffuseColor = (textureStorage.find("diffuseTexture") != textureStorage.end()) ? glm::vec3(textureStorage.at("diffuseTexture")->Sample(intersection.ComputeUV())) : diffuseColor;
+    const glm::vec3 useDiffuseColor = ComputeAlbedo(intersection);
     const float d = NdL;
     const glm::vec3 diffuseResponse = d * useDiffuseColor * lightColor;
     return diffuseResponse;
@@ -31,7 +36,7 @@ glm::vec3 BlinnPhongMaterial::ComputeDiffuse(const IntersectionState& intersecti
 
 glm::vec3 BlinnPhongMaterial::ComputeSpecular(const IntersectionState& intersection, const glm::vec3& lightColor, const float NdL, const float NdH, const float NdV, const float VdH) const
 {
-    const glm::vec3 useSpecularColor = (textureStorage.find("specularTexture") != textureStorage.end()) ? glm::vec3(textureStorage.at("specularTexture")->Sample(intersection.ComputeUV())) : specularColor;
+    const glm::vec3 useSpecularColor = (textureStorage.find("specularTexture") != textureStorage.end()) ? glm::vec3(intersection.SampleTexture(textureStorage.at("specularTexture").get())) : specularColor;
     const float highlight = std::pow(NdH, shininess);
     const glm::vec3 specularResponse = highlight * specularColor * lightColor;
     return specularResponse;
@@ -57,14 +62,14 @@ void BlinnPhongMaterial::LoadMaterialFromAssimp(std::shared_ptr<aiMaterial> assi
         aiString aiDiffusePath;
         assimpMaterial->GetTexture(aiTextureType_DIFFUSE, 0, &aiDiffusePath);
         std::string diffusePath(aiDiffusePath.C_Str());
-        SetTexture("diffuseTexture", TextureLoader::LoadTexture(diffusePath));
+        SetTexture("diffuseTexture", TextureLoader::LoadTextureAsync(diffusePath));
     }
 
     if (assimpMaterial->GetTextureCount(aiTextureType_SPECULAR)) {
         aiString aiSpecularPath;
         assimpMaterial->GetTexture(aiTextureType_SPECULAR, 0, &aiSpecularPath);
         std::string specularPath(aiSpecularPath.C_Str());
-        SetTexture("specularTexture", TextureLoader::LoadTexture(specularPath));
+        SetTexture("specularTexture", TextureLoader::LoadTextureAsync(specularPath));
     }
 
 }
@@ -19,6 +19,7 @@ public:
 
     virtual glm::vec3 GetBaseDiffuseReflection() const;
     virtual glm::vec3 GetBaseSpecularReflection() const;
+    virtual glm::vec3 ComputeAlbedo(const struct IntersectionState& intersection) const override;
 protected:
     virtual glm::vec3 ComputeDiffuse(const struct IntersectionState& intersection, const glm::vec3& lightColor, const float NdL, const float NdH, const float NdV, const float VdH) const override;
     virtual glm::vec3 ComputeSpecular(const struct IntersectionState& intersection, const glm::vec3& lightColor, const float NdL, const float NdH, const float NdV, const float VdH) const override;
@@ -21,11 +21,16 @@ Texture* Material::GetTexture(const std::string& id) const
     return textureStorage.at(id).get();
 }
 
-glm::vec3 Material::ComputeNonLightDependentBRDF(const class Renderer* renderer, const struct IntersectionState& intersection) const
+glm::vec3 Material::ComputeAlbedo(const struct IntersectionState& intersection) const
+{
+    return GetBaseDiffuseReflection();
+}
+
+glm::vec3 Material::ComputeNonLightDependentBRDF(const class Renderer* renderer, const struct IntersectionState& intersection, bool includeAmbient) const
 {
     const glm::vec3 reflectionColor = ComputeReflection(renderer, intersection);
     const glm::vec3 transmissionColor = ComputeTransmission(renderer, intersection);
-    return reflectivity * reflectionColor + transmittance * transmissionColor + ambient;
+    return reflectivity * reflectionColor + transmittance * transmissionColor + (includeAmbient ? ambient : glm::vec3());
 }
 
 glm::vec3 Material::ComputeBRDF(const struct IntersectionState& intersection, const glm::vec3& lightColor, const class Ray& toLightRay, const class Ray& fromCameraRay, float lightAttenuation, bool computeDiffuse, bool computeSpecular) const
@@ -106,9 +111,24 @@ void Material::LoadMaterialFromAssimp(std::shared_ptr<struct aiMaterial> assimpM
 
 void Material::SetTexture(const std::string& id, std::shared_ptr<class Texture> inputTexture)
 {
+    pendingTextures.erase(id);
     textureStorage[id] = std::move(inputTexture);
 }
 
+void Material::SetTexture(const std::string& id, std::shared_future<std::shared_ptr<class Texture>> pendingTexture)
+{
+    textureStorage.erase(id);
+    pendingTextures[id] = std::move(pendingTexture);
+}
+
+void Material::ResolveTextures()
+{
+    for (auto& pending : pendingTextures) {
+        textureStorage[pending.first] = pending.second.get();
+    }
+    pendingTextures.clear();
+}
+
 void Material::SetAmbient(const glm::vec3& input)
 {
     ambient = input;
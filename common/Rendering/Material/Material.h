@@ -1,6 +1,7 @@
 #pragma once
 
 #include "common/common.h"
+#include <future>
 
 class Material: public std::enable_shared_from_this<Material>
 {
@@ -8,7 +9,8 @@ public:
     Material();
     virtual ~Material();
 
-    virtual glm::vec3 ComputeNonLightDependentBRDF(const class Renderer* renderer, const struct IntersectionState& intersection) const;
+    // The ambient term stands in for indirect light, so renderers that gather it themselves leave it out.
+    virtual glm::vec3 ComputeNonLightDependentBRDF(const class Renderer* renderer, const struct IntersectionState& intersection, bool includeAmbient = true) const;
     virtual glm::vec3 ComputeBRDF(const struct IntersectionState& intersection, const glm::vec3& lightColor, const class Ray& toLightRay, const class Ray& fromCameraRay, float lightAttenuation, bool computeDiffuse = true, bool computeSpecular = true) const;
     
     virtual std::shared_ptr<Material> Clone() const = 0;
@@ -19,12 +21,15 @@ public:
 
     void SetReflectivity(float input);
     bool IsReflective() const { return reflectivity > SMALL_EPSILON; }
+    float GetReflectivity() const { return reflectivity; }
 
     void SetTransmittance(float input);
     bool IsTransmissive() const { return transmittance > SMALL_EPSILON; }
     float GetTransmittance() const { return transmittance; }
 
     virtual glm::vec3 GetBaseDiffuseReflection() const = 0;
+    // Diffuse color at the intersection before any lighting, e.g. for an albedo output. The base color by default.
+    virtual glm::vec3 ComputeAlbedo(const struct IntersectionState& intersection) const;
     virtual glm::vec3 GetBaseSpecularReflection() const { return glm::vec3(reflectivity); }
     virtual glm::vec3 GetBaseTransmittance() const { return glm::vec3(transmittance); }
 
@@ -32,6 +37,10 @@ public:
     float GetIOR() const { return indexOfRefraction; }
 
     void SetTexture(const std::string& id, std::shared_ptr<class Texture> inputTexture);
+    // Texture that is still being loaded (see TextureLoader::LoadTextureAsync). It is not visible to GetTexture
+    // until ResolveTextures waits for it, which the scene does when it is finalized.
+    void SetTexture(const std::string& id, std::shared_future<std::shared_ptr<class Texture>> pendingTexture);
+    void ResolveTextures();
     class Texture* GetTexture(const std::string& id) const;
 
     void SetAmbient(const glm::vec3& input);
@@ -43,6 +52,7 @@ protected:
     virtual glm::vec3 ComputeTransmission(const class Renderer* renderer, const struct IntersectionState& intersection) const;
 
     std::unordered_map<std::string, std::shared_ptr<class Texture>> textureStorage;
+    std::unordered_map<std::string, std::shared_future<std::shared_ptr<class Texture>>> pendingTextures;
 private:
     glm::vec3 ambient;
     float reflectivity;         // Perfect reflection 
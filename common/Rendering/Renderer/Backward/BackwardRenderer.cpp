@@ -16,6 +16,11 @@ void BackwardRenderer::InitializeRenderer()
 }
 
 glm::vec3 BackwardRenderer::ComputeSampleColor(const IntersectionState& intersection, const Ray& fromCameraRay) const
+{
+    return ComputeBackwardColor(intersection, fromCameraRay, true);
+}
+
+glm::vec3 BackwardRenderer::ComputeBackwardColor(const IntersectionState& intersection, const Ray& fromCameraRay, bool includeAmbient) const
 {
     if (!intersection.hasIntersection) {
         return glm::vec3();
@@ -40,7 +45,12 @@ glm::vec3 BackwardRenderer::ComputeSampleColor(const IntersectionState& intersec
 
         for (size_t s = 0; s < sampleRays.size(); ++s) {
             // note that max T should be set to be right before the light.
-            if (storedScene->Trace(&sampleRays[s], nullptr)) {
+            bool isOccluded;
+            {
+                DIAGNOSTICS_PHASE(phase, DiagnosticsPhase::SHADOW_TRACING);
+                isOccluded = storedScene->Trace(&sampleRays[s], nullptr);
+            }
+            if (isOccluded) {
                 continue;
             }
             const float lightAttenuation = light->ComputeLightAttenuation(intersectionPoint);
@@ -50,6 +60,6 @@ glm::vec3 BackwardRenderer::ComputeSampleColor(const IntersectionState& intersec
             sampleColor += brdfResponse;
         }
     }
-    sampleColor += objectMaterial->ComputeNonLightDependentBRDF(this, intersection);
+    sampleColor += objectMaterial->ComputeNonLightDependentBRDF(this, intersection, includeAmbient);
     return sampleColor;
 }
@@ -8,4 +8,8 @@ public:
     BackwardRenderer(std::shared_ptr<class Scene> scene);
     virtual void InitializeRenderer() override;
     glm::vec3 ComputeSampleColor(const struct IntersectionState& intersection, const class Ray& fromCameraRay) const override;
+
+protected:
+    // Direct lighting, reflection and transmission, plus the material's ambient term when includeAmbient is set.
+    glm::vec3 ComputeBackwardColor(const struct IntersectionState& intersection, const class Ray& fromCameraRay, bool includeAmbient) const;
 };
\ No newline at end of file
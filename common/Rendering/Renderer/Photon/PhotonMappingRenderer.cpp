@@ -0,0 +1,628 @@
+#include "common/Rendering/Renderer/Photon/PhotonMappingRenderer.h"
+#include "common/Scene/Scene.h"
+#include "common/Scene/Lights/Light.h"
+#include "common/Scene/Lights/Directional/DirectionalLight.h"
+#include "common/Scene/Geometry/Primitives/Primitive.h"
+#include "common/Scene/Geometry/Mesh/MeshObject.h"
+#include "common/Scene/Geometry/Simple/Box/Box.h"
+#include "common/Rendering/Material/Material.h"
+#include "common/Intersection/IntersectionState.h"
+#include "common/Utility/Math/CounterRandom.h"
+#include "common/Utility/Math/FastMath.h"
+#include "common/Utility/Threading/ThreadPool.h"
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+
+namespace
+{
+// Photons are traced in batches of this many emitted photons, which are the unit of work of the emission threads and
+// of the stopping test, so the stored photons do not depend on the thread count.
+const uint32_t PHOTON_BATCH_SIZE = 4096;
+// Batches that finished while an earlier one is still being traced are held until it is appended. Workers do not
+// start batches further than this many per thread ahead of it, which bounds the memory they hold.
+const uint32_t MAX_PENDING_BATCHES_PER_THREAD = 2;
+// Emission gives up after this many photons per photon to store, for scenes where most photons leave.
+const uint32_t MAX_EMITTED_PER_STORED = 64;
+// Subtrees of the map are sorted in parallel once there are this many per thread.
+const int BALANCE_SUBTREES_PER_THREAD = 4;
+
+// Scenes with more objects than this are split into this many clusters of nearby objects, and photons are aimed at
+// the clusters, so that emitting a photon does not take time in proportion to the object count.
+const size_t MAX_EMISSION_CONES = 32;
+
+const glm::vec3 LUMINANCE_WEIGHTS(0.2126f, 0.7152f, 0.0722f);
+
+// Orthonormal tangents of a unit normal (Duff et al., "Building an Orthonormal Basis, Revisited").
+void MakeBasis(const glm::vec3& normal, glm::vec3& tangent, glm::vec3& bitangent)
+{
+    const float sign = std::copysign(1.f, normal.z);
+    const float a = -1.f / (sign + normal.z);
+    const float b = normal.x * normal.y * a;
+    tangent = glm::vec3(1.f + sign * normal.x * normal.x * a, sign * b, -sign * normal.x);
+    bitangent = glm::vec3(b, sign + normal.y * normal.y * a, -normal.y);
+}
+
+// Appends the bounds of at most count clusters of boxes[begin, end) to output, splitting at the median center along
+// the axis where the centers spread the most. Boxes get a cluster of their own while there are few enough.
+void ClusterBoxes(std::vector<Box>& boxes, size_t begin, size_t end, size_t count, std::vector<Box>& output)
+{
+    if (end - begin <= count) {
+        output.insert(output.end(), boxes.begin() + begin, boxes.begin() + end);
+        return;
+    }
+    if (count <= 1) {
+        Box merged;
+        for (size_t i = begin; i < end; ++i) {
+            merged.IncludeBox(boxes[i]);
+        }
+        output.push_back(merged);
+        return;
+    }
+
+    Box centers;
+    for (size_t i = begin; i < end; ++i) {
+        centers.IncludeBox(Box(boxes[i].Center(), boxes[i].Center()));
+    }
+    const glm::vec3 extent = centers.maxVertex - centers.minVertex;
+    const int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : ((extent.y >= extent.z) ? 1 : 2);
+    const size_t middle = begin + (end - begin) / 2;
+    std::nth_element(boxes.begin() + begin, boxes.begin() + middle, boxes.begin() + end, [axis](const Box& a, const Box& b) {
+        return a.Center()[axis] < b.Center()[axis];
+    });
+    ClusterBoxes(boxes, begin, middle, count / 2, output);
+    ClusterBoxes(boxes, middle, end, count - count / 2, output);
+}
+
+// Direction within angle acos(cosMaxAngle) of axis, uniform over the solid angle, from two uniform numbers.
+glm::vec3 SampleCone(const glm::vec3& axis, float cosMaxAngle, float u0, float u1)
+{
+    const float cosAngle = 1.f - u0 * (1.f - cosMaxAngle);
+    const float sinAngle = std::sqrt(std::max(0.f, 1.f - cosAngle * cosAngle));
+    const float phi = 2.f * PI * u1;
+    glm::vec3 tangent, bitangent;
+    MakeBasis(axis, tangent, bitangent);
+    return sinAngle * std::cos(phi) * tangent + sinAngle * std::sin(phi) * bitangent + cosAngle * axis;
+}
+
+// Direction on the hemisphere around normal with a density proportional to the cosine.
+glm::vec3 SampleCosineHemisphere(const glm::vec3& normal, float u0, float u1)
+{
+    const float radius = std::sqrt(u0);
+    const float phi = 2.f * PI * u1;
+    glm::vec3 tangent, bitangent;
+    MakeBasis(normal, tangent, bitangent);
+    return radius * std::cos(phi) * tangent + radius * std::sin(phi) * bitangent + std::sqrt(std::max(0.f, 1.f - u0)) * normal;
+}
+
+// Ward's RGBE: three mantissas sharing the exponent of the largest component.
+void EncodePower(const glm::vec3& power, uint8_t output[4])
+{
+    const float largest = std::max(power.r, std::max(power.g, power.b));
+    if (!(largest > 1e-32f)) {
+        output[0] = output[1] = output[2] = output[3] = 0;
+        return;
+    }
+    int exponent;
+    const float scale = std::frexp(largest, &exponent) * 256.f / largest;
+    for (int i = 0; i < 3; ++i) {
+        output[i] = static_cast<uint8_t>(std::min(std::max(power[i], 0.f) * scale, 255.f));
+    }
+    output[3] = static_cast<uint8_t>(exponent + 128);
+}
+
+glm::vec3 DecodePower(const uint8_t power[4])
+{
+    if (!power[3]) {
+        return glm::vec3();
+    }
+    const float scale = std::ldexp(1.f, static_cast<int>(power[3]) - (128 + 8));
+    return glm::vec3(power[0] + 0.5f, power[1] + 0.5f, power[2] + 0.5f) * scale;
+}
+
+void EncodeDirection(const glm::vec3& direction, uint8_t& theta, uint8_t& phi)
+{
+    const float polar = std::acos(glm::clamp(direction.z, -1.f, 1.f)) * (256.f / PI);
+    const float azimuth = (std::atan2(direction.y, direction.x) + PI) * (256.f / (2.f * PI));
+    theta = static_cast<uint8_t>(std::min(polar, 255.f));
+    phi = static_cast<uint8_t>(std::min(azimuth, 255.f));
+}
+}
+
+PhotonMappingRenderer::Settings::Settings():
+    storedPhotons(1000000), gatherPhotons(100), maxGatherRadius(0.f), finalGatherRays(0), maxBounces(8)
+{
+}
+
+PhotonMappingRenderer::PhotonMappingRenderer(std::shared_ptr<Scene> scene, const Settings& inputSettings) :
+    BackwardRenderer(scene), settings(inputSettings), powerScale(0.f)
+{
+    settings.gatherPhotons = glm::clamp(settings.gatherPhotons, 1, MAX_GATHER_PHOTONS);
+    for (int i = 0; i < 256; ++i) {
+        const float theta = (i + 0.5f) * (PI / 256.f);
+        const float phi = (i + 0.5f) * (2.f * PI / 256.f) - PI;
+        cosTheta[i] = std::cos(theta);
+        sinTheta[i] = std::sin(theta);
+        cosPhi[i] = std::cos(phi);
+        sinPhi[i] = std::sin(phi);
+    }
+}
+
+void PhotonMappingRenderer::InitializeRenderer()
+{
+    photons.clear();
+    powerScale = 0.f;
+    CreateEmitters();
+    if (emitters.empty() || settings.storedPhotons == 0) {
+        return;
+    }
+    EmitPhotons();
+    BuildPhotonMap();
+}
+
+void PhotonMappingRenderer::CreateEmitters()
+{
+    emitters.clear();
+    std::vector<Box> objectBounds;
+    for (size_t o = 0; o < storedScene->GetTotalObjects(); ++o) {
+        objectBounds.push_back(storedScene->GetSceneObject(o).GetBoundingBox());
+    }
+    Box sceneBounds;
+    for (const Box& bounds : objectBounds) {
+        sceneBounds.IncludeBox(bounds);
+    }
+    std::vector<Box> targets;
+    if (!objectBounds.empty()) {
+        ClusterBoxes(objectBounds, 0, objectBounds.size(), MAX_EMISSION_CONES, targets);
+    }
+
+    float totalPower = 0.f;
+    for (size_t i = 0; i < storedScene->GetTotalLights(); ++i) {
+        const Light* light = storedScene->GetLightObject(i);
+        const float power = glm::dot(light->GetLightColor(), LUMINANCE_WEIGHTS);
+        if (!(power > 0.f)) {
+            continue;
+        }
+
+        PhotonEmitter emitter;
+        emitter.light = light;
+        emitter.position = glm::vec3(light->GetPosition());
+        emitter.discRadius = 0.f;
+        if (dynamic_cast<const DirectionalLight*>(light)) {
+            // Parallel light has no position to aim from. Its photons start on a disc facing the light that covers
+            // the bounding sphere of the scene, just outside of it.
+            if (targets.empty()) {
+                continue;
+            }
+            emitter.direction = glm::normalize(glm::vec3(light->GetForwardDirection()));
+            emitter.discRadius = 0.5f * glm::length(sceneBounds.maxVertex - sceneBounds.minVertex) + LARGE_EPSILON;
+            emitter.position = sceneBounds.Center() - emitter.discRadius * emitter.direction;
+            emitter.probability = power;
+            totalPower += power;
+            emitters.push_back(emitter);
+            continue;
+        }
+        for (const Box& bounds : targets) {
+            const glm::vec3 center = bounds.Center();
+            const float radius = 0.5f * glm::length(bounds.maxVertex - bounds.minVertex);
+            const float distance = glm::length(center - emitter.position);
+
+            EmissionCone cone;
+            if (distance <= radius) {
+                cone.axis = glm::vec3(0.f, 0.f, 1.f);
+                cone.cosMaxAngle = -1.f;
+            } else {
+                cone.axis = (center - emitter.position) / distance;
+                cone.cosMaxAngle = std::sqrt(std::max(0.f, 1.f - (radius / distance) * (radius / distance)));
+            }
+            cone.solidAngle = 2.f * PI * (1.f - cone.cosMaxAngle);
+            if (cone.solidAngle > 0.f) {
+                emitter.cones.push_back(cone);
+            }
+        }
+        if (emitter.cones.empty()) {
+            continue;
+        }
+        emitter.probability = power;
+        totalPower += power;
+        emitters.push_back(emitter);
+    }
+
+    // Brighter lights emit proportionally more photons, so that all photons start with similar powers.
+    float cumulativeProbability = 0.f;
+    for (auto& emitter : emitters) {
+        emitter.probability /= totalPower;
+        cumulativeProbability += emitter.probability;
+        emitter.cumulativeProbability = cumulativeProbability;
+    }
+    if (!emitters.empty()) {
+        emitters.back().cumulativeProbability = 1.f;
+    }
+}
+
+bool PhotonMappingRenderer::GeneratePhotonRay(uint32_t photonIndex, Ray& ray, glm::vec3& power, bool& fromPoint) const
+{
+    const float lightChoice = CounterRandom::Uniform(CounterRandom::Stream::PHOTON_EMISSION, photonIndex, 0, 2);
+    size_t e = 0;
+    while (e + 1 < emitters.size() && lightChoice >= emitters[e].cumulativeProbability) {
+        ++e;
+    }
+    const PhotonEmitter& emitter = emitters[e];
+    fromPoint = emitter.discRadius <= 0.f;
+
+    if (!fromPoint) {
+        // Uniform over the disc. The light's color is the irradiance it gives a surface facing it, so each photon
+        // carries that times the disc area it stands for.
+        const float u0 = CounterRandom::Uniform(CounterRandom::Stream::PHOTON_EMISSION, photonIndex, 0, 0);
+        const float u1 = CounterRandom::Uniform(CounterRandom::Stream::PHOTON_EMISSION, photonIndex, 0, 1);
+        const float radius = emitter.discRadius * std::sqrt(u0);
+        const float angle = 2.f * PI * u1;
+        glm::vec3 tangent, bitangent;
+        MakeBasis(emitter.direction, tangent, bitangent);
+        ray.SetRayPosition(emitter.position + radius * (std::cos(angle) * tangent + std::sin(angle) * bitangent));
+        ray.SetRayDirection(emitter.direction);
+        power = emitter.light->GetLightColor() * (PI * emitter.discRadius * emitter.discRadius / emitter.probability);
+        return true;
+    }
+
+    // Each cone is picked with the same probability, so that small objects get as many photons as large ones. A
+    // direction can lie in several cones, and its density sums over all of them.
+    const float coneChoice = CounterRandom::Uniform(CounterRandom::Stream::PHOTON_EMISSION, photonIndex, 0, 3);
+    const size_t coneCount = emitter.cones.size();
+    const EmissionCone& cone = emitter.cones[std::min(static_cast<size_t>(coneChoice * coneCount), coneCount - 1)];
+    if (cone.cosMaxAngle <= -1.f) {
+        emitter.light->GenerateRandomPhotonRay(ray, photonIndex);
+    } else {
+        const float u0 = CounterRandom::Uniform(CounterRandom::Stream::PHOTON_EMISSION, photonIndex, 0, 0);
+        const float u1 = CounterRandom::Uniform(CounterRandom::Stream::PHOTON_EMISSION, photonIndex, 0, 1);
+        ray.SetRayPosition(emitter.position);
+        ray.SetRayDirection(SampleCone(cone.axis, cone.cosMaxAngle, u0, u1));
+    }
+
+    const glm::vec3 direction = ray.GetRayDirection();
+    float density = 0.f;
+    for (const auto& other : emitter.cones) {
+        if (other.cosMaxAngle <= -1.f || glm::dot(direction, other.axis) >= other.cosMaxAngle) {
+            density += 1.f / (coneCount * other.solidAngle);
+        }
+    }
+    if (!(density > 0.f)) {
+        return false;
+    }
+    power = emitter.light->GetLightColor() / (emitter.probability * density);
+    return true;
+}
+
+void PhotonMappingRenderer::TracePhotons(uint32_t firstPhoton, uint32_t count, std::vector<Photon>& output) const
+{
+    // The direct light is only needed at the points final gather rays land on.
+    const bool storeDirect = settings.finalGatherRays > 0;
+    for (uint32_t photonIndex = firstPhoton; photonIndex < firstPhoton + count; ++photonIndex) {
+        Ray ray;
+        glm::vec3 power;
+        bool fromPoint;
+        if (!GeneratePhotonRay(photonIndex, ray, power, fromPoint)) {
+            continue;
+        }
+
+        float currentIOR = 1.f;
+        for (int bounce = 0; bounce <= settings.maxBounces; ++bounce) {
+            IntersectionState state(0, 0);
+            state.currentIOR = currentIOR;
+            if (!storedScene->Trace(&ray, &state)) {
+                break;
+            }
+            const glm::vec3 direction = ray.GetRayDirection();
+            const glm::vec3 hitPoint = state.intersectionRay.GetRayPosition(state.intersectionT);
+            const Material* material = state.intersectedPrimitive->GetParentMeshObject()->GetMaterial();
+            glm::vec3 normal = state.ComputeNormal();
+            const float NdR = glm::dot(direction, normal);
+            if (NdR > 0.f) {
+                normal = -normal;
+            }
+
+            // The traced direct light does not fall off with distance, see PointLight::ComputeLightAttenuation, so
+            // neither do the photons: they arrive with the light's color as irradiance, as if the light were at unit
+            // distance, and fall off physically from there. Parallel light does not fall off to begin with.
+            if (bounce == 0 && fromPoint) {
+                power *= state.intersectionT * state.intersectionT;
+            }
+
+            if (material->HasDiffuseReflection() && (bounce > 0 || storeDirect)) {
+                Photon photon;
+                photon.position[0] = hitPoint.x;
+                photon.position[1] = hitPoint.y;
+                photon.position[2] = hitPoint.z;
+                EncodePower(power, photon.power);
+                EncodeDirection(direction, photon.theta, photon.phi);
+                photon.splitAxis = 0;
+                photon.padding = 0;
+                output.push_back(photon);
+            }
+
+            // Russian roulette between mirror reflection, refraction and diffuse reflection, weighted like the
+            // materials' ComputeBRDF and ComputeNonLightDependentBRDF, or absorption.
+            const float reflectivity = material->GetReflectivity();
+            const float transmittance = material->GetTransmittance();
+            const glm::vec3 diffuse = std::max(1.f - reflectivity - transmittance, 0.f) * material->ComputeAlbedo(state);
+            const float diffuseProbability = std::min(std::max(diffuse.r, std::max(diffuse.g, diffuse.b)), 1.f);
+            const float event = CounterRandom::Uniform(CounterRandom::Stream::PHOTON_SCATTERING, photonIndex, bounce, 0);
+            Ray nextRay;
+            if (event < reflectivity) {
+                storedScene->PerformRaySpecularReflection(nextRay, ray, hitPoint, NdR, state);
+            } else if (event < reflectivity + transmittance) {
+                float targetIOR = (NdR < SMALL_EPSILON) ? material->GetIOR() : 1.f;
+                storedScene->PerformRayRefraction(nextRay, ray, hitPoint, NdR, state, targetIOR);
+                currentIOR = targetIOR;
+            } else if (event < reflectivity + transmittance + diffuseProbability) {
+                const float u0 = CounterRandom::Uniform(CounterRandom::Stream::PHOTON_SCATTERING, photonIndex, bounce, 1);
+                const float u1 = CounterRandom::Uniform(CounterRandom::Stream::PHOTON_SCATTERING, photonIndex, bounce, 2);
+                const glm::vec3 scatterDirection = SampleCosineHemisphere(normal, u0, u1);
+                nextRay.SetRayPosition(hitPoint + LARGE_EPSILON * normal);
+                nextRay.SetRayDirection(scatterDirection);
+                power *= diffuse / diffuseProbability;
+            } else {
+                break;
+            }
+            ray = nextRay;
+        }
+    }
+}
+
+void PhotonMappingRenderer::EmitPhotons()
+{
+    PROFILE_ZONE(zone, "Emit Photons");
+    const uint64_t maxEmitted = std::min<uint64_t>(static_cast<uint64_t>(settings.storedPhotons) * MAX_EMITTED_PER_STORED, std::numeric_limits<uint32_t>::max());
+    const uint32_t maxBatches = static_cast<uint32_t>(std::max<uint64_t>(1, maxEmitted / PHOTON_BATCH_SIZE));
+
+    // Workers take batches in order and hand them in as they finish. Batches are appended to the map in order, and
+    // emission stops after the first batch that brings it to the target, so the result does not depend on which
+    // thread traced what. Workers wait before starting a batch too far ahead of the map, see
+    // MAX_PENDING_BATCHES_PER_THREAD.
+    const uint32_t maxPendingBatches = MAX_PENDING_BATCHES_PER_THREAD * static_cast<uint32_t>(ThreadPool::Get().GetThreadCount());
+    std::atomic<uint32_t> nextBatch(0);
+    std::atomic<bool> finished(false);
+    std::mutex batchMutex;
+    std::condition_variable batchAppended;
+    std::map<uint32_t, std::vector<Photon>> pendingBatches;
+    uint32_t appendedBatches = 0;
+    photons.reserve(settings.storedPhotons);
+
+    auto emitBatches = [&]() {
+        std::vector<Photon> batch;
+        while (!finished) {
+            const uint32_t batchIndex = nextBatch++;
+            if (batchIndex >= maxBatches) {
+                break;
+            }
+            {
+                std::unique_lock<std::mutex> lock(batchMutex);
+                batchAppended.wait(lock, [&]() { return finished || batchIndex < appendedBatches + maxPendingBatches; });
+                if (finished) {
+                    break;
+                }
+            }
+            batch.clear();
+            TracePhotons(batchIndex * PHOTON_BATCH_SIZE, PHOTON_BATCH_SIZE, batch);
+
+            std::lock_guard<std::mutex> lock(batchMutex);
+            if (finished) {
+                break;
+            }
+            pendingBatches[batchIndex].swap(batch);
+            for (auto next = pendingBatches.find(appendedBatches); next != pendingBatches.end(); next = pendingBatches.find(appendedBatches)) {
+                photons.insert(photons.end(), next->second.begin(), next->second.end());
+                pendingBatches.erase(next);
+                ++appendedBatches;
+                if (photons.size() >= settings.storedPhotons) {
+                    finished = true;
+                    break;
+                }
+            }
+            batchAppended.notify_all();
+        }
+    };
+
+    std::vector<std::future<void>> workers;
+    for (int i = 0; i < ThreadPool::Get().GetThreadCount(); ++i) {
+        workers.push_back(ThreadPool::Get().Submit(emitBatches));
+    }
+    for (auto& worker : workers) {
+        worker.get();
+    }
+    photons.shrink_to_fit();
+
+    const uint64_t emittedPhotons = static_cast<uint64_t>(appendedBatches) * PHOTON_BATCH_SIZE;
+    powerScale = (emittedPhotons > 0) ? 1.f / static_cast<float>(emittedPhotons) : 0.f;
+    std::cout << "Emitted " << emittedPhotons << " photons, stored " << photons.size() << std::endl;
+}
+
+void PhotonMappingRenderer::BalancePhotons(size_t begin, size_t end, int parallelDepth, std::vector<std::pair<size_t, size_t>>* deferred)
+{
+    while (end - begin > 1) {
+        if (deferred && parallelDepth == 0) {
+            deferred->emplace_back(begin, end);
+            return;
+        }
+
+        glm::vec3 minPosition(std::numeric_limits<float>::max());
+        glm::vec3 maxPosition(-std::numeric_limits<float>::max());
+        for (size_t i = begin; i < end; ++i) {
+            const glm::vec3 position(photons[i].position[0], photons[i].position[1], photons[i].position[2]);
+            minPosition = glm::min(minPosition, position);
+            maxPosition = glm::max(maxPosition, position);
+        }
+        const glm::vec3 extent = maxPosition - minPosition;
+        const int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : ((extent.y >= extent.z) ? 1 : 2);
+
+        const size_t middle = begin + (end - begin) / 2;
+        std::nth_element(photons.begin() + begin, photons.begin() + middle, photons.begin() + end, [axis](const Photon& a, const Photon& b) {
+            return a.position[axis] < b.position[axis];
+        });
+        photons[middle].splitAxis = static_cast<uint8_t>(axis);
+
+        BalancePhotons(begin, middle, parallelDepth - 1, deferred);
+        begin = middle + 1;
+        --parallelDepth;
+    }
+}
+
+void PhotonMappingRenderer::BuildPhotonMap()
+{
+    PROFILE_ZONE(zone, "Build Photon Map");
+    // The top levels are split on this thread, then the subtrees below them are sorted on the pool.
+    int parallelDepth = 0;
+    while ((1 << parallelDepth) < BALANCE_SUBTREES_PER_THREAD * ThreadPool::Get().GetThreadCount()) {
+        ++parallelDepth;
+    }
+    std::vector<std::pair<size_t, size_t>> subtrees;
+    BalancePhotons(0, photons.size(), parallelDepth, &subtrees);
+
+    std::vector<std::future<void>> tasks;
+    for (const auto& subtree : subtrees) {
+        tasks.push_back(ThreadPool::Get().Submit([this, subtree]() {
+            BalancePhotons(subtree.first, subtree.second, 0, nullptr);
+        }));
+    }
+    for (auto& task : tasks) {
+        task.get();
+    }
+}
+
+glm::vec3 PhotonMappingRenderer::DecodeDirection(uint8_t theta, uint8_t phi) const
+{
+    return glm::vec3(sinTheta[theta] * cosPhi[phi], sinTheta[theta] * sinPhi[phi], cosTheta[theta]);
+}
+
+void PhotonMappingRenderer::LocatePhotons(size_t begin, size_t end, const glm::vec3& position, int count, Neighbour* heap, int& found, float& maxDistance2) const
+{
+    // heap is a max-heap of the nearest photons so far. Once it holds count of them, maxDistance2 shrinks to the
+    // distance of the farthest, which prunes the subtrees further away.
+    while (begin < end) {
+        const size_t middle = begin + (end - begin) / 2;
+        const Photon& photon = photons[middle];
+        const float delta = position[photon.splitAxis] - photon.position[photon.splitAxis];
+        if (delta < 0.f) {
+            LocatePhotons(begin, middle, position, count, heap, found, maxDistance2);
+        } else {
+            LocatePhotons(middle + 1, end, position, count, heap, found, maxDistance2);
+        }
+
+        const glm::vec3 offset = position - glm::vec3(photon.position[0], photon.position[1], photon.position[2]);
+        const float distance2 = glm::dot(offset, offset);
+        if (distance2 < maxDistance2) {
+            if (found < count) {
+                heap[found++] = { distance2, static_cast<uint32_t>(middle) };
+                std::push_heap(heap, heap + found);
+            } else {
+                std::pop_heap(heap, heap + found);
+                heap[found - 1] = { distance2, static_cast<uint32_t>(middle) };
+                std::push_heap(heap, heap + found);
+            }
+            if (found == count) {
+                maxDistance2 = heap[0].distance2;
+            }
+        }
+
+        if (delta * delta >= maxDistance2) {
+            return;
+        }
+        if (delta < 0.f) {
+            begin = middle + 1;
+        } else {
+            end = middle;
+        }
+    }
+}
+
+glm::vec3 PhotonMappingRenderer::EstimateIrradiance(const glm::vec3& position, const glm::vec3& normal) const
+{
+    const bool limitedRadius = settings.maxGatherRadius > 0.f;
+    float maxDistance2 = limitedRadius ? settings.maxGatherRadius * settings.maxGatherRadius : std::numeric_limits<float>::max();
+    Neighbour heap[MAX_GATHER_PHOTONS];
+    int found = 0;
+    LocatePhotons(0, photons.size(), position, settings.gatherPhotons, heap, found, maxDistance2);
+    if (found == 0) {
+        return glm::vec3();
+    }
+
+    // The photons are spread over the disc reaching the farthest one gathered, or the whole search radius when it
+    // held fewer than wanted.
+    float radius2 = 0.f;
+    glm::vec3 flux;
+    for (int i = 0; i < found; ++i) {
+        const Photon& photon = photons[heap[i].index];
+        radius2 = std::max(radius2, heap[i].distance2);
+        if (glm::dot(DecodeDirection(photon.theta, photon.phi), normal) < 0.f) {
+            flux += DecodePower(photon.power);
+        }
+    }
+    if (found < settings.gatherPhotons && limitedRadius) {
+        radius2 = maxDistance2;
+    }
+    if (!(radius2 > 0.f)) {
+        return glm::vec3();
+    }
+    return flux * (powerScale / (PI * radius2));
+}
+
+glm::vec3 PhotonMappingRenderer::ComputeFinalGather(const glm::vec3& position, const glm::vec3& normal) const
+{
+    // The rays only depend on the shading point, so the result does not depend on which thread shades it.
+    const uint32_t key = CounterRandom::Hash(static_cast<uint32_t>(CounterRandom::Stream::FINAL_GATHER), FastMath::FloatToBits(position.x), FastMath::FloatToBits(position.y), FastMath::FloatToBits(position.z));
+
+    // The materials reflect their albedo times the irradiance, see BlinnPhongMaterial::ComputeDiffuse, so with
+    // directions sampled by the cosine the irradiance here is the mean of what the rays see.
+    glm::vec3 irradiance;
+    for (int i = 0; i < settings.finalGatherRays; ++i) {
+        const float u0 = CounterRandom::Uniform(CounterRandom::Stream::FINAL_GATHER, key, i, 0);
+        const float u1 = CounterRandom::Uniform(CounterRandom::Stream::FINAL_GATHER, key, i, 1);
+        Ray gatherRay(position + LARGE_EPSILON * normal, SampleCosineHemisphere(normal, u0, u1));
+        IntersectionState state(0, 0);
+        if (!storedScene->Trace(&gatherRay, &state)) {
+            continue;
+        }
+        const Material* material = state.intersectedPrimitive->GetParentMeshObject()->GetMaterial();
+        if (!material->HasDiffuseReflection()) {
+            continue;
+        }
+        glm::vec3 hitNormal = state.ComputeNormal();
+        if (glm::dot(hitNormal, gatherRay.GetRayDirection()) > 0.f) {
+            hitNormal = -hitNormal;
+        }
+        const float diffuseWeight = std::max(1.f - material->GetReflectivity() - material->GetTransmittance(), 0.f);
+        irradiance += diffuseWeight * material->ComputeAlbedo(state) * EstimateIrradiance(state.intersectionRay.GetRayPosition(state.intersectionT), hitNormal);
+    }
+    return irradiance / static_cast<float>(settings.finalGatherRays);
+}
+
+glm::vec3 PhotonMappingRenderer::ComputeSampleColor(const IntersectionState& intersection, const Ray& fromCameraRay) const
+{
+    if (!intersection.hasIntersection || photons.empty()) {
+        return BackwardRenderer::ComputeSampleColor(intersection, fromCameraRay);
+    }
+
+    const Material* objectMaterial = intersection.intersectedPrimitive->GetParentMeshObject()->GetMaterial();
+    assert(objectMaterial);
+    if (!objectMaterial->HasDiffuseReflection()) {
+        return BackwardRenderer::ComputeSampleColor(intersection, fromCameraRay);
+    }
+
+    // The photon map supplies the indirect light that the material's ambient term approximates.
+    const glm::vec3 sampleColor = ComputeBackwardColor(intersection, fromCameraRay, false);
+
+    const glm::vec3 intersectionPoint = intersection.intersectionRay.GetRayPosition(intersection.intersectionT);
+    glm::vec3 normal = intersection.ComputeNormal();
+    if (glm::dot(normal, fromCameraRay.GetRayDirection()) > 0.f) {
+        normal = -normal;
+    }
+
+    glm::vec3 irradiance;
+    {
+        DIAGNOSTICS_PHASE(phase, DiagnosticsPhase::PHOTON_GATHERING);
+        irradiance = (settings.finalGatherRays > 0) ? ComputeFinalGather(intersectionPoint, normal) : EstimateIrradiance(intersectionPoint, normal);
+    }
+    const float diffuseWeight = std::max(1.f - objectMaterial->GetReflectivity() - objectMaterial->GetTransmittance(), 0.f);
+    return sampleColor + diffuseWeight * objectMaterial->ComputeAlbedo(intersection) * irradiance;
+}
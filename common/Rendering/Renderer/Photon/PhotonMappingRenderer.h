@@ -0,0 +1,115 @@
+#pragma once
+
+#include "common/Rendering/Renderer/Backward/BackwardRenderer.h"
+
+// Backward renderer that adds the indirect diffuse light from a global photon map (Jensen, "Realistic Image Synthesis
+// Using Photon Mapping"). The direct light is still traced by BackwardRenderer, so the map only holds photons that
+// bounced at least once, unless final gathering needs the direct ones too.
+class PhotonMappingRenderer : public BackwardRenderer
+{
+public:
+    struct Settings
+    {
+        Settings();
+
+        // Photons are emitted in batches until about this many are stored.
+        size_t storedPhotons;
+        // Photons in each irradiance estimate, at most MAX_GATHER_PHOTONS.
+        int gatherPhotons;
+        // Photons further away than this are not gathered. 0 gathers the nearest ones whatever their distance.
+        float maxGatherRadius;
+        // Rays traced over the hemisphere at each shading point to look the map up where they land instead of at the
+        // point itself, which hides the blotches of the density estimate. 0 looks the map up directly.
+        int finalGatherRays;
+        // Bounces after which a photon is dropped even if Russian roulette kept it.
+        int maxBounces;
+    };
+
+    PhotonMappingRenderer(std::shared_ptr<class Scene> scene, const Settings& inputSettings);
+
+    // Emits and traces the photons in parallel and builds the map. Only depends on the scene, so it runs once.
+    virtual void InitializeRenderer() override;
+    glm::vec3 ComputeSampleColor(const struct IntersectionState& intersection, const class Ray& fromCameraRay) const override;
+
+    size_t GetStoredPhotonCount() const { return photons.size(); }
+
+    static const int MAX_GATHER_PHOTONS = 256;
+
+private:
+    // 20 bytes, so that tens of millions fit in memory: the power in Ward's shared-exponent RGBE and the incoming
+    // direction as two angles, as in Jensen's book. The kd-tree lives in the array order, see BalancePhotons.
+    struct Photon
+    {
+        float position[3];
+        uint8_t power[4];
+        uint8_t theta;
+        uint8_t phi;
+        uint8_t splitAxis;
+        uint8_t padding;
+    };
+
+    // Photons of a light are aimed at cones around the bounding spheres of the scene objects, or of clusters of them in
+    // scenes with many objects, a coarse version of Jensen's projection maps, instead of over the whole sphere where
+    // most would miss the scene.
+    struct EmissionCone
+    {
+        glm::vec3 axis;
+        // -1 for objects around the light, which are emitted to over the whole sphere.
+        float cosMaxAngle;
+        float solidAngle;
+    };
+
+    // Point lights emit from their position into the cones. Directional lights emit along direction from a disc of
+    // discRadius centered on position, and have no cones.
+    struct PhotonEmitter
+    {
+        const class Light* light;
+        glm::vec3 position;
+        glm::vec3 direction;
+        float discRadius;
+        // Cumulative probability of emitting from this light or an earlier one.
+        float cumulativeProbability;
+        float probability;
+        std::vector<EmissionCone> cones;
+    };
+
+    struct Neighbour
+    {
+        float distance2;
+        uint32_t index;
+
+        bool operator<(const Neighbour& other) const { return distance2 < other.distance2; }
+    };
+
+    void CreateEmitters();
+    void EmitPhotons();
+    // Traces the photons with global indices firstPhoton up to firstPhoton + count and appends the stored ones.
+    void TracePhotons(uint32_t firstPhoton, uint32_t count, std::vector<Photon>& output) const;
+    // Returns false when the photon leaves the scene without being emitted towards any object. fromPoint is set for
+    // photons of point lights, whose power is relative to unit distance.
+    bool GeneratePhotonRay(uint32_t photonIndex, class Ray& ray, glm::vec3& power, bool& fromPoint) const;
+
+    // Sorts photons[begin, end) into a kd-tree: the median along the axis of largest extent goes to the middle, the
+    // photons below it before and the ones above after, and so on recursively. The tree needs no pointers or padding,
+    // and is balanced. With deferred, subtrees parallelDepth levels down are not sorted but appended to it.
+    void BalancePhotons(size_t begin, size_t end, int parallelDepth, std::vector<std::pair<size_t, size_t>>* deferred);
+    void BuildPhotonMap();
+
+    void LocatePhotons(size_t begin, size_t end, const glm::vec3& position, int count, Neighbour* heap, int& found, float& maxDistance2) const;
+    // Irradiance from the photons nearest to position that arrived from the side normal points to.
+    glm::vec3 EstimateIrradiance(const glm::vec3& position, const glm::vec3& normal) const;
+    glm::vec3 ComputeFinalGather(const glm::vec3& position, const glm::vec3& normal) const;
+
+    glm::vec3 DecodeDirection(uint8_t theta, uint8_t phi) const;
+
+    Settings settings;
+    std::vector<PhotonEmitter> emitters;
+    std::vector<Photon> photons;
+    // Photon powers are stored unnormalized and divided by the number of photons emitted when gathering.
+    float powerScale;
+
+    float cosTheta[256];
+    float sinTheta[256];
+    float cosPhi[256];
+    float sinPhi[256];
+};
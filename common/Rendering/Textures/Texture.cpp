@@ -6,4 +6,23 @@ Texture::Texture()
 
 Texture::~Texture()
 {
-}
\ No newline at end of file
+}
+
+glm::vec4 Texture::SampleGrad(const glm::vec2& coord, const glm::vec2& dUVdx, const glm::vec2& dUVdy) const
+{
+    return Sample(coord);
+}
+
+void Texture::SampleBatch(const glm::vec2* coords, glm::vec4* output, size_t count) const
+{
+    for (size_t i = 0; i < count; ++i) {
+        output[i] = Sample(coords[i]);
+    }
+}
+
+void Texture::SampleGradBatch(const glm::vec2* coords, const glm::vec2* dUVdx, const glm::vec2* dUVdy, glm::vec4* output, size_t count) const
+{
+    for (size_t i = 0; i < count; ++i) {
+        output[i] = SampleGrad(coords[i], dUVdx[i], dUVdy[i]);
+    }
+}
@@ -10,4 +10,16 @@ public:
 
     virtual glm::vec4 Sample(const glm::vec2& coord) const = 0;
     virtual glm::vec4 Sample(const glm::vec3& coord) const = 0;
+
+    // Filtered lookup over the footprint given by the screen-space derivatives of the coordinate. Textures without
+    // prefiltered data fall back to the point lookup.
+    virtual glm::vec4 SampleGrad(const glm::vec2& coord, const glm::vec2& dUVdx, const glm::vec2& dUVdy) const;
+
+    // Batched versions of Sample and SampleGrad for count coordinates, so that a shading batch pays for one virtual
+    // call. The defaults loop over the single lookups.
+    virtual void SampleBatch(const glm::vec2* coords, glm::vec4* output, size_t count) const;
+    virtual void SampleGradBatch(const glm::vec2* coords, const glm::vec2* dUVdx, const glm::vec2* dUVdy, glm::vec4* output, size_t count) const;
+
+    // Bytes of texel data the texture keeps in memory. Data paged in through the TextureCache is counted there.
+    virtual size_t GetMemoryBytes() const { return 0; }
 };
@@ -1,8 +1,298 @@
 #include "common/Rendering/Textures/Texture2D.h"
 
-Texture2D::Texture2D(unsigned char* rawData, int width, int height):
-    Texture(), textureData(rawData), texWidth(width), texHeight(height)
+#include <type_traits>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+bool IsPowerOfTwo(int value)
+{
+    return value > 0 && (value & (value - 1)) == 0;
+}
+
+// Texel (x, y) of a level is centered on ((x + 0.5) / width, (y + 0.5) / height), so that the texels of every mip
+// level line up with the ones of the level above they were filtered from.
+glm::vec2 ToTexelSpace(const glm::vec2& coord, const glm::vec2& size)
+{
+    return coord * size - glm::vec2(0.5f);
+}
+
+// Source texels that texel index of the next mip level covers along one axis, and how much of it each one covers.
+// Texel index spans [index * scale, (index + 1) * scale) of the source, with scale exactly 2 for even sizes and
+// slightly above for odd ones, so that the texel centers of both levels line up.
+struct DownsampleFootprint
+{
+    int first;
+    int count;
+    float weights[4];
+};
+
+std::vector<DownsampleFootprint> ComputeDownsampleFootprints(int sourceSize, int size)
+{
+    std::vector<DownsampleFootprint> footprints(size);
+    const double scale = static_cast<double>(sourceSize) / size;
+    for (int index = 0; index < size; ++index) {
+        const double start = index * scale;
+        const double end = (index + 1) * scale;
+        DownsampleFootprint& footprint = footprints[index];
+        footprint.first = static_cast<int>(start);
+        footprint.count = 0;
+        for (int texel = footprint.first; texel < sourceSize && texel < end && footprint.count < 4; ++texel) {
+            footprint.weights[footprint.count++] = static_cast<float>((std::min(end, texel + 1.0) - std::max(start, static_cast<double>(texel))) / scale);
+        }
+    }
+    return footprints;
+}
+
+unsigned char ToTexelValue(float value, unsigned char)
+{
+    return static_cast<unsigned char>(value + 0.5f);
+}
+
+float ToTexelValue(float value, float)
+{
+    return value;
+}
+
+template<typename T>
+void DownsampleBox(const T* source, const glm::ivec2& sourceSize, const glm::ivec2& size, T* destination)
+{
+    const std::vector<DownsampleFootprint> columns = ComputeDownsampleFootprints(sourceSize.x, size.x);
+    const std::vector<DownsampleFootprint> rows = ComputeDownsampleFootprints(sourceSize.y, size.y);
+    for (int y = 0; y < size.y; ++y) {
+        const DownsampleFootprint& row = rows[y];
+        for (int x = 0; x < size.x; ++x) {
+            const DownsampleFootprint& column = columns[x];
+            float sum[4] = { 0.f, 0.f, 0.f, 0.f };
+            for (int j = 0; j < row.count; ++j) {
+                const T* sourceRow = source + static_cast<size_t>(row.first + j) * sourceSize.x * 4;
+                for (int i = 0; i < column.count; ++i) {
+                    const T* texel = sourceRow + static_cast<size_t>(column.first + i) * 4;
+                    const float weight = row.weights[j] * column.weights[i];
+                    for (int c = 0; c < 4; ++c) {
+                        sum[c] += weight * texel[c];
+                    }
+                }
+            }
+            for (int c = 0; c < 4; ++c) {
+                destination[c] = ToTexelValue(sum[c], T());
+            }
+            destination += 4;
+        }
+    }
+}
+
+// Repeat border handling for the batch paths, picked once per texture so the inner loops have no branches on it.
+struct RepeatPowerOfTwo
 {
+    RepeatPowerOfTwo(int width, int height) : maskX(width - 1), maskY(height - 1) {}
+
+    int WrapX(int x) const { return x & maskX; }
+    int WrapY(int y) const { return y & maskY; }
+#if defined(__AVX2__)
+    __m256i WrapX(__m256i x) const { return _mm256_and_si256(x, _mm256_set1_epi32(maskX)); }
+    __m256i WrapY(__m256i y) const { return _mm256_and_si256(y, _mm256_set1_epi32(maskY)); }
+#endif
+
+    int maskX;
+    int maskY;
+};
+
+struct RepeatModulo
+{
+    RepeatModulo(int width, int height) : width(width), height(height) {}
+
+    static int Wrap(int value, int size)
+    {
+        const int result = value % size;
+        return (result < 0) ? result + size : result;
+    }
+
+    int WrapX(int x) const { return Wrap(x, width); }
+    int WrapY(int y) const { return Wrap(y, height); }
+#if defined(__AVX2__)
+    // There is no integer division, so divide in float and correct the quotient by one either way. Exact for
+    // coordinates below 2^24.
+    static __m256i Wrap(__m256i value, int size)
+    {
+        const __m256 sizeVector = _mm256_set1_ps(static_cast<float>(size));
+        const __m256i quotient = _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_div_ps(_mm256_cvtepi32_ps(value), sizeVector)));
+        const __m256i sizeInteger = _mm256_set1_epi32(size);
+        __m256i result = _mm256_sub_epi32(value, _mm256_mullo_epi32(quotient, sizeInteger));
+        result = _mm256_add_epi32(result, _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_setzero_si256(), result), sizeInteger));
+        result = _mm256_sub_epi32(result, _mm256_andnot_si256(_mm256_cmpgt_epi32(sizeInteger, result), sizeInteger));
+        return result;
+    }
+
+    __m256i WrapX(__m256i x) const { return Wrap(x, width); }
+    __m256i WrapY(__m256i y) const { return Wrap(y, height); }
+#endif
+
+    int width;
+    int height;
+};
+
+// Same filter as Texture2D::SampleBilinear with the format and the wrap mode known at compile time. Takes the
+// coordinates in texels, see ToTexelSpace.
+template<TextureFormat Format, typename Wrap>
+glm::vec4 SampleBilinearTexel(const unsigned char* data, int width, const Wrap& wrap, const glm::vec2& imageSpaceCoordinates)
+{
+    const glm::vec2 floorVec(std::floor(imageSpaceCoordinates.x), std::floor(imageSpaceCoordinates.y));
+    const glm::vec2 ceilVec(floorVec.x + 1.f, floorVec.y + 1.f);
+    const int x0 = wrap.WrapX(static_cast<int>(floorVec.x));
+    const int x1 = wrap.WrapX(static_cast<int>(ceilVec.x));
+    const int y0 = wrap.WrapY(static_cast<int>(floorVec.y));
+    const int y1 = wrap.WrapY(static_cast<int>(ceilVec.y));
+
+    const glm::vec4 fx1 = (ceilVec.x - imageSpaceCoordinates.x) * TextureFormats::DecodeTexel(Format, data, width, x0, y0) + (imageSpaceCoordinates.x - floorVec.x) * TextureFormats::DecodeTexel(Format, data, width, x1, y0);
+    const glm::vec4 fx2 = (ceilVec.x - imageSpaceCoordinates.x) * TextureFormats::DecodeTexel(Format, data, width, x0, y1) + (imageSpaceCoordinates.x - floorVec.x) * TextureFormats::DecodeTexel(Format, data, width, x1, y1);
+    return (ceilVec.y - imageSpaceCoordinates.y) * fx1 + (imageSpaceCoordinates.y - floorVec.y) * fx2;
+}
+
+#if defined(__AVX2__)
+// Channel c of gathered 8-bit texels as floats in [0, 1].
+inline __m256 DecodeChannel(__m256i texels, int channel)
+{
+    const __m256i value = _mm256_and_si256(_mm256_srli_epi32(texels, 8 * channel), _mm256_set1_epi32(0xff));
+    return _mm256_div_ps(_mm256_cvtepi32_ps(value), _mm256_set1_ps(255.f));
+}
+
+inline __m256 Bilinear(__m256 c00, __m256 c10, __m256 c01, __m256 c11, __m256 wx0, __m256 wx1, __m256 wy0, __m256 wy1)
+{
+    const __m256 fx1 = _mm256_add_ps(_mm256_mul_ps(wx0, c00), _mm256_mul_ps(wx1, c10));
+    const __m256 fx2 = _mm256_add_ps(_mm256_mul_ps(wx0, c01), _mm256_mul_ps(wx1, c11));
+    return _mm256_add_ps(_mm256_mul_ps(wy0, fx1), _mm256_mul_ps(wy1, fx2));
+}
+
+// Eight lookups at a time for R8, RGB8 and RGBA8, using one 32-bit gather per corner. The gathers may read up to
+// three bytes past the last texel, which the mip storage pads for. Returns how many coordinates were handled.
+template<TextureFormat Format, typename Wrap>
+size_t SampleBilinearBatchAVX2(const unsigned char* data, int width, int height, const Wrap& wrap, const glm::vec2* coords, glm::vec4* output, size_t count)
+{
+    const int bytesPerTexel = (Format == TextureFormat::R8) ? 1 : ((Format == TextureFormat::RGB8) ? 3 : 4);
+    const __m256 size = _mm256_setr_ps(static_cast<float>(width), static_cast<float>(height), static_cast<float>(width), static_cast<float>(height),
+        static_cast<float>(width), static_cast<float>(height), static_cast<float>(width), static_cast<float>(height));
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i rowBytes = _mm256_set1_epi32(width * bytesPerTexel);
+    const __m256i texelBytes = _mm256_set1_epi32(bytesPerTexel);
+    const int* base = reinterpret_cast<const int*>(data);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        // Split the interleaved (u, v) pairs into x and y in image space.
+        const float* uv = &coords[i].x;
+        const __m256 first = _mm256_sub_ps(_mm256_mul_ps(_mm256_loadu_ps(uv), size), half);
+        const __m256 second = _mm256_sub_ps(_mm256_mul_ps(_mm256_loadu_ps(uv + 8), size), half);
+        const __m256 x = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0))), _MM_SHUFFLE(3, 1, 2, 0)));
+        const __m256 y = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1))), _MM_SHUFFLE(3, 1, 2, 0)));
+
+        const __m256 floorX = _mm256_floor_ps(x);
+        const __m256 floorY = _mm256_floor_ps(y);
+        const __m256 wx0 = _mm256_sub_ps(_mm256_add_ps(floorX, _mm256_set1_ps(1.f)), x);
+        const __m256 wx1 = _mm256_sub_ps(x, floorX);
+        const __m256 wy0 = _mm256_sub_ps(_mm256_add_ps(floorY, _mm256_set1_ps(1.f)), y);
+        const __m256 wy1 = _mm256_sub_ps(y, floorY);
+
+        const __m256i ix = _mm256_cvttps_epi32(floorX);
+        const __m256i iy = _mm256_cvttps_epi32(floorY);
+        const __m256i x0 = _mm256_mullo_epi32(wrap.WrapX(ix), texelBytes);
+        const __m256i x1 = _mm256_mullo_epi32(wrap.WrapX(_mm256_add_epi32(ix, one)), texelBytes);
+        const __m256i y0 = _mm256_mullo_epi32(wrap.WrapY(iy), rowBytes);
+        const __m256i y1 = _mm256_mullo_epi32(wrap.WrapY(_mm256_add_epi32(iy, one)), rowBytes);
+
+        const __m256i t00 = _mm256_i32gather_epi32(base, _mm256_add_epi32(y0, x0), 1);
+        const __m256i t10 = _mm256_i32gather_epi32(base, _mm256_add_epi32(y0, x1), 1);
+        const __m256i t01 = _mm256_i32gather_epi32(base, _mm256_add_epi32(y1, x0), 1);
+        const __m256i t11 = _mm256_i32gather_epi32(base, _mm256_add_epi32(y1, x1), 1);
+
+        alignas(32) float channels[4][8];
+        const int decodedChannels = (Format == TextureFormat::R8) ? 1 : ((Format == TextureFormat::RGB8) ? 3 : 4);
+        for (int c = 0; c < decodedChannels; ++c) {
+            _mm256_store_ps(channels[c], Bilinear(DecodeChannel(t00, c), DecodeChannel(t10, c), DecodeChannel(t01, c), DecodeChannel(t11, c), wx0, wx1, wy0, wy1));
+        }
+        for (int k = 0; k < 8; ++k) {
+            if (Format == TextureFormat::R8) {
+                output[i + k] = glm::vec4(channels[0][k], channels[0][k], channels[0][k], 1.f);
+            } else if (Format == TextureFormat::RGB8) {
+                output[i + k] = glm::vec4(channels[0][k], channels[1][k], channels[2][k], 1.f);
+            } else {
+                output[i + k] = glm::vec4(channels[0][k], channels[1][k], channels[2][k], channels[3][k]);
+            }
+        }
+    }
+    return i;
+}
+#endif
+
+template<TextureFormat Format, typename Wrap>
+void BilinearBatch(const unsigned char* data, int width, int height, const glm::vec2* coords, glm::vec4* output, size_t count)
+{
+    const Wrap wrap(width, height);
+    size_t i = 0;
+#if defined(__AVX2__)
+    if (Format == TextureFormat::R8 || Format == TextureFormat::RGB8 || Format == TextureFormat::RGBA8) {
+        i = SampleBilinearBatchAVX2<Format>(data, width, height, wrap, coords, output, count);
+    }
+#endif
+    const glm::vec2 size(width, height);
+    for (; i < count; ++i) {
+        output[i] = SampleBilinearTexel<Format>(data, width, wrap, ToTexelSpace(coords[i], size));
+    }
+}
+
+template<typename Wrap>
+void BilinearBatch(TextureFormat format, const unsigned char* data, int width, int height, const glm::vec2* coords, glm::vec4* output, size_t count)
+{
+    switch (format) {
+    case TextureFormat::R8:
+        BilinearBatch<TextureFormat::R8, Wrap>(data, width, height, coords, output, count);
+        break;
+    case TextureFormat::RG8:
+        BilinearBatch<TextureFormat::RG8, Wrap>(data, width, height, coords, output, count);
+        break;
+    case TextureFormat::RGB8:
+        BilinearBatch<TextureFormat::RGB8, Wrap>(data, width, height, coords, output, count);
+        break;
+    case TextureFormat::RGBA8:
+        BilinearBatch<TextureFormat::RGBA8, Wrap>(data, width, height, coords, output, count);
+        break;
+    case TextureFormat::RGBA16F:
+        BilinearBatch<TextureFormat::RGBA16F, Wrap>(data, width, height, coords, output, count);
+        break;
+    case TextureFormat::BC1:
+        BilinearBatch<TextureFormat::BC1, Wrap>(data, width, height, coords, output, count);
+        break;
+    }
+}
+}
+
+Texture2D::Texture2D(unsigned char* rawData, int width, int height, TextureFormat inputFormat):
+    Texture(), textureData(rawData), texWidth(width), texHeight(height), format(inputFormat),
+    isPowerOfTwo(IsPowerOfTwo(width) && IsPowerOfTwo(height))
+{
+    // Failed loads leave textureData empty; there is nothing to filter then.
+    if (textureData) {
+        GenerateMipLevels(textureData);
+    }
+
+    // Other formats have been re-encoded into mipData.
+    if (format != TextureFormat::RGBA8) {
+        delete[] textureData;
+        textureData = nullptr;
+    }
+}
+
+Texture2D::Texture2D(float* rawData, int width, int height, TextureFormat inputFormat):
+    Texture(), textureData(nullptr), texWidth(width), texHeight(height), format(inputFormat),
+    isPowerOfTwo(IsPowerOfTwo(width) && IsPowerOfTwo(height))
+{
+    if (rawData) {
+        GenerateMipLevels(rawData);
+    }
+    delete[] rawData;
 }
 
 Texture2D::~Texture2D()
@@ -10,9 +300,155 @@ Texture2D::~Texture2D()
     delete[] textureData;
 }
 
+size_t Texture2D::GetMemoryBytes() const
+{
+    return mipData.size() + (textureData ? static_cast<size_t>(texWidth) * texHeight * 4 : 0);
+}
+
+glm::ivec2 Texture2D::GetNextMipSize(const glm::ivec2& size)
+{
+    return glm::max(size / 2, glm::ivec2(1));
+}
+
+void Texture2D::DownsampleLevel(const unsigned char* source, const glm::ivec2& sourceSize, unsigned char* destination)
+{
+    DownsampleBox(source, sourceSize, GetNextMipSize(sourceSize), destination);
+}
+
+void Texture2D::DownsampleLevel(const float* source, const glm::ivec2& sourceSize, float* destination)
+{
+    DownsampleBox(source, sourceSize, GetNextMipSize(sourceSize), destination);
+}
+
+template<typename T>
+void Texture2D::GenerateMipLevels(const T* rgbaData)
+{
+    PROFILE_ZONE(zone, "Generate Mip Levels");
+    std::vector<glm::ivec2> sizes(1, glm::ivec2(texWidth, texHeight));
+    while (sizes.back().x > 1 || sizes.back().y > 1) {
+        sizes.push_back(GetNextMipSize(sizes.back()));
+    }
+
+    // RGBA8 input that stays RGBA8 is used as level 0 directly and downsampled straight into place.
+    const bool inPlace = std::is_same<T, unsigned char>::value && format == TextureFormat::RGBA8;
+    std::vector<size_t> offsets(sizes.size(), 0);
+    size_t totalBytes = 0;
+    for (size_t i = inPlace ? 1 : 0; i < sizes.size(); ++i) {
+        offsets[i] = totalBytes;
+        totalBytes += TextureFormats::GetLevelBytes(format, sizes[i].x, sizes[i].y);
+    }
+    // Padding for the 32-bit gathers of the batch paths, which can read past the last texel of the 8-bit formats.
+    mipData.resize(totalBytes + 4);
+
+    // Otherwise only the current and the next level of the input are kept around while encoding.
+    std::vector<T> currentLevel;
+    std::vector<T> nextLevel;
+    const T* levelData = rgbaData;
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        unsigned char* destination = (inPlace && i == 0) ? textureData : mipData.data() + offsets[i];
+        if (!inPlace) {
+            TextureFormats::EncodeLevel(format, levelData, sizes[i].x, sizes[i].y, destination);
+        }
+        mipLevels.push_back({ destination, sizes[i].x, sizes[i].y });
+
+        if (i + 1 == sizes.size()) {
+            break;
+        }
+        if (inPlace) {
+            T* nextDestination = reinterpret_cast<T*>(mipData.data() + offsets[i + 1]);
+            DownsampleLevel(levelData, sizes[i], nextDestination);
+            levelData = nextDestination;
+        } else {
+            nextLevel.resize(static_cast<size_t>(sizes[i + 1].x) * sizes[i + 1].y * 4);
+            DownsampleLevel(levelData, sizes[i], nextLevel.data());
+            currentLevel.swap(nextLevel);
+            levelData = currentLevel.data();
+        }
+    }
+}
+
 glm::vec4 Texture2D::Sample(const glm::vec2& coord) const
 {
-    const glm::vec2 imageSpaceCoordinates = coord * glm::vec2(texWidth, texHeight);
+    return SampleBilinear(mipLevels[0], coord);
+}
+
+glm::vec4 Texture2D::SampleGrad(const glm::vec2& coord, const glm::vec2& dUVdx, const glm::vec2& dUVdy) const
+{
+    return SampleLevel(coord, ComputeLevel(dUVdx, dUVdy));
+}
+
+float Texture2D::ComputeLevel(const glm::vec2& dUVdx, const glm::vec2& dUVdy) const
+{
+    const glm::vec2 size(texWidth, texHeight);
+    const float footprint = std::max(glm::length2(dUVdx * size), glm::length2(dUVdy * size));
+    if (footprint <= 1.f) {
+        return 0.f;
+    }
+    // log2 of the footprint length, taken on the squared length.
+    return 0.5f * std::log2(footprint);
+}
+
+void Texture2D::SampleBatch(const glm::vec2* coords, glm::vec4* output, size_t count) const
+{
+    SampleBilinearBatch(mipLevels[0], coords, output, count);
+}
+
+void Texture2D::SampleGradBatch(const glm::vec2* coords, const glm::vec2* dUVdx, const glm::vec2* dUVdy, glm::vec4* output, size_t count) const
+{
+    // Coherent batches mostly land between the same two levels. Those chunks are filtered as two batches, anything
+    // else falls back to per-coordinate lookups.
+    const size_t chunkSize = 64;
+    float blend[chunkSize];
+    glm::vec4 upperSamples[chunkSize];
+    const float maxLevel = static_cast<float>(mipLevels.size() - 1);
+    for (size_t start = 0; start < count; start += chunkSize) {
+        const size_t chunkCount = std::min(chunkSize, count - start);
+        int lowestLevel = static_cast<int>(mipLevels.size());
+        int highestLevel = -1;
+        bool needsUpper = false;
+        for (size_t i = 0; i < chunkCount; ++i) {
+            const float level = glm::clamp(ComputeLevel(dUVdx[start + i], dUVdy[start + i]), 0.f, maxLevel);
+            const int lowerLevel = static_cast<int>(level);
+            blend[i] = level - lowerLevel;
+            needsUpper = needsUpper || blend[i] > 0.f;
+            lowestLevel = std::min(lowestLevel, lowerLevel);
+            highestLevel = std::max(highestLevel, lowerLevel);
+        }
+
+        if (lowestLevel != highestLevel) {
+            for (size_t i = 0; i < chunkCount; ++i) {
+                output[start + i] = SampleGrad(coords[start + i], dUVdx[start + i], dUVdy[start + i]);
+            }
+            continue;
+        }
+
+        SampleBilinearBatch(mipLevels[lowestLevel], coords + start, output + start, chunkCount);
+        if (needsUpper) {
+            SampleBilinearBatch(mipLevels[lowestLevel + 1], coords + start, upperSamples, chunkCount);
+            for (size_t i = 0; i < chunkCount; ++i) {
+                if (blend[i] > 0.f) {
+                    output[start + i] = glm::mix(output[start + i], upperSamples[i], blend[i]);
+                }
+            }
+        }
+    }
+}
+
+glm::vec4 Texture2D::SampleLevel(const glm::vec2& coord, float level) const
+{
+    const float clampedLevel = glm::clamp(level, 0.f, static_cast<float>(mipLevels.size() - 1));
+    const int lowerLevel = static_cast<int>(clampedLevel);
+    const float blend = clampedLevel - lowerLevel;
+    const glm::vec4 lowerSample = SampleBilinear(mipLevels[lowerLevel], coord);
+    if (blend <= 0.f) {
+        return lowerSample;
+    }
+    return glm::mix(lowerSample, SampleBilinear(mipLevels[lowerLevel + 1], coord), blend);
+}
+
+glm::vec4 Texture2D::SampleBilinear(const MipLevel& level, const glm::vec2& coord) const
+{
+    const glm::vec2 imageSpaceCoordinates = ToTexelSpace(coord, glm::vec2(level.width, level.height));
 
     glm::vec2 floorVec(std::floor(imageSpaceCoordinates.x), std::floor(imageSpaceCoordinates.y));
     glm::vec2 ceilVec(floorVec.x + 1.f, floorVec.y + 1.f);
@@ -23,41 +459,44 @@ glm::vec4 Texture2D::Sample(const glm::vec2& coord) const
     const glm::ivec2 q21(ceilVec.x, floorVec.y);
     const glm::ivec2 q22(ceilVec);
 
-    const glm::vec4 fx1 = (ceilVec.x - imageSpaceCoordinates.x) * InternalSample(q11) + (imageSpaceCoordinates.x - floorVec.x) * InternalSample(q21);
-    const glm::vec4 fx2 = (ceilVec.x - imageSpaceCoordinates.x) * InternalSample(q12) + (imageSpaceCoordinates.x - floorVec.x) * InternalSample(q22);
+    const glm::vec4 fx1 = (ceilVec.x - imageSpaceCoordinates.x) * InternalSample(level, q11) + (imageSpaceCoordinates.x - floorVec.x) * InternalSample(level, q21);
+    const glm::vec4 fx2 = (ceilVec.x - imageSpaceCoordinates.x) * InternalSample(level, q12) + (imageSpaceCoordinates.x - floorVec.x) * InternalSample(level, q22);
     return (ceilVec.y - imageSpaceCoordinates.y) * fx1 + (imageSpaceCoordinates.y - floorVec.y) * fx2;
 }
 
-glm::ivec2 Texture2D::HandleBorderCondition(const glm::ivec2& coord) const
+void Texture2D::SampleBilinearBatch(const MipLevel& level, const glm::vec2* coords, glm::vec4* output, size_t count) const
+{
+    if (isPowerOfTwo) {
+        BilinearBatch<RepeatPowerOfTwo>(format, level.data, level.width, level.height, coords, output, count);
+    } else {
+        BilinearBatch<RepeatModulo>(format, level.data, level.width, level.height, coords, output, count);
+    }
+}
+
+glm::ivec2 Texture2D::HandleBorderCondition(const MipLevel& level, const glm::ivec2& coord) const
 {
     // By default, do repeat across borders
     glm::ivec2 result = coord;
     if (result.x < 0) {
-        result.x = texWidth + result.x % texWidth;
+        result.x = level.width + result.x % level.width;
     }
 
     if (result.y < 0) {
-        result.y = texHeight + result.y % texHeight;
+        result.y = level.height + result.y % level.height;
     }
 
-    result.x = result.x % texWidth;
-    result.y = result.y % texHeight;
+    result.x = result.x % level.width;
+    result.y = result.y % level.height;
     return result;
 }
 
-glm::vec4 Texture2D::InternalSample(const glm::ivec2& coord) const
+glm::vec4 Texture2D::InternalSample(const MipLevel& level, const glm::ivec2& coord) const
 {
-    int index = ComputeLinearIndex(HandleBorderCondition(coord));
-    glm::vec4 result = glm::vec4(textureData[index], textureData[index + 1], textureData[index + 2], textureData[index + 3]) / 255.f;
-    return result;
+    const glm::ivec2 texel = HandleBorderCondition(level, coord);
+    return TextureFormats::DecodeTexel(format, level.data, level.width, texel.x, texel.y);
 }
 
 glm::vec4 Texture2D::Sample(const glm::vec3& coord) const
 {
     return Sample(glm::vec2(coord));
 }
-
-int Texture2D::ComputeLinearIndex(const glm::ivec2& pixel) const
-{
-    return (pixel.x + pixel.y * texWidth) * 4;
-}
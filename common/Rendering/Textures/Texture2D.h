@@ -1,21 +1,65 @@
 #pragma once
 
 #include "common/Rendering/Textures/Texture.h"
+#include "common/Rendering/Textures/TextureFormat.h"
 
+// Texel (x, y) of a mip level of size (width, height) is centered on ((x + 0.5) / width, (y + 0.5) / height) in uv.
 class Texture2D : public Texture
 {
 public:
-    Texture2D(unsigned char* rawData, int width, int height);
+    // Takes ownership of RGBA8 or RGBA32F texels and stores every mip level in the given format.
+    Texture2D(unsigned char* rawData, int width, int height, TextureFormat format = TextureFormat::RGBA8);
+    Texture2D(float* rawData, int width, int height, TextureFormat format = TextureFormat::RGBA16F);
     virtual ~Texture2D();
 
     virtual glm::vec4 Sample(const glm::vec2& coord) const override;
     virtual glm::vec4 Sample(const glm::vec3& coord) const override;
+
+    // Trilinear lookup into the mip chain. The level is chosen from the larger of the two footprint axes.
+    virtual glm::vec4 SampleGrad(const glm::vec2& coord, const glm::vec2& dUVdx, const glm::vec2& dUVdy) const override;
+    glm::vec4 SampleLevel(const glm::vec2& coord, float level) const;
+
+    // Specialized per format and wrap mode, with AVX2 gathers for the 8-bit formats when compiled in
+    // (RAYTRACER_AVX2). Results match Sample and SampleGrad up to float rounding.
+    virtual void SampleBatch(const glm::vec2* coords, glm::vec4* output, size_t count) const override;
+    virtual void SampleGradBatch(const glm::vec2* coords, const glm::vec2* dUVdx, const glm::vec2* dUVdy, glm::vec4* output, size_t count) const override;
+
+    int GetTotalMipLevels() const { return static_cast<int>(mipLevels.size()); }
+    TextureFormat GetFormat() const { return format; }
+    // Storage used by all mip levels.
+    virtual size_t GetMemoryBytes() const override;
+
+    // Size of the mip level below the given one.
+    static glm::ivec2 GetNextMipSize(const glm::ivec2& size);
+    // Box filter of an RGBA8 or RGBA32F image into the next mip level, averaging the part of the image each texel of
+    // the next level covers so that the texel centers of both levels line up. Even sizes average 2x2 texels, odd ones
+    // weight the up to 4x4 texels each covers in part, and a dimension that is already 1 is reused.
+    static void DownsampleLevel(const unsigned char* source, const glm::ivec2& sourceSize, unsigned char* destination);
+    static void DownsampleLevel(const float* source, const glm::ivec2& sourceSize, float* destination);
 private:
-    glm::vec4 InternalSample(const glm::ivec2& coord) const;
-    glm::ivec2 HandleBorderCondition(const glm::ivec2& coord) const;
-    int ComputeLinearIndex(const glm::ivec2& pixel) const;
+    struct MipLevel
+    {
+        const unsigned char* data;
+        int width;
+        int height;
+    };
+
+    template<typename T>
+    void GenerateMipLevels(const T* rgbaData);
+    glm::vec4 SampleBilinear(const MipLevel& level, const glm::vec2& coord) const;
+    void SampleBilinearBatch(const MipLevel& level, const glm::vec2* coords, glm::vec4* output, size_t count) const;
+    float ComputeLevel(const glm::vec2& dUVdx, const glm::vec2& dUVdy) const;
+    glm::vec4 InternalSample(const MipLevel& level, const glm::ivec2& coord) const;
+    glm::ivec2 HandleBorderCondition(const MipLevel& level, const glm::ivec2& coord) const;
 
     unsigned char* textureData;
     int texWidth;
     int texHeight;
-};
\ No newline at end of file
+    TextureFormat format;
+    // Every level of a power-of-two texture is a power of two as well, so the batch paths can wrap with masks.
+    bool isPowerOfTwo;
+
+    // For RGBA8 input stored as RGBA8, level 0 points at textureData. Everything else lives in mipData.
+    std::vector<MipLevel> mipLevels;
+    std::vector<unsigned char> mipData;
+};
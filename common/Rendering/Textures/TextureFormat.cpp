@@ -0,0 +1,243 @@
+#include "common/Rendering/Textures/TextureFormat.h"
+
+namespace TextureFormats
+{
+
+namespace
+{
+unsigned char ToUnorm8(float value)
+{
+    return static_cast<unsigned char>(glm::clamp(value, 0.f, 1.f) * 255.f + 0.5f);
+}
+
+glm::vec4 FetchRGBA(const unsigned char* rgbaData, size_t texel)
+{
+    const unsigned char* p = rgbaData + texel * 4;
+    return glm::vec4(p[0], p[1], p[2], p[3]) / 255.f;
+}
+
+glm::vec4 FetchRGBA(const float* rgbaData, size_t texel)
+{
+    const float* p = rgbaData + texel * 4;
+    return glm::vec4(p[0], p[1], p[2], p[3]);
+}
+
+uint16_t EncodeRGB565(const glm::vec3& color)
+{
+    const glm::vec3 clamped = glm::clamp(color, 0.f, 1.f);
+    const uint16_t r = static_cast<uint16_t>(clamped.r * 31.f + 0.5f);
+    const uint16_t g = static_cast<uint16_t>(clamped.g * 63.f + 0.5f);
+    const uint16_t b = static_cast<uint16_t>(clamped.b * 31.f + 0.5f);
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+// Endpoints are the corners of the block's colour bounding box, which is quick and good enough for smooth images.
+void EncodeBC1Block(const glm::vec3 texels[16], unsigned char* output)
+{
+    glm::vec3 minimum = texels[0];
+    glm::vec3 maximum = texels[0];
+    for (int i = 1; i < 16; ++i) {
+        minimum = glm::min(minimum, texels[i]);
+        maximum = glm::max(maximum, texels[i]);
+    }
+
+    uint16_t color0 = EncodeRGB565(maximum);
+    uint16_t color1 = EncodeRGB565(minimum);
+    if (color0 < color1) {
+        std::swap(color0, color1);
+    }
+
+    uint32_t indices = 0;
+    if (color0 != color1) {
+        const glm::vec3 endpoint0 = DecodeRGB565(color0);
+        const glm::vec3 endpoint1 = DecodeRGB565(color1);
+        const glm::vec3 palette[4] = { endpoint0, endpoint1, (2.f * endpoint0 + endpoint1) / 3.f, (endpoint0 + 2.f * endpoint1) / 3.f };
+        for (int i = 0; i < 16; ++i) {
+            uint32_t bestIndex = 0;
+            float bestDistance = std::numeric_limits<float>::max();
+            for (uint32_t p = 0; p < 4; ++p) {
+                const float distance = glm::length2(texels[i] - palette[p]);
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    bestIndex = p;
+                }
+            }
+            indices |= bestIndex << (2 * i);
+        }
+    }
+
+    output[0] = static_cast<unsigned char>(color0 & 0xff);
+    output[1] = static_cast<unsigned char>(color0 >> 8);
+    output[2] = static_cast<unsigned char>(color1 & 0xff);
+    output[3] = static_cast<unsigned char>(color1 >> 8);
+    for (int i = 0; i < 4; ++i) {
+        output[4 + i] = static_cast<unsigned char>((indices >> (8 * i)) & 0xff);
+    }
+}
+
+template<typename T>
+void EncodeLevelFrom(TextureFormat format, const T* rgbaData, int width, int height, unsigned char* output)
+{
+    if (format == TextureFormat::BC1) {
+        // Blocks that hang over the edge repeat the last row and column.
+        glm::vec3 texels[16];
+        for (int blockY = 0; blockY < height; blockY += 4) {
+            for (int blockX = 0; blockX < width; blockX += 4) {
+                for (int i = 0; i < 16; ++i) {
+                    const int x = std::min(blockX + i % 4, width - 1);
+                    const int y = std::min(blockY + i / 4, height - 1);
+                    texels[i] = glm::vec3(FetchRGBA(rgbaData, static_cast<size_t>(y) * width + x));
+                }
+                EncodeBC1Block(texels, output);
+                output += 8;
+            }
+        }
+        return;
+    }
+
+    const size_t totalTexels = static_cast<size_t>(width) * height;
+    for (size_t texel = 0; texel < totalTexels; ++texel) {
+        const glm::vec4 value = FetchRGBA(rgbaData, texel);
+        switch (format) {
+        case TextureFormat::R8:
+            // Masks are often stored as grey RGB, so take the average rather than just red.
+            output[texel] = ToUnorm8((value.r + value.g + value.b) / 3.f);
+            break;
+        case TextureFormat::RG8:
+            output[texel * 2] = ToUnorm8(value.r);
+            output[texel * 2 + 1] = ToUnorm8(value.g);
+            break;
+        case TextureFormat::RGB8:
+            for (int c = 0; c < 3; ++c) {
+                output[texel * 3 + c] = ToUnorm8(value[c]);
+            }
+            break;
+        case TextureFormat::RGBA8:
+            for (int c = 0; c < 4; ++c) {
+                output[texel * 4 + c] = ToUnorm8(value[c]);
+            }
+            break;
+        case TextureFormat::RGBA16F: {
+            const uint16_t halves[4] = { FloatToHalf(value.r), FloatToHalf(value.g), FloatToHalf(value.b), FloatToHalf(value.a) };
+            memcpy(output + texel * 8, halves, sizeof(halves));
+            break;
+        }
+        case TextureFormat::BC1:
+            break;
+        }
+    }
+}
+}
+
+std::string GetFormatName(TextureFormat format)
+{
+    switch (format) {
+    case TextureFormat::R8:
+        return "R8";
+    case TextureFormat::RG8:
+        return "RG8";
+    case TextureFormat::RGB8:
+        return "RGB8";
+    case TextureFormat::RGBA8:
+        return "RGBA8";
+    case TextureFormat::RGBA16F:
+        return "RGBA16F";
+    case TextureFormat::BC1:
+        return "BC1";
+    }
+    return "unknown";
+}
+
+bool ParseFormat(const std::string& name, TextureFormat& output)
+{
+    const TextureFormat formats[] = { TextureFormat::R8, TextureFormat::RG8, TextureFormat::RGB8, TextureFormat::RGBA8, TextureFormat::RGBA16F, TextureFormat::BC1 };
+    for (TextureFormat format : formats) {
+        if (GetFormatName(format) == name) {
+            output = format;
+            return true;
+        }
+    }
+    return false;
+}
+
+int GetBytesPerTexel(TextureFormat format)
+{
+    switch (format) {
+    case TextureFormat::R8:
+        return 1;
+    case TextureFormat::RG8:
+        return 2;
+    case TextureFormat::RGB8:
+        return 3;
+    case TextureFormat::RGBA8:
+        return 4;
+    case TextureFormat::RGBA16F:
+        return 8;
+    case TextureFormat::BC1:
+        return 0;
+    }
+    return 0;
+}
+
+size_t GetLevelBytes(TextureFormat format, int width, int height)
+{
+    if (format == TextureFormat::BC1) {
+        return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * 8;
+    }
+    return static_cast<size_t>(width) * height * GetBytesPerTexel(format);
+}
+
+void EncodeLevel(TextureFormat format, const unsigned char* rgbaData, int width, int height, unsigned char* output)
+{
+    if (format == TextureFormat::RGBA8) {
+        memcpy(output, rgbaData, GetLevelBytes(format, width, height));
+        return;
+    }
+    EncodeLevelFrom(format, rgbaData, width, height, output);
+}
+
+void EncodeLevel(TextureFormat format, const float* rgbaData, int width, int height, unsigned char* output)
+{
+    EncodeLevelFrom(format, rgbaData, width, height, output);
+}
+
+uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+    const uint32_t floatExponent = (bits >> 23) & 0xffu;
+    uint32_t mantissa = bits & 0x7fffffu;
+
+    if (floatExponent == 0xff) {
+        // Infinity stays infinity, NaN stays NaN.
+        return static_cast<uint16_t>(sign | 0x7c00u | (mantissa ? 0x200u : 0u));
+    }
+
+    const int exponent = static_cast<int>(floatExponent) - 127 + 15;
+    if (exponent >= 31) {
+        return static_cast<uint16_t>(sign | 0x7c00u);
+    }
+    if (exponent <= 0) {
+        if (exponent < -10) {
+            return sign;
+        }
+        // Subnormal half: shift the mantissa, including the implicit leading bit, and round to nearest.
+        mantissa |= 0x800000u;
+        const int shift = 14 - exponent;
+        uint32_t half = mantissa >> shift;
+        if ((mantissa >> (shift - 1)) & 1u) {
+            ++half;
+        }
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    // Rounding may carry into the exponent, which correctly rounds up to the next power of two (or infinity).
+    uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000u) {
+        ++half;
+    }
+    return static_cast<uint16_t>(sign | half);
+}
+
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "common/common.h"
+#include <cstring>
+
+// Storage formats for Texture2D. Every format decodes to RGBA in [0, 1] (or unbounded for RGBA16F).
+enum class TextureFormat
+{
+    // Single channel, decoded as grey (r, r, r, 1). For masks.
+    R8,
+    // Two channels for tangent-space normal maps. Blue is reconstructed so that the normal has unit length.
+    RG8,
+    RGB8,
+    RGBA8,
+    // Half-float RGBA for HDR inputs.
+    RGBA16F,
+    // 4x4 blocks of two RGB565 endpoints and 2-bit indices (DXT1), 8 bytes per block. Opaque only.
+    BC1
+};
+
+namespace TextureFormats
+{
+
+std::string GetFormatName(TextureFormat format);
+bool ParseFormat(const std::string& name, TextureFormat& output);
+
+// Bytes per texel; block-compressed formats return 0.
+int GetBytesPerTexel(TextureFormat format);
+size_t GetLevelBytes(TextureFormat format, int width, int height);
+
+// Encodes a whole image from RGBA8 or RGBA32F texels.
+void EncodeLevel(TextureFormat format, const unsigned char* rgbaData, int width, int height, unsigned char* output);
+void EncodeLevel(TextureFormat format, const float* rgbaData, int width, int height, unsigned char* output);
+
+uint16_t FloatToHalf(float value);
+
+inline float HalfToFloat(uint16_t value)
+{
+    const uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+    uint32_t exponent = (value >> 10) & 0x1fu;
+    uint32_t mantissa = value & 0x3ffu;
+    uint32_t bits;
+    if (exponent == 0) {
+        if (mantissa == 0) {
+            bits = sign;
+        } else {
+            // Renormalize the subnormal.
+            exponent = 127 - 15 + 1;
+            while (!(mantissa & 0x400u)) {
+                mantissa <<= 1;
+                --exponent;
+            }
+            bits = sign | (exponent << 23) | ((mantissa & 0x3ffu) << 13);
+        }
+    } else if (exponent == 31) {
+        bits = sign | 0x7f800000u | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+inline glm::vec3 DecodeRGB565(uint16_t color)
+{
+    return glm::vec3((color >> 11) & 0x1f, (color >> 5) & 0x3f, color & 0x1f) / glm::vec3(31.f, 63.f, 31.f);
+}
+
+inline glm::vec4 DecodeBC1Texel(const unsigned char* block, int x, int y)
+{
+    const uint16_t color0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+    const uint16_t color1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+    const uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+    const uint32_t index = (indices >> (2 * (y * 4 + x))) & 3u;
+
+    const glm::vec3 endpoint0 = DecodeRGB565(color0);
+    const glm::vec3 endpoint1 = DecodeRGB565(color1);
+    switch (index) {
+    case 0:
+        return glm::vec4(endpoint0, 1.f);
+    case 1:
+        return glm::vec4(endpoint1, 1.f);
+    case 2:
+        return (color0 > color1) ? glm::vec4((2.f * endpoint0 + endpoint1) / 3.f, 1.f) : glm::vec4(0.5f * (endpoint0 + endpoint1), 1.f);
+    default:
+        return (color0 > color1) ? glm::vec4((endpoint0 + 2.f * endpoint1) / 3.f, 1.f) : glm::vec4(0.f, 0.f, 0.f, 1.f);
+    }
+}
+
+// Decodes the texel at (x, y) of an image of the given width.
+inline glm::vec4 DecodeTexel(TextureFormat format, const unsigned char* data, int width, int x, int y)
+{
+    const size_t texel = static_cast<size_t>(y) * width + x;
+    switch (format) {
+    case TextureFormat::R8: {
+        const float value = data[texel] / 255.f;
+        return glm::vec4(value, value, value, 1.f);
+    }
+    case TextureFormat::RG8: {
+        const unsigned char* p = data + texel * 2;
+        const glm::vec2 xy = glm::vec2(p[0], p[1]) / 255.f * 2.f - 1.f;
+        const float z = std::sqrt(std::max(0.f, 1.f - glm::dot(xy, xy)));
+        return glm::vec4(p[0] / 255.f, p[1] / 255.f, z * 0.5f + 0.5f, 1.f);
+    }
+    case TextureFormat::RGB8: {
+        const unsigned char* p = data + texel * 3;
+        return glm::vec4(p[0], p[1], p[2], 255.f) / 255.f;
+    }
+    case TextureFormat::RGBA8: {
+        const unsigned char* p = data + texel * 4;
+        return glm::vec4(p[0], p[1], p[2], p[3]) / 255.f;
+    }
+    case TextureFormat::RGBA16F: {
+        uint16_t p[4];
+        memcpy(p, data + texel * 8, sizeof(p));
+        return glm::vec4(HalfToFloat(p[0]), HalfToFloat(p[1]), HalfToFloat(p[2]), HalfToFloat(p[3]));
+    }
+    case TextureFormat::BC1: {
+        const size_t block = static_cast<size_t>(y / 4) * ((width + 3) / 4) + x / 4;
+        return DecodeBC1Texel(data + block * 8, x % 4, y % 4);
+    }
+    }
+    return glm::vec4();
+}
+
+}
@@ -0,0 +1,172 @@
+#include "common/Rendering/Textures/TiledTexture.h"
+#include "common/Utility/Texture/TextureCache.h"
+#include <atomic>
+#include <fstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+std::atomic<uint32_t> nextTextureId(0);
+}
+
+TiledTexture::TiledTexture():
+    Texture(), textureId(nextTextureId++),
+#ifdef _WIN32
+    file(nullptr)
+#else
+    fileDescriptor(-1)
+#endif
+{
+}
+
+TiledTexture::~TiledTexture()
+{
+#ifdef _WIN32
+    if (file) {
+        fclose(file);
+    }
+#else
+    if (fileDescriptor >= 0) {
+        close(fileDescriptor);
+    }
+#endif
+}
+
+std::shared_ptr<TiledTexture> TiledTexture::Open(const std::string& filename, AccessMode mode)
+{
+    std::shared_ptr<TiledTexture> texture(new TiledTexture());
+    texture->filename = filename;
+
+    std::ifstream input(filename, std::ios::binary);
+    if (!input || !TiledTextureFile::ReadHeader(input, texture->header, texture->levels)) {
+        std::cerr << "ERROR: Failed to open tiled texture " << filename << std::endl;
+        return nullptr;
+    }
+
+    if (mode == AccessMode::MEMORY_MAPPED) {
+        texture->mappedFile = make_unique<MappedFile>();
+        const TiledTextureFile::LevelInfo& lastLevel = texture->levels.back();
+        const uint64_t requiredSize = TiledTextureFile::GetTileOffset(texture->header, lastLevel, lastLevel.tilesX - 1, lastLevel.tilesY - 1) + TiledTextureFile::GetTileBytes(texture->header);
+        if (!texture->mappedFile->Open(filename) || texture->mappedFile->GetSize() < requiredSize) {
+            std::cerr << "ERROR: Failed to map tiled texture " << filename << std::endl;
+            return nullptr;
+        }
+        return texture;
+    }
+
+#ifdef _WIN32
+    texture->file = fopen(filename.c_str(), "rb");
+    if (!texture->file) {
+#else
+    texture->fileDescriptor = open(filename.c_str(), O_RDONLY);
+    if (texture->fileDescriptor < 0) {
+#endif
+        std::cerr << "ERROR: Failed to open tiled texture " << filename << std::endl;
+        return nullptr;
+    }
+    return texture;
+}
+
+bool TiledTexture::ReadTile(int level, int tileX, int tileY, std::vector<unsigned char>& output) const
+{
+    PROFILE_ZONE(zone, "Read Texture Tile");
+    const uint64_t tileBytes = TiledTextureFile::GetTileBytes(header);
+    const uint64_t offset = TiledTextureFile::GetTileOffset(header, levels[level], tileX, tileY);
+    output.resize(tileBytes);
+#ifdef _WIN32
+    std::lock_guard<std::mutex> lock(fileMutex);
+    const bool success = !_fseeki64(file, offset, SEEK_SET) && fread(output.data(), 1, tileBytes, file) == tileBytes;
+#else
+    const bool success = pread(fileDescriptor, output.data(), tileBytes, static_cast<off_t>(offset)) == static_cast<ssize_t>(tileBytes);
+#endif
+    if (!success) {
+        std::cerr << "ERROR: Failed to read tile (" << tileX << ", " << tileY << ") of level " << level << " from " << filename << std::endl;
+    }
+    return success;
+}
+
+glm::vec4 TiledTexture::Sample(const glm::vec2& coord) const
+{
+    return SampleBilinear(0, coord);
+}
+
+glm::vec4 TiledTexture::Sample(const glm::vec3& coord) const
+{
+    return Sample(glm::vec2(coord));
+}
+
+glm::vec4 TiledTexture::SampleGrad(const glm::vec2& coord, const glm::vec2& dUVdx, const glm::vec2& dUVdy) const
+{
+    const glm::vec2 size(header.width, header.height);
+    const float footprint = std::max(glm::length2(dUVdx * size), glm::length2(dUVdy * size));
+    if (footprint <= 1.f) {
+        return SampleBilinear(0, coord);
+    }
+    return SampleLevel(coord, 0.5f * std::log2(footprint));
+}
+
+glm::vec4 TiledTexture::SampleLevel(const glm::vec2& coord, float level) const
+{
+    const float clampedLevel = glm::clamp(level, 0.f, static_cast<float>(levels.size() - 1));
+    const int lowerLevel = static_cast<int>(clampedLevel);
+    const float blend = clampedLevel - lowerLevel;
+    const glm::vec4 lowerSample = SampleBilinear(lowerLevel, coord);
+    if (blend <= 0.f) {
+        return lowerSample;
+    }
+    return glm::mix(lowerSample, SampleBilinear(lowerLevel + 1, coord), blend);
+}
+
+glm::vec4 TiledTexture::SampleBilinear(int level, const glm::vec2& coord) const
+{
+    // Texel centers at (x + 0.5) / width, like Texture2D.
+    const glm::vec2 imageSpaceCoordinates = coord * glm::vec2(levels[level].width, levels[level].height) - glm::vec2(0.5f);
+
+    glm::vec2 floorVec(std::floor(imageSpaceCoordinates.x), std::floor(imageSpaceCoordinates.y));
+    glm::vec2 ceilVec(floorVec.x + 1.f, floorVec.y + 1.f);
+
+    const glm::ivec2 q11(floorVec);
+    const glm::ivec2 q12(floorVec.x, ceilVec.y);
+    const glm::ivec2 q21(ceilVec.x, floorVec.y);
+    const glm::ivec2 q22(ceilVec);
+
+    const glm::vec4 fx1 = (ceilVec.x - imageSpaceCoordinates.x) * InternalSample(level, q11) + (imageSpaceCoordinates.x - floorVec.x) * InternalSample(level, q21);
+    const glm::vec4 fx2 = (ceilVec.x - imageSpaceCoordinates.x) * InternalSample(level, q12) + (imageSpaceCoordinates.x - floorVec.x) * InternalSample(level, q22);
+    return (ceilVec.y - imageSpaceCoordinates.y) * fx1 + (imageSpaceCoordinates.y - floorVec.y) * fx2;
+}
+
+glm::vec4 TiledTexture::InternalSample(int level, const glm::ivec2& coord) const
+{
+    // Repeat across borders, like Texture2D.
+    const int width = static_cast<int>(levels[level].width);
+    const int height = static_cast<int>(levels[level].height);
+    const int x = (coord.x % width + width) % width;
+    const int y = (coord.y % height + height) % height;
+    const int tileSize = static_cast<int>(header.tileSize);
+    const int tileX = x / tileSize;
+    const int tileY = y / tileSize;
+
+    const int tileTexelX = x - tileX * tileSize;
+    const int tileTexelY = y - tileY * tileSize;
+    if (mappedFile) {
+        const unsigned char* tileData = mappedFile->GetData() + TiledTextureFile::GetTileOffset(header, levels[level], tileX, tileY);
+        return TextureFormats::DecodeTexel(GetFormat(), tileData, tileSize, tileTexelX, tileTexelY);
+    }
+
+    // Read on a miss without holding any cache lock, so that other threads are only held up by their own misses.
+    const uint64_t key = TextureCache::MakeTileKey(textureId, level, tileX, tileY);
+    TextureCache::TileData tile = TextureCache::Get()->FindTile(key);
+    if (!tile) {
+        std::shared_ptr<std::vector<unsigned char>> tileData = std::make_shared<std::vector<unsigned char>>();
+        if (!ReadTile(level, tileX, tileY, *tileData)) {
+            return glm::vec4();
+        }
+        tile = TextureCache::Get()->InsertTile(key, tileData);
+    }
+
+    return TextureFormats::DecodeTexel(GetFormat(), tile->data(), tileSize, tileTexelX, tileTexelY);
+}
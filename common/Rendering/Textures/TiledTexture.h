@@ -0,0 +1,55 @@
+#pragma once
+
+#include "common/Rendering/Textures/Texture.h"
+#include "common/Utility/Texture/TiledTextureFile.h"
+#include "common/Utility/Texture/MappedFile.h"
+#include <mutex>
+
+// Texture whose mip chain lives in a tiled texture file. Sampling matches Texture2D.
+//
+// Tiles are either paged in through the TextureCache, which keeps memory use within its budget, or read straight
+// from a memory mapping of the file, which leaves paging to the OS and needs no decoding or copying at all.
+class TiledTexture : public Texture
+{
+public:
+    enum class AccessMode
+    {
+        CACHED,
+        MEMORY_MAPPED
+    };
+
+    virtual ~TiledTexture();
+
+    // Returns nullptr if the file cannot be opened or is not a valid tiled texture.
+    static std::shared_ptr<TiledTexture> Open(const std::string& filename, AccessMode mode = AccessMode::CACHED);
+
+    virtual glm::vec4 Sample(const glm::vec2& coord) const override;
+    virtual glm::vec4 Sample(const glm::vec3& coord) const override;
+    virtual glm::vec4 SampleGrad(const glm::vec2& coord, const glm::vec2& dUVdx, const glm::vec2& dUVdy) const override;
+    glm::vec4 SampleLevel(const glm::vec2& coord, float level) const;
+
+    int GetWidth() const { return static_cast<int>(header.width); }
+    int GetHeight() const { return static_cast<int>(header.height); }
+    int GetTotalMipLevels() const { return static_cast<int>(levels.size()); }
+    TextureFormat GetFormat() const { return TiledTextureFile::GetFormat(header); }
+private:
+    TiledTexture();
+
+    glm::vec4 SampleBilinear(int level, const glm::vec2& coord) const;
+    glm::vec4 InternalSample(int level, const glm::ivec2& coord) const;
+    bool ReadTile(int level, int tileX, int tileY, std::vector<unsigned char>& output) const;
+
+    uint32_t textureId;
+    std::string filename;
+    TiledTextureFile::Header header;
+    std::vector<TiledTextureFile::LevelInfo> levels;
+
+    std::unique_ptr<MappedFile> mappedFile;
+
+#ifdef _WIN32
+    mutable std::mutex fileMutex;
+    mutable FILE* file;
+#else
+    int fileDescriptor;
+#endif
+};
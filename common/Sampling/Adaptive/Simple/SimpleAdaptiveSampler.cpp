@@ -0,0 +1,110 @@
+#include "common/Sampling/Adaptive/Simple/SimpleAdaptiveSampler.h"
+#include "common/Utility/Math/CounterRandom.h"
+#include <sstream>
+
+namespace
+{
+const glm::vec3 LUMINANCE_WEIGHTS(0.2126f, 0.7152f, 0.0722f);
+// Added to the contrast denominator so that noise in near-black pixels does not count as contrast.
+const float CONTRAST_DARK_LUMINANCE = 0.05f;
+}
+
+SimpleAdaptiveSampler::SimpleAdaptiveSampler():
+    contrastThreshold(0.1f), varianceThreshold(0.02f), minimumSamples(4)
+{
+}
+
+void SimpleAdaptiveSampler::SetContrastThreshold(float input)
+{
+    contrastThreshold = input;
+}
+
+void SimpleAdaptiveSampler::SetVarianceThreshold(float input, int minimum)
+{
+    varianceThreshold = input;
+    minimumSamples = std::max(2, minimum);
+}
+
+std::string SimpleAdaptiveSampler::GetDescription() const
+{
+    std::ostringstream description;
+    description << "adaptive contrast " << contrastThreshold << " variance " << varianceThreshold << " minimum " << minimumSamples;
+    return description.str();
+}
+
+bool SimpleAdaptiveSampler::NeedsSupersampling(const glm::vec3 neighbourhood[9]) const
+{
+    float minLuminance = std::numeric_limits<float>::max();
+    float maxLuminance = 0.f;
+    for (int i = 0; i < 9; ++i) {
+        const float luminance = glm::dot(neighbourhood[i], LUMINANCE_WEIGHTS);
+        minLuminance = std::min(minLuminance, luminance);
+        maxLuminance = std::max(maxLuminance, luminance);
+    }
+    return maxLuminance - minLuminance > contrastThreshold * (maxLuminance + minLuminance + CONTRAST_DARK_LUMINANCE);
+}
+
+glm::vec3 SimpleAdaptiveSampler::ComputeSamplesAndColor(int maxSamplesPerPixel, int dimensions, uint32_t randomIndex, std::function<glm::vec3(glm::vec3)> colorComputer, glm::vec3 minRange, glm::vec3 maxRange) const
+{
+    const int strataPerDimension = GetStrataPerDimension(maxSamplesPerPixel, dimensions);
+    const int effectiveDimensions = std::min(dimensions, 3);
+    const size_t strataCount = static_cast<size_t>(GetMaxSampleCount(maxSamplesPerPixel, dimensions));
+    auto shuffle = [randomIndex](std::vector<int>& values, uint32_t dimension) {
+        for (size_t i = 0; i + 1 < values.size(); ++i) {
+            const float random = CounterRandom::Uniform(CounterRandom::Stream::SAMPLE_ORDER, randomIndex, static_cast<uint32_t>(i), dimension);
+            const size_t j = i + std::min(values.size() - i - 1, static_cast<size_t>(random * (values.size() - i)));
+            std::swap(values[i], values[j]);
+        }
+    };
+
+    // In 2D, one stratum in every row and every column of strata comes first (N rooks), so that the samples before
+    // the first stopping test see any edge across the pixel that covers a row or column of strata. The rest follow in
+    // random order, so that stopping early still leaves the samples spread over the pixel.
+    std::vector<int> strata;
+    std::vector<uint8_t> ordered(strataCount, 0);
+    if (effectiveDimensions == 2) {
+        std::vector<int> columns(strataPerDimension);
+        for (int i = 0; i < strataPerDimension; ++i) {
+            columns[i] = i;
+        }
+        shuffle(columns, 0);
+        for (int row = 0; row < strataPerDimension; ++row) {
+            strata.push_back(row * strataPerDimension + columns[row]);
+            ordered[strata.back()] = 1;
+        }
+    }
+    const int firstTestSample = std::max(minimumSamples, static_cast<int>(strata.size()));
+    std::vector<int> remaining;
+    for (size_t i = 0; i < strataCount; ++i) {
+        if (!ordered[i]) {
+            remaining.push_back(static_cast<int>(i));
+        }
+    }
+    shuffle(remaining, 1);
+
+    std::vector<glm::vec3> jitter;
+    GenerateJitter(randomIndex, static_cast<int>(strataCount), dimensions, jitter);
+    strata.insert(strata.end(), remaining.begin(), remaining.end());
+
+    // Running mean and variance of the luminance (Welford).
+    glm::vec3 sum;
+    double mean = 0.0;
+    double squaredDifferences = 0.0;
+    int sampleCount = 0;
+    for (int stratum : strata) {
+        const glm::vec3 color = colorComputer(GenerateStratifiedSample(stratum, strataPerDimension, dimensions, jitter[stratum], minRange, maxRange));
+        sum += color;
+        ++sampleCount;
+        const double luminance = glm::dot(color, LUMINANCE_WEIGHTS);
+        const double delta = luminance - mean;
+        mean += delta / sampleCount;
+        squaredDifferences += delta * (luminance - mean);
+        if (sampleCount >= firstTestSample) {
+            const double standardError = std::sqrt(squaredDifferences / (sampleCount - 1) / sampleCount);
+            if (standardError <= varianceThreshold * mean) {
+                break;
+            }
+        }
+    }
+    return sum / static_cast<float>(sampleCount);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "common/Sampling/Jitter/JitterColorSampler.h"
+
+// Supersamples only pixels whose neighbourhood has contrast, e.g. geometry edges and the earth's limb, and takes the
+// jittered samples of those one stratum at a time, stopping early once the mean has settled. Flat pixels, like
+// the empty sky, keep their one center sample.
+class SimpleAdaptiveSampler : public JitterColorSampler
+{
+public:
+    SimpleAdaptiveSampler();
+
+    // Pixels are supersampled when (max - min) / (max + min) of the luminance over their neighbourhood exceeds this,
+    // 0.1 by default. Dark pixels need larger differences.
+    void SetContrastThreshold(float input);
+    // Sampling stops once the standard error of the mean luminance drops below this fraction of the mean, 0.02 by
+    // default, after at least minimum samples, 4 by default, and in 2D one in every row and column of strata.
+    void SetVarianceThreshold(float input, int minimum);
+
+    virtual bool UsesNeighbourhood() const override { return true; }
+    virtual bool NeedsSupersampling(const glm::vec3 neighbourhood[9]) const override;
+    virtual glm::vec3 ComputeSamplesAndColor(int maxSamplesPerPixel, int dimensions, uint32_t randomIndex, std::function<glm::vec3(glm::vec3)> colorComputer, glm::vec3 minRange = glm::vec3(0.f), glm::vec3 maxRange = glm::vec3(1.f)) const override;
+    virtual std::string GetDescription() const override;
+
+private:
+    float contrastThreshold;
+    float varianceThreshold;
+    int minimumSamples;
+};
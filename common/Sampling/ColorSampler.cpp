@@ -0,0 +1,17 @@
+#include "common/Sampling/ColorSampler.h"
+#include "common/Sampling/Jitter/JitterColorSampler.h"
+#include "common/Sampling/Adaptive/Simple/SimpleAdaptiveSampler.h"
+
+ColorSampler::~ColorSampler()
+{
+}
+
+std::shared_ptr<ColorSampler> ColorSampler::Create(const std::string& name)
+{
+    if (name == "jitter") {
+        return std::make_shared<JitterColorSampler>();
+    } else if (name == "adaptive") {
+        return std::make_shared<SimpleAdaptiveSampler>();
+    }
+    return nullptr;
+}
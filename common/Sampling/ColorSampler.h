@@ -0,0 +1,33 @@
+#pragma once
+
+#include "common/common.h"
+
+// Chooses where in a pixel to sample and how to combine the samples into its color. The render takes one sample at
+// the center of every pixel first; NeedsSupersampling then decides from those whether a pixel gets more.
+class ColorSampler
+{
+public:
+    virtual ~ColorSampler();
+
+    // Whether NeedsSupersampling looks at the center samples. If not, which is the default, every pixel is
+    // supersampled and the render does not trace the center samples around each tile that it would need.
+    virtual bool UsesNeighbourhood() const { return false; }
+
+    // neighbourhood holds the center samples of the pixel and its 8 neighbours, row by row with the pixel in the
+    // middle. Only called when UsesNeighbourhood is true. Every pixel is supersampled by default.
+    virtual bool NeedsSupersampling(const glm::vec3 neighbourhood[9]) const { return true; }
+
+    // Most samples ComputeSamplesAndColor takes for the given maxSamplesPerPixel and dimensions, which may be fewer.
+    virtual int GetMaxSampleCount(int maxSamplesPerPixel, int dimensions) const { return maxSamplesPerPixel; }
+
+    // Calls colorComputer with up to maxSamplesPerPixel sample positions, of which the first dimensions components
+    // lie in [minRange, maxRange] and the rest are minRange, and returns the average of the colors. The positions only
+    // depend on randomIndex, e.g. the pixel index, so the result does not depend on which thread calls this.
+    virtual glm::vec3 ComputeSamplesAndColor(int maxSamplesPerPixel, int dimensions, uint32_t randomIndex, std::function<glm::vec3(glm::vec3)> colorComputer, glm::vec3 minRange = glm::vec3(0.f), glm::vec3 maxRange = glm::vec3(1.f)) const = 0;
+
+    // The name Create takes, followed by any settings that change the samples, e.g. to tell renders apart.
+    virtual std::string GetDescription() const = 0;
+
+    // Creates the sampler called "jitter" or "adaptive", or returns null for any other name.
+    static std::shared_ptr<ColorSampler> Create(const std::string& name);
+};
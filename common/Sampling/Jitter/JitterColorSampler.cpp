@@ -0,0 +1,67 @@
+#include "common/Sampling/Jitter/JitterColorSampler.h"
+#include "common/Utility/Math/CounterRandom.h"
+
+glm::vec3 JitterColorSampler::ComputeSamplesAndColor(int maxSamplesPerPixel, int dimensions, uint32_t randomIndex, std::function<glm::vec3(glm::vec3)> colorComputer, glm::vec3 minRange, glm::vec3 maxRange) const
+{
+    const int strataPerDimension = GetStrataPerDimension(maxSamplesPerPixel, dimensions);
+    const int sampleCount = GetMaxSampleCount(maxSamplesPerPixel, dimensions);
+
+    std::vector<glm::vec3> jitter;
+    GenerateJitter(randomIndex, sampleCount, dimensions, jitter);
+    glm::vec3 sum;
+    for (int stratum = 0; stratum < sampleCount; ++stratum) {
+        sum += colorComputer(GenerateStratifiedSample(stratum, strataPerDimension, dimensions, jitter[stratum], minRange, maxRange));
+    }
+    return sum / static_cast<float>(sampleCount);
+}
+
+int JitterColorSampler::GetMaxSampleCount(int maxSamplesPerPixel, int dimensions) const
+{
+    const int strataPerDimension = GetStrataPerDimension(maxSamplesPerPixel, dimensions);
+    int sampleCount = 1;
+    for (int d = 0; d < std::min(dimensions, 3); ++d) {
+        sampleCount *= strataPerDimension;
+    }
+    return sampleCount;
+}
+
+int JitterColorSampler::GetStrataPerDimension(int maxSamplesPerPixel, int dimensions)
+{
+    dimensions = std::min(dimensions, 3);
+    auto sampleCount = [dimensions](int strata) {
+        int count = 1;
+        for (int d = 0; d < dimensions; ++d) {
+            count *= strata;
+        }
+        return count;
+    };
+    int strata = 1;
+    while (dimensions > 0 && sampleCount(strata + 1) <= maxSamplesPerPixel) {
+        ++strata;
+    }
+    return strata;
+}
+
+void JitterColorSampler::GenerateJitter(uint32_t randomIndex, int sampleCount, int dimensions, std::vector<glm::vec3>& output)
+{
+    output.assign(sampleCount, glm::vec3(0.f));
+    std::vector<float> values(sampleCount);
+    for (int d = 0; d < std::min(dimensions, 3); ++d) {
+        CounterRandom::UniformBatch(CounterRandom::Stream::PIXEL_SAMPLES, randomIndex, 0, d, sampleCount, values.data());
+        for (int i = 0; i < sampleCount; ++i) {
+            output[i][d] = values[i];
+        }
+    }
+}
+
+glm::vec3 JitterColorSampler::GenerateStratifiedSample(int stratum, int strataPerDimension, int dimensions, const glm::vec3& jitter, const glm::vec3& minRange, const glm::vec3& maxRange)
+{
+    glm::vec3 sample = minRange;
+    for (int d = 0; d < std::min(dimensions, 3); ++d) {
+        const int cell = stratum % strataPerDimension;
+        stratum /= strataPerDimension;
+        const float position = (static_cast<float>(cell) + jitter[d]) / strataPerDimension;
+        sample[d] = minRange[d] + (maxRange[d] - minRange[d]) * position;
+    }
+    return sample;
+}
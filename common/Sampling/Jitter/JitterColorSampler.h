@@ -0,0 +1,22 @@
+#pragma once
+
+#include "common/Sampling/ColorSampler.h"
+
+// Stratified sampling: the range is split into the same number of strata along each dimension, as many as
+// maxSamplesPerPixel allows, and each stratum gets one sample at a random position inside it.
+class JitterColorSampler : public ColorSampler
+{
+public:
+    // The largest power of dimensions, up to 3, that does not exceed maxSamplesPerPixel, e.g. 4 for 8 in 2D.
+    virtual int GetMaxSampleCount(int maxSamplesPerPixel, int dimensions) const override;
+    virtual glm::vec3 ComputeSamplesAndColor(int maxSamplesPerPixel, int dimensions, uint32_t randomIndex, std::function<glm::vec3(glm::vec3)> colorComputer, glm::vec3 minRange = glm::vec3(0.f), glm::vec3 maxRange = glm::vec3(1.f)) const override;
+    virtual std::string GetDescription() const override { return "jitter"; }
+
+protected:
+    // Strata along each of the first dimensions components, at least 1. Dimensions beyond 3 are ignored.
+    static int GetStrataPerDimension(int maxSamplesPerPixel, int dimensions);
+    // Random offsets in [0, 1) within each of sampleCount strata, generated for all of them at once.
+    static void GenerateJitter(uint32_t randomIndex, int sampleCount, int dimensions, std::vector<glm::vec3>& output);
+    // Position of the jitter in the stratum with index stratum out of strataPerDimension^dimensions, row by row.
+    static glm::vec3 GenerateStratifiedSample(int stratum, int strataPerDimension, int dimensions, const glm::vec3& jitter, const glm::vec3& minRange, const glm::vec3& maxRange);
+};
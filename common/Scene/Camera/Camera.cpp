@@ -1,5 +1,21 @@
 #include "common/Scene/Camera/Camera.h"
+#include "common/Scene/Geometry/Ray/Ray.h"
 
 Camera::Camera()
 {
-}
\ No newline at end of file
+}
+
+std::shared_ptr<Ray> Camera::GenerateRayForNormalizedCoordinates(glm::vec2 coordinate, glm::vec2 pixelSize) const
+{
+    std::shared_ptr<Ray> ray = GenerateRayForNormalizedCoordinates(coordinate);
+    const std::shared_ptr<Ray> rayX = GenerateRayForNormalizedCoordinates(coordinate + glm::vec2(pixelSize.x, 0.f));
+    const std::shared_ptr<Ray> rayY = GenerateRayForNormalizedCoordinates(coordinate + glm::vec2(0.f, pixelSize.y));
+
+    RayDifferential differentials;
+    differentials.dPdx = rayX->GetRayPosition(0.f) - ray->GetRayPosition(0.f);
+    differentials.dPdy = rayY->GetRayPosition(0.f) - ray->GetRayPosition(0.f);
+    differentials.dDdx = rayX->GetRayDirection() - ray->GetRayDirection();
+    differentials.dDdy = rayY->GetRayDirection() - ray->GetRayDirection();
+    ray->SetDifferentials(differentials);
+    return ray;
+}
@@ -8,4 +8,8 @@ public:
     Camera();
 
     virtual std::shared_ptr<class Ray> GenerateRayForNormalizedCoordinates(glm::vec2 coordinate) const = 0;
+
+    // Also fills in the ray differentials for a step of pixelSize in normalized coordinates. By default the
+    // differentials are found by generating the neighbouring rays.
+    virtual std::shared_ptr<class Ray> GenerateRayForNormalizedCoordinates(glm::vec2 coordinate, glm::vec2 pixelSize) const;
 };
\ No newline at end of file
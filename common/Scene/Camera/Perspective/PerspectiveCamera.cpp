@@ -6,12 +6,8 @@ PerspectiveCamera::PerspectiveCamera(float aspectRatio, float inputFov):
 {
 }
 
-std::shared_ptr<Ray> PerspectiveCamera::GenerateRayForNormalizedCoordinates(glm::vec2 coordinate) const
+glm::vec3 PerspectiveCamera::ComputeImagePlaneTarget(glm::vec2 coordinate) const
 {
-    // Send ray from the camera to the image plane -- make the assumption that the image plane is at z = 1 in camera space.
-    const glm::vec3 rayOrigin = glm::vec3(GetPosition());
-
-    // Figure out where the ray is supposed to point to. 
     // Imagine that a frustum exists in front of the camera (which we assume exists at a singular point).
     // Then, given the aspect ratio and vertical field of view we can determine where in the world the 
     // image plane will exist and how large it is assuming we know for sure that z = 1 (this is fairly arbitrary for now).
@@ -22,12 +18,39 @@ std::shared_ptr<Ray> PerspectiveCamera::GenerateRayForNormalizedCoordinates(glm:
     // pixel is directly in front of the camera...
     const float xOffset = planeWidth * (coordinate.x - 0.5f);
     const float yOffset = -1.f * planeHeight  * (coordinate.y - 0.5f);
-    const glm::vec3 targetPosition = rayOrigin + glm::vec3(GetForwardDirection()) + glm::vec3(GetRightDirection()) * xOffset + glm::vec3(GetUpDirection()) * yOffset;
+    return glm::vec3(GetForwardDirection()) + glm::vec3(GetRightDirection()) * xOffset + glm::vec3(GetUpDirection()) * yOffset;
+}
 
-    const glm::vec3 rayDirection = glm::normalize(targetPosition - rayOrigin);
+std::shared_ptr<Ray> PerspectiveCamera::GenerateRayForNormalizedCoordinates(glm::vec2 coordinate) const
+{
+    // Send ray from the camera to the image plane -- make the assumption that the image plane is at z = 1 in camera space.
+    const glm::vec3 rayOrigin = glm::vec3(GetPosition());
+
+    // Figure out where the ray is supposed to point to. 
+    const glm::vec3 rayDirection = glm::normalize(ComputeImagePlaneTarget(coordinate));
     return std::make_shared<Ray>(rayOrigin + rayDirection * zNear, rayDirection, zFar - zNear);
 }
 
+std::shared_ptr<Ray> PerspectiveCamera::GenerateRayForNormalizedCoordinates(glm::vec2 coordinate, glm::vec2 pixelSize) const
+{
+    std::shared_ptr<Ray> ray = GenerateRayForNormalizedCoordinates(coordinate);
+
+    // The image plane target is linear in the coordinate, so only the normalization has to be differentiated.
+    const glm::vec3 target = ComputeImagePlaneTarget(coordinate);
+    const glm::vec3 direction = ray->GetRayDirection();
+    const glm::vec3 targetDx = ComputeImagePlaneTarget(coordinate + glm::vec2(pixelSize.x, 0.f)) - target;
+    const glm::vec3 targetDy = ComputeImagePlaneTarget(coordinate + glm::vec2(0.f, pixelSize.y)) - target;
+    const float invLength = 1.f / glm::length(target);
+
+    RayDifferential differentials;
+    differentials.dDdx = (targetDx - direction * glm::dot(direction, targetDx)) * invLength;
+    differentials.dDdy = (targetDy - direction * glm::dot(direction, targetDy)) * invLength;
+    differentials.dPdx = differentials.dDdx * zNear;
+    differentials.dPdy = differentials.dDdy * zNear;
+    ray->SetDifferentials(differentials);
+    return ray;
+}
+
 void PerspectiveCamera::SetZNear(float input)
 {
     zNear = input;
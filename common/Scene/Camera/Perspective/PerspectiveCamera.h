@@ -8,11 +8,14 @@ public:
     // inputFov is in degrees. 
     PerspectiveCamera(float aspectRatio, float inputFov);
     virtual std::shared_ptr<class Ray> GenerateRayForNormalizedCoordinates(glm::vec2 coordinate) const override;
+    virtual std::shared_ptr<class Ray> GenerateRayForNormalizedCoordinates(glm::vec2 coordinate, glm::vec2 pixelSize) const override;
 
     void SetZNear(float input);
     void SetZFar(float input);
 
 private:
+    glm::vec3 ComputeImagePlaneTarget(glm::vec2 coordinate) const;
+
     float aspectRatio;
     float fov; // fov is stored as radians
 
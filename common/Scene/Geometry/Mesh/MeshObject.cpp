@@ -4,14 +4,15 @@
 #include "common/Scene/Geometry/Ray/Ray.h"
 #include "common/Scene/SceneObject.h"
 #include "common/Intersection/IntersectionState.h"
+#include "common/Rendering/Material/Material.h"
 
 MeshObject::MeshObject() :
-    storedMaterial(nullptr)
+    isFinalized(false), storedMaterial(nullptr)
 {
 }
 
 MeshObject::MeshObject(std::shared_ptr<Material> inputMaterial) :
-    storedMaterial(std::move(inputMaterial))
+    isFinalized(false), storedMaterial(std::move(inputMaterial))
 {
 }
 
@@ -22,10 +23,15 @@ MeshObject::~MeshObject()
 void MeshObject::AddPrimitive(std::shared_ptr<PrimitiveBase> newPrimitive)
 {
     elements.emplace_back(std::move(newPrimitive));
+    isFinalized = false;
 }
 
 void MeshObject::Finalize()
 {
+    if (isFinalized) {
+        return;
+    }
+    PROFILE_ZONE(zone, "Finalize Mesh " + meshName);
     boundingBox.Reset();
     for (size_t i = 0; i < elements.size(); ++i) {
         elements[i]->Finalize();
@@ -33,12 +39,14 @@ void MeshObject::Finalize()
     }
     assert(acceleration);
     acceleration->Initialize(elements);
+    isFinalized = true;
 }
 
 void MeshObject::CreateAccelerationData(AccelerationTypes perObjectType)
 {
     acceleration = AccelerationGenerator::CreateStructureFromType(perObjectType);
     assert(acceleration);
+    isFinalized = false;
 }
 
 bool MeshObject::Trace(const SceneObject* parentObject, class Ray* inputRay, struct IntersectionState* outputIntersection) const
@@ -56,6 +64,13 @@ void MeshObject::SetMaterial(std::shared_ptr<Material> inputMaterial)
     storedMaterial = std::move(inputMaterial);
 }
 
+void MeshObject::ResolveTextures()
+{
+    if (storedMaterial) {
+        storedMaterial->ResolveTextures();
+    }
+}
+
 void MeshObject::SetName(const std::string& input)
 {
     meshName = input;
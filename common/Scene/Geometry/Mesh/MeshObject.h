@@ -9,6 +9,8 @@ public:
     MeshObject();
     MeshObject(std::shared_ptr<class Material> inputMaterial);
     virtual ~MeshObject();
+    // Builds the primitives and the acceleration structure. Meshes shared by several scene objects are only
+    // built once; adding primitives or recreating the acceleration data marks the mesh for rebuilding.
     virtual void Finalize();
 
     void SetName(const std::string& input);
@@ -23,6 +25,8 @@ public:
 
     virtual void SetMaterial(std::shared_ptr<class Material> inputMaterial);
     virtual const class Material* GetMaterial() const;
+    // Waits for textures the material is still loading.
+    void ResolveTextures();
 
     virtual bool Trace(const class SceneObject* parentObject, class Ray* inputRay, struct IntersectionState* outputIntersection) const override;
 
@@ -32,6 +36,7 @@ protected:
     Box boundingBox;
 
     class std::shared_ptr<class AccelerationStructure> acceleration;
+    bool isFinalized;
 
 private:
     std::shared_ptr<class Material> storedMaterial;
@@ -55,6 +55,11 @@ public:
         return N;
     }
 
+    virtual glm::vec3 GetVertexPosition(int index) const override
+    {
+        return positions[index];
+    }
+
     virtual void Finalize() override
     {
         UpdateBoundingBox();
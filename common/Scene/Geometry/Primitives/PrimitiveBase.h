@@ -12,6 +12,7 @@ public:
     virtual void SetVertexUV(int index, glm::vec2 uv) = 0;
     virtual void SetVertexTangentBitangent(int index, glm::vec3 tangent, glm::vec3 bitangent) = 0;
     virtual int GetTotalVertices() const = 0;
+    virtual glm::vec3 GetVertexPosition(int index) const = 0;
     virtual void Finalize() = 0;
 
     virtual bool HasVertexNormals() const = 0;
@@ -22,4 +23,10 @@ public:
     virtual glm::vec2 GetVertexUV(int index) const = 0;
     virtual glm::vec3 GetVertexTangent(int index) const = 0;
     virtual glm::vec3 GetVertexBitangent(int index) const = 0;
+
+    // Primitives with an analytic surface, like Sphere, compute the normal and uv at an object-space point on the
+    // surface instead of interpolating vertex attributes. u wraps around with period 1.
+    virtual bool HasSurfaceParametrization() const { return false; }
+    virtual glm::vec3 GetSurfaceNormal(const glm::vec3& objectPosition) const { return GetPrimitiveNormal(); }
+    virtual glm::vec2 GetSurfaceUV(const glm::vec3& objectPosition) const { return glm::vec2(); }
 };
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include "common/Scene/Geometry/Primitives/Sphere/Sphere.h"
+#include "common/Scene/Geometry/Ray/Ray.h"
+#include "common/Intersection/IntersectionState.h"
+#include "common/Utility/Math/FastMath.h"
+
+Sphere::Sphere(class MeshObject* inputParent, float inputRadius):
+    Primitive<1>(inputParent), radius(inputRadius)
+{
+    positions[0] = glm::vec3(0.f);
+}
+
+void Sphere::Finalize()
+{
+    boundingBox.minVertex = positions[0] - glm::vec3(radius);
+    boundingBox.maxVertex = positions[0] + glm::vec3(radius);
+}
+
+glm::vec3 Sphere::GetPrimitiveNormal() const
+{
+    return glm::vec3(0.f, 1.f, 0.f);
+}
+
+glm::vec3 Sphere::GetSurfaceNormal(const glm::vec3& objectPosition) const
+{
+    return glm::normalize(objectPosition - positions[0]);
+}
+
+glm::vec2 Sphere::GetSurfaceUV(const glm::vec3& objectPosition) const
+{
+    // The HIGH approximations move the UVs by a few thousandths of a texel at most, even on the 21600 texel cloud maps.
+    const glm::vec3 normal = GetSurfaceNormal(objectPosition);
+    const float longitude = FastMath::Atan2<FastMath::Accuracy::HIGH>(normal.x, normal.z);
+    const float latitude = FastMath::Asin<FastMath::Accuracy::HIGH>(glm::clamp(normal.y, -1.f, 1.f));
+    return glm::vec2(longitude / (2.f * PI) + 0.5f, latitude / PI + 0.5f);
+}
+
+bool Sphere::Trace(const SceneObject* parentObject, Ray* inputRay, IntersectionState* outputIntersection) const
+{
+    DIAGNOSTICS_STAT(DiagnosticsType::SPHERE_INTERSECTIONS);
+    assert(parentObject);
+    // Convert ray into object space.
+    const glm::vec3 rayPos = glm::vec3(parentObject->GetWorldToObjectMatrix() * inputRay->GetPosition());
+    const glm::vec3 rayDir = glm::vec3(parentObject->GetWorldToObjectMatrix() * inputRay->GetForwardDirection());
+
+    // Solve |rayPos + t * rayDir - center| = radius without the cancellation of the textbook quadratic, which loses
+    // all precision when the radius is large compared to the distance to the surface (Haines et al., "Precision
+    // Improvements for Ray/Sphere Intersection", Ray Tracing Gems). The discriminant comes from the distance of the
+    // closest approach and the constant term from the distance of the origin, both as differences of squares.
+    const glm::vec3 offset = rayPos - positions[0];
+    const float a = glm::dot(rayDir, rayDir);
+    const float b = -glm::dot(offset, rayDir);
+    const float closestDistance = glm::length(offset + (b / a) * rayDir);
+    const float discriminant = (radius - closestDistance) * (radius + closestDistance);
+    if (discriminant < 0.f) {
+        return false;
+    }
+
+    const float originDistance = glm::length(offset);
+    const float c = (originDistance - radius) * (originDistance + radius);
+    const float q = b + std::copysign(sqrtf(a * discriminant), b);
+    float nearT = (q != 0.f) ? c / q : 0.f;
+    float farT = q / a;
+    if (nearT > farT) {
+        std::swap(nearT, farT);
+    }
+
+    // Rays starting inside the sphere hit its far side.
+    const float t = (nearT >= -SMALL_EPSILON) ? nearT : farT;
+    if (t - inputRay->GetMaxT() > SMALL_EPSILON || t < -SMALL_EPSILON) {
+        return false;
+    }
+
+    if (outputIntersection) {
+        if (t - outputIntersection->intersectionT > SMALL_EPSILON) {
+            return false;
+        }
+        outputIntersection->intersectionRay = *inputRay;
+        outputIntersection->primitiveParent = parentObject;
+        outputIntersection->intersectionT = t;
+        outputIntersection->intersectedPrimitive = this;
+        outputIntersection->hasIntersection = true;
+
+        outputIntersection->primitiveIntersectionWeights.clear();
+        outputIntersection->primitiveIntersectionWeights.emplace_back(1.f);
+    }
+
+    return true;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "common/Scene/Geometry/Primitives/Primitive.h"
+
+// Analytic sphere around vertex 0, which defaults to the origin of the mesh's object space. The poles are on the
+// object's y axis: v runs from 0 at -y to 1 at +y, and u goes around from 0 at -z through -x, +z and +x.
+class Sphere: public Primitive<1>
+{
+public:
+    Sphere(class MeshObject* inputParent, float inputRadius);
+    virtual bool Trace(const class SceneObject* parentObject, class Ray* inputRay, struct IntersectionState* outputIntersection) const override;
+    virtual void Finalize() override;
+
+    float GetRadius() const { return radius; }
+
+    // A sphere has no single face normal; this is the normal at its +y pole.
+    virtual glm::vec3 GetPrimitiveNormal() const override;
+
+    virtual bool HasSurfaceParametrization() const override { return true; }
+    virtual glm::vec3 GetSurfaceNormal(const glm::vec3& objectPosition) const override;
+    virtual glm::vec2 GetSurfaceUV(const glm::vec3& objectPosition) const override;
+private:
+    float radius;
+};
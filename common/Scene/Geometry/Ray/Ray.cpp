@@ -1,13 +1,13 @@
 #include "common/Scene/Geometry/Ray/Ray.h"
 
 Ray::Ray() :
-    rayDirection(glm::vec3(0.f, 0.f, -1.f)), maxT(std::numeric_limits<float>::max())
+    rayDirection(glm::vec3(0.f, 0.f, -1.f)), maxT(std::numeric_limits<float>::max()), hasDifferentials(false)
 {
     position = glm::vec4(0.f, 0.f, 0.f, 1.f);
 }
 
 Ray::Ray(glm::vec3 inputPosition, glm::vec3 inputDirection, float inputMaxT):
-    rayDirection(glm::normalize(inputDirection)), maxT(inputMaxT)
+    rayDirection(glm::normalize(inputDirection)), maxT(inputMaxT), hasDifferentials(false)
 {
     position = glm::vec4(inputPosition, 1.f);
 }
@@ -60,4 +60,25 @@ glm::vec3 Ray::RefractRay(const glm::vec3& normal, float n1, float& n2) const
     const float cosTheta2 = std::sqrt(1.f - tirCheck);
     const glm::vec3 refractionDir = eta * GetRayDirection() + (eta * cosTheta1 - cosTheta2) * normal;
     return refractionDir;
-}
\ No newline at end of file
+}
+void Ray::SetDifferentials(const RayDifferential& input)
+{
+    differentials = input;
+    hasDifferentials = true;
+}
+
+RayDifferential Ray::TransferDifferentials(float t, const glm::vec3& normal) const
+{
+    assert(hasDifferentials);
+    RayDifferential result = differentials;
+    const float DdN = glm::dot(rayDirection, normal);
+    if (std::abs(DdN) < SMALL_EPSILON) {
+        return result;
+    }
+
+    const glm::vec3 offsetX = differentials.dPdx + t * differentials.dDdx;
+    const glm::vec3 offsetY = differentials.dPdy + t * differentials.dDdy;
+    result.dPdx = offsetX - (glm::dot(offsetX, normal) / DdN) * rayDirection;
+    result.dPdy = offsetY - (glm::dot(offsetY, normal) / DdN) * rayDirection;
+    return result;
+}
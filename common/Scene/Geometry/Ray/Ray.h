@@ -2,6 +2,16 @@
 
 #include "common/Scene/SceneObject.h"
 
+// How the ray origin and direction change when stepping one pixel in x and y on the image plane (Igehy, "Tracing Ray
+// Differentials"). Used to estimate the texture footprint of a hit.
+struct RayDifferential
+{
+    glm::vec3 dPdx;
+    glm::vec3 dPdy;
+    glm::vec3 dDdx;
+    glm::vec3 dDdy;
+};
+
 class Ray : public SceneObject
 {
 public:
@@ -23,9 +33,19 @@ public:
     bool IsObjectMasked(uint64_t objectId);
 
     glm::vec3 RefractRay(const glm::vec3& normal, float n1, float& n2) const;
+
+    void SetDifferentials(const RayDifferential& input);
+    bool HasDifferentials() const { return hasDifferentials; }
+    const RayDifferential& GetDifferentials() const { return differentials; }
+
+    // Moves the differentials to the hit point at t on a surface with the given normal. The direction differentials are unchanged.
+    RayDifferential TransferDifferentials(float t, const glm::vec3& normal) const;
 private:
     glm::vec3 rayDirection;
     float maxT;
 
+    RayDifferential differentials;
+    bool hasDifferentials;
+
     std::unordered_map<uint64_t, bool> traceMask;
 };
\ No newline at end of file
@@ -11,6 +11,10 @@ float DirectionalLight::ComputeLightAttenuation(glm::vec3 origin) const
     return 1.f;
 }
 
-void DirectionalLight::GenerateRandomPhotonRay(Ray& ray) const
+void DirectionalLight::GenerateRandomPhotonRay(Ray& ray, uint32_t photonIndex) const
 {
+    // Parallel light has no origin of its own; PhotonMappingRenderer spreads the origins over a disc covering the
+    // scene. On its own, the photon leaves from the light's position along the light.
+    ray.SetRayPosition(glm::vec3(GetPosition()));
+    ray.SetRayDirection(glm::vec3(GetForwardDirection()));
 }
\ No newline at end of file
@@ -13,7 +13,8 @@ public:
     void SetLightColor(glm::vec3 input);
 
     // Photon Mapping Utility Functions
-    virtual void GenerateRandomPhotonRay(Ray& ray) const = 0;
+    // The ray only depends on photonIndex, see CounterRandom.
+    virtual void GenerateRandomPhotonRay(Ray& ray, uint32_t photonIndex) const = 0;
 
 protected:
     glm::vec3 lightColor;
@@ -1,4 +1,5 @@
 #include "common/Scene/Lights/Point/PointLight.h"
+#include "common/Utility/Math/CounterRandom.h"
 
 
 void PointLight::ComputeSampleRays(std::vector<Ray>& output, glm::vec3 origin, glm::vec3 normal) const
@@ -15,15 +16,14 @@ float PointLight::ComputeLightAttenuation(glm::vec3 origin) const
     return 1.f;
 }
 
-void PointLight::GenerateRandomPhotonRay(Ray& ray) const
+void PointLight::GenerateRandomPhotonRay(Ray& ray, uint32_t photonIndex) const
 {
-    float x, y, z;
-    do {
-        x = (double) rand() / RAND_MAX * 2 - 1;
-        y = (double) rand() / RAND_MAX * 2 - 1;
-        z = (double) rand() / RAND_MAX * 2 - 1;
-    } while (x * x + y * y + z * z > 1);
+    // Uniform on the sphere by mapping two random numbers directly instead of rejection sampling, so every photon
+    // takes the same fixed number of them.
+    const float z = 1.f - 2.f * CounterRandom::Uniform(CounterRandom::Stream::PHOTON_EMISSION, photonIndex, 0, 0);
+    const float phi = 2.f * PI * CounterRandom::Uniform(CounterRandom::Stream::PHOTON_EMISSION, photonIndex, 0, 1);
+    const float radius = std::sqrt(std::max(0.f, 1.f - z * z));
 
     ray.SetRayPosition(glm::vec3(this->position));
-    ray.SetRayDirection(glm::normalize(glm::vec3(x, y, z)));
+    ray.SetRayDirection(glm::vec3(radius * std::cos(phi), radius * std::sin(phi), z));
 }
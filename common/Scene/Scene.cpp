@@ -71,6 +71,14 @@ void Scene::PerformRaySpecularReflection(Ray& outputRay, const Ray& inputRay, co
     const glm::vec3 reflectionDir = glm::reflect(inputRay.GetRayDirection(), normal);
     outputRay.SetRayPosition(intersectionPoint + LARGE_EPSILON * reflectionDir);
     outputRay.SetRayDirection(reflectionDir);
+
+    // Reflect the differentials about the normal, treating the surface as locally flat.
+    if (inputRay.HasDifferentials()) {
+        RayDifferential differentials = inputRay.TransferDifferentials(state.intersectionT, normal);
+        differentials.dDdx -= 2.f * glm::dot(differentials.dDdx, normal) * normal;
+        differentials.dDdy -= 2.f * glm::dot(differentials.dDdy, normal) * normal;
+        outputRay.SetDifferentials(differentials);
+    }
 }
 
 void Scene::PerformRayRefraction(Ray& outputRay, const Ray& inputRay, const glm::vec3& intersectionPoint, const float NdR, const IntersectionState& state, float& targetIOR) const
@@ -98,9 +106,15 @@ void Scene::AddLight(std::shared_ptr<Light> light)
 
 void Scene::Finalize()
 {
+    PROFILE_ZONE(zone, "Finalize Scene");
     for (size_t i = 0; i < sceneObjects.size(); ++i) {
         sceneObjects[i]->Finalize();
     }
     assert(acceleration);
     acceleration->Initialize(sceneObjects);
+
+    // Textures requested while the meshes were loading have been decoding alongside the builds above.
+    for (size_t i = 0; i < sceneObjects.size(); ++i) {
+        sceneObjects[i]->ResolveTextures();
+    }
 }
@@ -140,6 +140,7 @@ void SceneObject::ConfigureChildMeshAccelerationStructure(std::function<void(cla
 {
     for (size_t i = 0; i < childObjects.size(); ++i) {
         configure(childObjects[i]->acceleration.get());
+        childObjects[i]->isFinalized = false;
     }
 }
 
@@ -156,6 +157,13 @@ void SceneObject::Finalize()
     acceleration->Initialize(childObjects);
 }
 
+void SceneObject::ResolveTextures()
+{
+    for (size_t i = 0; i < childObjects.size(); ++i) {
+        childObjects[i]->ResolveTextures();
+    }
+}
+
 bool SceneObject::Trace(const SceneObject* parentObject, Ray* inputRay, IntersectionState* outputIntersection) const
 {
     if (inputRay->IsObjectMasked(GetUniqueId())) {
@@ -40,6 +40,7 @@ public:
     virtual int GetTotalMeshObjects() const { return static_cast<int>(childObjects.size()); }
     virtual const class MeshObject* GetMeshObject(int index) const;
     virtual void Finalize();
+    void ResolveTextures();
 
     virtual void CreateDefaultAccelerationData();
     virtual void CreateAccelerationData(AccelerationTypes perObjectType);
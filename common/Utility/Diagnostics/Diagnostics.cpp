@@ -1,21 +1,134 @@
 #include "common/common.h"
 #include "common/Utility/Diagnostics/Diagnostics.h"
+#include <chrono>
+#include <iomanip>
 
 #if DIAGNOSTICS_ON
 
+namespace
+{
+thread_local DiagnosticsCounters threadStatistics;
+thread_local std::array<DiagnosticsPhaseStats, static_cast<size_t>(DiagnosticsPhase::MAX)> threadPhases;
+thread_local std::unique_ptr<HardwareCounterGroup> threadCounters;
+// Calls of each phase the thread made so far, to pick the ones that are timed.
+thread_local std::array<uint64_t, static_cast<size_t>(DiagnosticsPhase::MAX)> threadPhaseCalls;
+
+// Reading the counters is a system call, which costs as much as tracing a ray. The first this many calls of a phase on
+// each thread are timed, so phases that run a few times, like the BVH build, are measured fully; after that, one in
+// this many calls is.
+const uint64_t PHASE_SAMPLE_INTERVAL = 64;
+
+const char* GetPhaseName(DiagnosticsPhase phase)
+{
+    switch (phase) {
+        case DiagnosticsPhase::BVH_BUILD:
+            return "BVH Build";
+        case DiagnosticsPhase::PRIMARY_TRACING:
+            return "Primary Tracing";
+        case DiagnosticsPhase::SHADOW_TRACING:
+            return "Shadow Tracing";
+        case DiagnosticsPhase::EARTH_SHADING:
+            return "Earth Shading";
+        case DiagnosticsPhase::PHOTON_GATHERING:
+            return "Photon Gathering";
+        default:
+            return "Unknown";
+    }
+}
+
+int64_t GetPhaseTimestamp()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+}
+
+std::atomic<bool> Diagnostics::phasesEnabled(false);
+
 Diagnostics* Diagnostics::Get()
 {
     static std::unique_ptr<Diagnostics> singleton = make_unique<Diagnostics>();
     return singleton.get();
 }
 
-Diagnostics::Diagnostics()
+Diagnostics::Diagnostics():
+    hardwareCountersRequested(false), hardwareCountersFailed(false)
 {
+    statisticsAggregator.fill(0);
 }
 
 void Diagnostics::IncrementStat(DiagnosticsType type)
 {
-    ++statisticsAggregator[type];
+    ++threadStatistics[static_cast<size_t>(type)];
+}
+
+void Diagnostics::FlushThreadStats()
+{
+    std::lock_guard<std::mutex> lock(aggregatorMutex);
+    for (size_t i = 0; i < threadStatistics.size(); ++i) {
+        statisticsAggregator[i] += threadStatistics[i];
+    }
+    threadStatistics.fill(0);
+
+    for (size_t p = 0; p < threadPhases.size(); ++p) {
+        phaseAggregator[p].calls += threadPhases[p].calls;
+        phaseAggregator[p].rays += threadPhases[p].rays;
+        phaseAggregator[p].sampledCalls += threadPhases[p].sampledCalls;
+        phaseAggregator[p].nanoseconds += threadPhases[p].nanoseconds;
+        for (size_t c = 0; c < threadPhases[p].counters.size(); ++c) {
+            phaseAggregator[p].counters[c] += threadPhases[p].counters[c];
+        }
+        threadPhases[p] = DiagnosticsPhaseStats();
+    }
+}
+
+uint64_t Diagnostics::GetTotalStat(DiagnosticsType type)
+{
+    FlushThreadStats();
+    std::lock_guard<std::mutex> lock(aggregatorMutex);
+    return statisticsAggregator[static_cast<size_t>(type)];
+}
+
+void Diagnostics::EnablePhases(bool useHardwareCounters)
+{
+    hardwareCountersRequested = useHardwareCounters;
+    phasesEnabled = true;
+}
+
+void Diagnostics::AddPhaseSample(DiagnosticsPhase phase, const DiagnosticsPhaseStats& sample)
+{
+    DiagnosticsPhaseStats& stats = threadPhases[static_cast<size_t>(phase)];
+    stats.calls += sample.calls;
+    stats.rays += sample.rays;
+    stats.sampledCalls += sample.sampledCalls;
+    stats.nanoseconds += sample.nanoseconds;
+    for (size_t c = 0; c < stats.counters.size(); ++c) {
+        stats.counters[c] += sample.counters[c];
+    }
+}
+
+bool Diagnostics::ReadThreadHardwareCounters(HardwareCounterValues& output)
+{
+    if (!hardwareCountersRequested || hardwareCountersFailed) {
+        return false;
+    }
+
+    if (!threadCounters) {
+        threadCounters = make_unique<HardwareCounterGroup>();
+        std::string error;
+        if (!threadCounters->Open(error)) {
+            // Only report the first failure; every other thread will fail the same way.
+            if (!hardwareCountersFailed.exchange(true)) {
+                std::cerr << "WARNING: Hardware counters unavailable (" << error << "). Reporting time only." << std::endl;
+            }
+            return false;
+        }
+    }
+    return threadCounters->Read(output);
+}
+
+const DiagnosticsCounters& Diagnostics::GetThreadStats() const
+{
+    return threadStatistics;
 }
 
 void Diagnostics::Log(const std::string& log)
@@ -25,11 +138,96 @@ void Diagnostics::Log(const std::string& log)
 
 void Diagnostics::Print()
 {
+    FlushThreadStats();
+
+    std::lock_guard<std::mutex> lock(aggregatorMutex);
     std::cout << "====================== DIAGNOSTICS START ======================" << std::endl;
-    std::cout << "Ray-Triangle Intersections: " << statisticsAggregator[DiagnosticsType::TRIANGLE_INTERSECTIONS] << std::endl;
-    std::cout << "Ray-Box Intersections: " << statisticsAggregator[DiagnosticsType::BOX_INTERSECTIONS] << std::endl;
-    std::cout << "Rays Created: " << statisticsAggregator[DiagnosticsType::RAYS_CREATED] << std::endl;
+    std::cout << "Ray-Triangle Intersections: " << statisticsAggregator[static_cast<size_t>(DiagnosticsType::TRIANGLE_INTERSECTIONS)] << std::endl;
+    std::cout << "Ray-Sphere Intersections: " << statisticsAggregator[static_cast<size_t>(DiagnosticsType::SPHERE_INTERSECTIONS)] << std::endl;
+    std::cout << "Ray-Box Intersections: " << statisticsAggregator[static_cast<size_t>(DiagnosticsType::BOX_INTERSECTIONS)] << std::endl;
+    std::cout << "Acceleration Nodes Visited: " << statisticsAggregator[static_cast<size_t>(DiagnosticsType::NODES_VISITED)] << std::endl;
+    std::cout << "Rays Created: " << statisticsAggregator[static_cast<size_t>(DiagnosticsType::RAYS_CREATED)] << std::endl;
+    if (ArePhasesEnabled()) {
+        PrintPhases();
+    }
     std::cout << "====================== DIAGNOSTICS END ========================" << std::endl;
 }
 
-#endif
\ No newline at end of file
+void Diagnostics::PrintPhases()
+{
+    const bool hasCounters = hardwareCountersRequested && !hardwareCountersFailed;
+    for (size_t p = 0; p < phaseAggregator.size(); ++p) {
+        const DiagnosticsPhaseStats& stats = phaseAggregator[p];
+        if (!stats.calls) {
+            continue;
+        }
+
+        std::cout << "Phase " << GetPhaseName(static_cast<DiagnosticsPhase>(p)) << ": " << stats.calls << " calls, "
+                  << stats.nanoseconds / 1e9 << " seconds, " << stats.rays << " rays (timed " << stats.sampledCalls << " calls)" << std::endl;
+        if (!hasCounters) {
+            continue;
+        }
+
+        const uint64_t cycles = stats.counters[static_cast<size_t>(HardwareCounterType::CYCLES)];
+        const uint64_t instructions = stats.counters[static_cast<size_t>(HardwareCounterType::INSTRUCTIONS)];
+        std::cout << "    IPC: " << std::fixed << std::setprecision(2) << ((cycles > 0) ? static_cast<double>(instructions) / cycles : 0.0) << std::endl;
+        for (size_t c = 0; c < stats.counters.size(); ++c) {
+            std::cout << "    " << HardwareCounterGroup::GetCounterName(static_cast<HardwareCounterType>(c)) << ": " << stats.counters[c];
+            if (stats.rays > 0) {
+                std::cout << " (" << static_cast<double>(stats.counters[c]) / stats.rays << " per ray)";
+            }
+            std::cout << std::endl;
+        }
+        std::cout << std::defaultfloat;
+    }
+}
+
+DiagnosticsPhaseScope::DiagnosticsPhaseScope(DiagnosticsPhase inputPhase):
+    phase(inputPhase), active(Diagnostics::ArePhasesEnabled()), weight(0), hasCounters(false), startRays(0), startTime(0)
+{
+    if (!active) {
+        return;
+    }
+    Diagnostics* diagnostics = Diagnostics::Get();
+    startRays = diagnostics->GetThreadStats()[static_cast<size_t>(DiagnosticsType::RAYS_CREATED)];
+    const uint64_t call = threadPhaseCalls[static_cast<size_t>(phase)]++;
+    if (call < PHASE_SAMPLE_INTERVAL) {
+        weight = 1;
+    } else if (call % PHASE_SAMPLE_INTERVAL == 0) {
+        weight = PHASE_SAMPLE_INTERVAL;
+    } else {
+        return;
+    }
+    hasCounters = diagnostics->ReadThreadHardwareCounters(startCounters);
+    startTime = GetPhaseTimestamp();
+}
+
+DiagnosticsPhaseScope::~DiagnosticsPhaseScope()
+{
+    if (!active) {
+        return;
+    }
+    const int64_t endTime = weight ? GetPhaseTimestamp() : 0;
+    Diagnostics* diagnostics = Diagnostics::Get();
+
+    DiagnosticsPhaseStats sample;
+    sample.calls = 1;
+    sample.rays = diagnostics->GetThreadStats()[static_cast<size_t>(DiagnosticsType::RAYS_CREATED)] - startRays;
+    if (!weight) {
+        diagnostics->AddPhaseSample(phase, sample);
+        return;
+    }
+    sample.sampledCalls = 1;
+    sample.nanoseconds = weight * static_cast<uint64_t>(endTime - startTime);
+
+    HardwareCounterValues endCounters;
+    if (hasCounters && diagnostics->ReadThreadHardwareCounters(endCounters)) {
+        for (size_t c = 0; c < endCounters.size(); ++c) {
+            // Multiplexing scales the values, so guard against them going backwards.
+            sample.counters[c] = (endCounters[c] > startCounters[c]) ? weight * (endCounters[c] - startCounters[c]) : 0;
+        }
+    }
+    diagnostics->AddPhaseSample(phase, sample);
+}
+
+#endif
@@ -2,11 +2,32 @@
 
 #define DIAGNOSTICS_ON 1
 
+#include <array>
+#include <stdint.h>
+
 enum class DiagnosticsType
 {
     TRIANGLE_INTERSECTIONS = 0,
+    SPHERE_INTERSECTIONS,
     BOX_INTERSECTIONS,
     RAYS_CREATED,
+    NODES_VISITED,
+    MAX
+};
+
+// One counter per DiagnosticsType.
+typedef std::array<uint64_t, static_cast<size_t>(DiagnosticsType::MAX)> DiagnosticsCounters;
+
+// Named phases measured with wall-clock time and, when enabled, hardware performance counters.
+// Phases are inclusive: a phase nested in another one is counted in both. Phases wrap single rays, so past the first few
+// calls only a sample of them is timed and reads the counters, and the totals are estimated from those.
+enum class DiagnosticsPhase
+{
+    BVH_BUILD = 0,
+    PRIMARY_TRACING,
+    SHADOW_TRACING,
+    EARTH_SHADING,
+    PHOTON_GATHERING,
     MAX
 };
 
@@ -16,9 +37,27 @@ enum class DiagnosticsType
 #define DIAGNOSTICS_TIMER(N,D) Timer N(D)
 #define DIAGNOSTICS_END_TIMER(N) N.Tock()
 #define DIAGNOSTICS_LOG(S) Diagnostics::Get()->Log(S)
+#define DIAGNOSTICS_FLUSH_THREAD() Diagnostics::Get()->FlushThreadStats()
+#define DIAGNOSTICS_PHASE(N,P) DiagnosticsPhaseScope N(P)
 
+#include "common/Utility/Diagnostics/HardwareCounters.h"
+#include <atomic>
 #include <memory>
-#include <map>
+#include <mutex>
+#include <string>
+
+struct DiagnosticsPhaseStats
+{
+    DiagnosticsPhaseStats() : calls(0), rays(0), sampledCalls(0), nanoseconds(0) { counters.fill(0); }
+
+    uint64_t calls;
+    uint64_t rays;
+    // Calls that were timed. The time and counters are estimated from those, each standing in for the calls that
+    // were not timed.
+    uint64_t sampledCalls;
+    uint64_t nanoseconds;
+    HardwareCounterValues counters;
+};
 
 class Diagnostics
 {
@@ -27,12 +66,54 @@ public:
 
     static Diagnostics* Get();
 
+    // Statistics are gathered per thread and only merged into the global totals on FlushThreadStats.
     void IncrementStat(DiagnosticsType type);
+    void FlushThreadStats();
+
+    // Counters gathered by the calling thread since its last flush. Useful to measure the cost of a single pixel.
+    const DiagnosticsCounters& GetThreadStats() const;
+
+    // Global total of a statistic, including everything the calling thread gathered so far.
+    uint64_t GetTotalStat(DiagnosticsType type);
+
+    // Phase measurement is off by default. Hardware counters are opened lazily per thread; if they are
+    // unavailable (e.g. perf_event_paranoid or a container without PMU access) only time and rays are reported.
+    // Every call of a phase counts its rays, but past the first few calls per thread only a sample of them is timed.
+    void EnablePhases(bool useHardwareCounters);
+    static bool ArePhasesEnabled() { return phasesEnabled.load(std::memory_order_relaxed); }
+    void AddPhaseSample(DiagnosticsPhase phase, const DiagnosticsPhaseStats& sample);
+
+    // Counter values for the calling thread, false if counters are disabled or unavailable.
+    bool ReadThreadHardwareCounters(HardwareCounterValues& output);
+
     void Print();
     void Log(const std::string& log);
 private:
+    void PrintPhases();
+
+    static std::atomic<bool> phasesEnabled;
+    std::atomic<bool> hardwareCountersRequested;
+    std::atomic<bool> hardwareCountersFailed;
 
-    std::map<DiagnosticsType, int> statisticsAggregator;
+    std::mutex aggregatorMutex;
+    DiagnosticsCounters statisticsAggregator;
+    std::array<DiagnosticsPhaseStats, static_cast<size_t>(DiagnosticsPhase::MAX)> phaseAggregator;
+};
+
+class DiagnosticsPhaseScope
+{
+public:
+    DiagnosticsPhaseScope(DiagnosticsPhase inputPhase);
+    ~DiagnosticsPhaseScope();
+private:
+    DiagnosticsPhase phase;
+    bool active;
+    // Number of calls the measurement stands in for, 0 if this call is not timed.
+    uint64_t weight;
+    bool hasCounters;
+    uint64_t startRays;
+    int64_t startTime;
+    HardwareCounterValues startCounters;
 };
 
 #else
@@ -41,4 +122,6 @@ private:
 #define DIAGNOSTICS_TIMER(N,D)
 #define DIAGNOSTICS_END_TIMER(N)
 #define DIAGNOSTICS_LOG(S)
-#endif
\ No newline at end of file
+#define DIAGNOSTICS_FLUSH_THREAD()
+#define DIAGNOSTICS_PHASE(N,P)
+#endif
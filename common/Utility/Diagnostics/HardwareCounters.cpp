@@ -0,0 +1,151 @@
+#include "common/Utility/Diagnostics/HardwareCounters.h"
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+#ifdef __linux__
+struct CounterConfig
+{
+    uint32_t type;
+    uint64_t config;
+};
+
+const CounterConfig counterConfigs[] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES }
+};
+
+int OpenCounter(const CounterConfig& counter, int groupLeader)
+{
+    perf_event_attr attributes;
+    memset(&attributes, 0, sizeof(attributes));
+    attributes.size = sizeof(attributes);
+    attributes.type = counter.type;
+    attributes.config = counter.config;
+    attributes.disabled = (groupLeader < 0) ? 1 : 0;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(__NR_perf_event_open, &attributes, 0, -1, groupLeader, 0));
+}
+#endif
+}
+
+HardwareCounterGroup::HardwareCounterGroup():
+    groupLeader(-1), openCounters(0)
+{
+    fileDescriptors.fill(-1);
+    counterSlot.fill(-1);
+}
+
+HardwareCounterGroup::~HardwareCounterGroup()
+{
+    Close();
+}
+
+bool HardwareCounterGroup::Open(std::string& error)
+{
+    if (IsOpen()) {
+        return true;
+    }
+#ifdef __linux__
+    for (size_t i = 0; i < fileDescriptors.size(); ++i) {
+        const int descriptor = OpenCounter(counterConfigs[i], groupLeader);
+        if (descriptor < 0) {
+            // Without the cycle counter as group leader there is nothing to measure.
+            if (groupLeader < 0) {
+                error = std::string("perf_event_open failed: ") + strerror(errno);
+                return false;
+            }
+            continue;
+        }
+        if (groupLeader < 0) {
+            groupLeader = descriptor;
+        }
+        fileDescriptors[i] = descriptor;
+        counterSlot[i] = openCounters++;
+    }
+
+    ioctl(groupLeader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    if (ioctl(groupLeader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) < 0) {
+        error = std::string("failed to enable counters: ") + strerror(errno);
+        Close();
+        return false;
+    }
+    return true;
+#else
+    error = "hardware counters are only supported on Linux";
+    return false;
+#endif
+}
+
+void HardwareCounterGroup::Close()
+{
+#ifdef __linux__
+    for (size_t i = 0; i < fileDescriptors.size(); ++i) {
+        if (fileDescriptors[i] >= 0) {
+            close(fileDescriptors[i]);
+        }
+    }
+#endif
+    fileDescriptors.fill(-1);
+    counterSlot.fill(-1);
+    groupLeader = -1;
+    openCounters = 0;
+}
+
+bool HardwareCounterGroup::Read(HardwareCounterValues& output) const
+{
+    output.fill(0);
+    if (!IsOpen()) {
+        return false;
+    }
+#ifdef __linux__
+    // Layout of a PERF_FORMAT_GROUP read: count, time enabled, time running, then one value per counter.
+    uint64_t buffer[3 + static_cast<size_t>(HardwareCounterType::MAX)];
+    const ssize_t bytesRead = read(groupLeader, buffer, sizeof(buffer));
+    if (bytesRead < static_cast<ssize_t>(3 * sizeof(uint64_t)) || buffer[0] != static_cast<uint64_t>(openCounters)) {
+        return false;
+    }
+
+    const double scale = (buffer[2] > 0) ? static_cast<double>(buffer[1]) / buffer[2] : 0.0;
+    for (size_t i = 0; i < output.size(); ++i) {
+        if (counterSlot[i] >= 0) {
+            output[i] = static_cast<uint64_t>(std::llround(buffer[3 + counterSlot[i]] * scale));
+        }
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+const char* HardwareCounterGroup::GetCounterName(HardwareCounterType type)
+{
+    switch (type) {
+        case HardwareCounterType::CYCLES:
+            return "Cycles";
+        case HardwareCounterType::INSTRUCTIONS:
+            return "Instructions";
+        case HardwareCounterType::L1D_MISSES:
+            return "L1D Misses";
+        case HardwareCounterType::LLC_MISSES:
+            return "LLC Misses";
+        case HardwareCounterType::BRANCH_MISSES:
+            return "Branch Misses";
+        default:
+            return "Unknown";
+    }
+}
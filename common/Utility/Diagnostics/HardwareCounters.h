@@ -0,0 +1,46 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <stdint.h>
+
+enum class HardwareCounterType
+{
+    CYCLES = 0,
+    INSTRUCTIONS,
+    L1D_MISSES,
+    LLC_MISSES,
+    BRANCH_MISSES,
+    MAX
+};
+
+typedef std::array<uint64_t, static_cast<size_t>(HardwareCounterType::MAX)> HardwareCounterValues;
+
+// A group of hardware performance counters measuring the calling thread (Linux perf_event_open).
+// Opening fails gracefully when the kernel or container does not expose counters; individual counters the
+// CPU does not support are skipped and read back as zero.
+class HardwareCounterGroup
+{
+public:
+    HardwareCounterGroup();
+    ~HardwareCounterGroup();
+
+    bool Open(std::string& error);
+    bool IsOpen() const { return groupLeader >= 0; }
+    bool IsCounterAvailable(HardwareCounterType type) const { return counterSlot[static_cast<size_t>(type)] >= 0; }
+
+    // Current counter values, scaled up if the kernel had to multiplex the group.
+    bool Read(HardwareCounterValues& output) const;
+
+    static const char* GetCounterName(HardwareCounterType type);
+private:
+    HardwareCounterGroup(const HardwareCounterGroup&) = delete;
+    HardwareCounterGroup& operator=(const HardwareCounterGroup&) = delete;
+
+    void Close();
+
+    int groupLeader;
+    std::array<int, static_cast<size_t>(HardwareCounterType::MAX)> fileDescriptors;
+    std::array<int, static_cast<size_t>(HardwareCounterType::MAX)> counterSlot;
+    int openCounters;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "common/common.h"
+
+// Stateless random numbers: every value is a hash of its key, the stream it belongs to, an index such as the pixel or
+// photon, the sample within it and the dimension within the sample. Results only depend on the key, so parallel
+// renders come out the same whatever thread computes what, and no generator state is shared between threads. The hash
+// is pcg4d (Jarzynski and Olano, "Hash Functions for GPU Rendering"), integer multiplies, adds and shifts only, so
+// loops over keys vectorize.
+namespace CounterRandom
+{
+
+// Separates the random numbers of different users of the same indices.
+enum class Stream : uint32_t
+{
+    PIXEL_SAMPLES,
+    SAMPLE_ORDER,
+    PHOTON_EMISSION,
+    PHOTON_SCATTERING,
+    FINAL_GATHER
+};
+
+inline uint32_t Hash(uint32_t stream, uint32_t index, uint32_t sample, uint32_t dimension)
+{
+    uint32_t x = index * 1664525u + 1013904223u;
+    uint32_t y = sample * 1664525u + 1013904223u;
+    uint32_t z = dimension * 1664525u + 1013904223u;
+    uint32_t w = stream * 1664525u + 1013904223u;
+    x += y * w;
+    y += z * x;
+    z += x * y;
+    w += y * z;
+    x ^= x >> 16;
+    y ^= y >> 16;
+    z ^= z >> 16;
+    w ^= w >> 16;
+    x += y * w;
+    y += z * x;
+    z += x * y;
+    return x;
+}
+
+// Uniform in [0, 1), from the top 24 bits.
+inline float ToUniform(uint32_t bits)
+{
+    return static_cast<float>(bits >> 8) * (1.f / 16777216.f);
+}
+
+inline float Uniform(Stream stream, uint32_t index, uint32_t sample, uint32_t dimension)
+{
+    return ToUniform(Hash(static_cast<uint32_t>(stream), index, sample, dimension));
+}
+
+// output[i] = Uniform(stream, index, firstSample + i, dimension) for count samples.
+inline void UniformBatch(Stream stream, uint32_t index, uint32_t firstSample, uint32_t dimension, int count, float* output)
+{
+    for (int i = 0; i < count; ++i) {
+        output[i] = Uniform(stream, index, firstSample + static_cast<uint32_t>(i), dimension);
+    }
+}
+
+}
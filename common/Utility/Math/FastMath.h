@@ -0,0 +1,153 @@
+#pragma once
+
+#include "common/common.h"
+#include <cstring>
+
+// Polynomial approximations of the transcendental functions in the earth shading and the sphere UVs. They have no
+// branches beyond selects and no tables, so loops over them vectorize. HIGH stays within about 1e-7 of libm for Exp2
+// and 2e-6 for Log2, Atan2 and Asin; LOW within about 1e-4 with half the multiplies.
+namespace FastMath
+{
+
+enum class Accuracy
+{
+    LOW,
+    HIGH
+};
+
+inline float BitsToFloat(int32_t bits)
+{
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+inline int32_t FloatToBits(float value)
+{
+    int32_t result;
+    memcpy(&result, &value, sizeof(result));
+    return result;
+}
+
+// value where x is positive and 0 elsewhere. Positive floats are exactly the ones with positive bits as a signed
+// integer, and masking the bits, unlike a float select, vectorizes.
+inline float MaskPositive(float x, float value)
+{
+    return BitsToFloat(FloatToBits(value) & -static_cast<int32_t>(FloatToBits(x) > 0));
+}
+
+// The larger of two floats, at least one of them non-negative, for the same reason: non-negative floats compare like
+// their bits as integers, and negative ones have negative bits.
+inline float MaxNonNegative(float a, float b)
+{
+    const int32_t aBits = FloatToBits(a);
+    const int32_t bBits = FloatToBits(b);
+    return BitsToFloat(aBits > bBits ? aBits : bBits);
+}
+
+// x clamped to [0, 1] on its bits, likewise.
+inline float Saturate(float x)
+{
+    int32_t bits = FloatToBits(x);
+    bits = (bits < 0) ? 0 : bits;
+    bits = (bits > 0x3f800000) ? 0x3f800000 : bits;
+    return BitsToFloat(bits);
+}
+
+// Saturates to about 2^-126 and 2^128 instead of producing denormals or infinities; |x| has to stay below 2^31.
+template <Accuracy A>
+inline float Exp2(float x)
+{
+    // Floor by truncation, and clamping on the integer part, since float selects keep GCC from vectorizing unless
+    // trapping math is off.
+    const int32_t truncated = static_cast<int32_t>(x);
+    int32_t whole = truncated - static_cast<int32_t>(x < static_cast<float>(truncated));
+    const float f = x - static_cast<float>(whole);
+    whole = (whole < -126) ? -126 : whole;
+    whole = (whole > 127) ? 127 : whole;
+    float p;
+    if (A == Accuracy::HIGH) {
+        p = 0.999999927f + f * (0.693152968f + f * (0.240154529f + f * (0.0558236072f + f * (0.00899258076f + f * 0.00187623428f))));
+    } else {
+        p = 0.999927827f + f * (0.695777096f + f * (0.226233194f + f * 0.0779071638f));
+    }
+    return p * BitsToFloat((whole + 127) << 23);
+}
+
+// Only meaningful for positive, normal x.
+template <Accuracy A>
+inline float Log2(float x)
+{
+    const int32_t bits = FloatToBits(x);
+    const float exponent = static_cast<float>(((bits >> 23) & 0xff) - 127);
+    const float t = BitsToFloat((bits & 0x007fffff) | 0x3f800000) - 1.f;
+    float p;
+    if (A == Accuracy::HIGH) {
+        p = 1.44253478f + t * (-0.718033606f + t * (0.457158191f + t * (-0.277341784f + t * (0.121473072f + t * -0.0257923863f))));
+    } else {
+        p = 1.43863803f + t * (-0.677743267f + t * (0.321879707f + t * -0.0828606983f));
+    }
+    return exponent + t * p;
+}
+
+template <Accuracy A>
+inline float Exp(float x)
+{
+    return Exp2<A>(x * 1.44269504f);
+}
+
+// x <= 0 gives 0, which matches powf for x = 0 and positive y.
+template <Accuracy A>
+inline float Pow(float x, float y)
+{
+    return MaskPositive(x, Exp2<A>(y * Log2<A>(x)));
+}
+
+// Exact up to rounding, by repeated squaring. Keeps the sign of odd powers like powf.
+template <int N>
+inline float IntPow(float x)
+{
+    return ((N % 2) ? x : 1.f) * IntPow<N / 2>(x * x);
+}
+
+template <>
+inline float IntPow<0>(float)
+{
+    return 1.f;
+}
+
+template <Accuracy A>
+inline float Atan2(float y, float x)
+{
+    const float ax = fabsf(x);
+    const float ay = fabsf(y);
+    const float t = std::min(ax, ay) / std::max(std::max(ax, ay), std::numeric_limits<float>::min());
+    const float t2 = t * t;
+    float p;
+    if (A == Accuracy::HIGH) {
+        p = 0.999999434f + t2 * (-0.333300948f + t2 * (0.199483778f + t2 * (-0.139151707f + t2 * (0.0965470564f + t2 * (-0.0560428406f + t2 * (0.0219330504f + t2 * -0.00406969517f))))));
+    } else {
+        p = 0.999267721f + t2 * (-0.321430484f + t2 * (0.146615289f + t2 * -0.0391341486f));
+    }
+    float angle = t * p;
+    angle = (ay > ax) ? 0.5f * PI - angle : angle;
+    angle = (x < 0.f) ? PI - angle : angle;
+    return (y < 0.f) ? -angle : angle;
+}
+
+// Abramowitz and Stegun 4.4.45 and 4.4.46.
+template <Accuracy A>
+inline float Asin(float x)
+{
+    const float a = std::min(fabsf(x), 1.f);
+    float p;
+    if (A == Accuracy::HIGH) {
+        p = 1.5707963050f + a * (-0.2145988016f + a * (0.0889789874f + a * (-0.0501743046f + a * (0.0308918810f + a * (-0.0170881256f + a * (0.0066700901f + a * -0.0012624911f))))));
+    } else {
+        p = 1.5707288f + a * (-0.2121144f + a * (0.0742610f + a * -0.0187293f));
+    }
+    const float angle = 0.5f * PI - sqrtf(1.f - a) * p;
+    return (x < 0.f) ? -angle : angle;
+}
+
+}
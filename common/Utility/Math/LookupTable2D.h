@@ -0,0 +1,50 @@
+#pragma once
+
+#include "common/common.h"
+
+// Bilinearly interpolated table of a smooth function of two arguments, for shading terms that are expensive to
+// evaluate per pixel. T needs to support addition and multiplication by float.
+template <typename T>
+class LookupTable2D
+{
+public:
+    LookupTable2D() : width(0), height(0) {}
+
+    // Tabulates function(x, y) at width x height points spanning [minimum, maximum], corners included.
+    template <typename Function>
+    LookupTable2D(Function function, glm::vec2 minimum, glm::vec2 maximum, int inputWidth, int inputHeight) :
+        values(static_cast<size_t>(inputWidth) * inputHeight), origin(minimum),
+        scale(glm::vec2(inputWidth - 1, inputHeight - 1) / (maximum - minimum)), width(inputWidth), height(inputHeight)
+    {
+        assert(width >= 2 && height >= 2);
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                const glm::vec2 point = minimum + (maximum - minimum) * glm::vec2(x, y) / glm::vec2(width - 1, height - 1);
+                values[static_cast<size_t>(y) * width + x] = function(point.x, point.y);
+            }
+        }
+    }
+
+    bool IsEmpty() const { return values.empty(); }
+
+    // Arguments outside the table's range are clamped to it.
+    T Sample(float x, float y) const
+    {
+        const glm::vec2 position = glm::clamp((glm::vec2(x, y) - origin) * scale, glm::vec2(0.f), glm::vec2(width - 1, height - 1));
+        const int x0 = std::min(static_cast<int>(position.x), width - 2);
+        const int y0 = std::min(static_cast<int>(position.y), height - 2);
+        const float fx = position.x - x0;
+        const float fy = position.y - y0;
+        const T* row = &values[static_cast<size_t>(y0) * width + x0];
+        const T top = row[0] * (1.f - fx) + row[1] * fx;
+        const T bottom = row[width] * (1.f - fx) + row[width + 1] * fx;
+        return top * (1.f - fy) + bottom * fy;
+    }
+
+private:
+    std::vector<T> values;
+    glm::vec2 origin;
+    glm::vec2 scale;
+    int width;
+    int height;
+};
@@ -45,6 +45,7 @@ void LoadFaceIntoPrimitive(const aiFace& face, PrimitiveBase& primitive, std::ve
 
 std::vector<std::shared_ptr<MeshObject>> LoadMesh(const std::string& filename, std::vector<std::shared_ptr<aiMaterial>>* outputMaterials)
 {
+    PROFILE_ZONE(zone, "Load Mesh " + filename);
 
 #ifndef ASSET_PATH
     static_assert(false, "ASSET_PATH is not defined. Check to make sure your projects are setup correctly");
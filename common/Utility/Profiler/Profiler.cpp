@@ -0,0 +1,159 @@
+#include "common/common.h"
+#include "common/Utility/Profiler/Profiler.h"
+#include "common/Utility/Text/JSON.h"
+#include <fstream>
+#include <map>
+
+#if PROFILER_ON
+
+std::atomic<bool> Profiler::enabled(false);
+
+Profiler* Profiler::Get()
+{
+    static std::unique_ptr<Profiler> singleton = make_unique<Profiler>();
+    return singleton.get();
+}
+
+Profiler::Profiler():
+    epoch(std::chrono::steady_clock::now())
+{
+}
+
+void Profiler::Enable(bool input)
+{
+    enabled.store(input, std::memory_order_relaxed);
+}
+
+int& Profiler::CurrentDepth()
+{
+    static thread_local int depth = 0;
+    return depth;
+}
+
+int64_t Profiler::GetTimestamp() const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+Profiler::ThreadBuffer* Profiler::GetThreadBuffer()
+{
+    static thread_local ThreadBuffer* threadBuffer = nullptr;
+    if (!threadBuffer) {
+        std::lock_guard<std::mutex> lock(registrationMutex);
+        std::unique_ptr<ThreadBuffer> newBuffer = make_unique<ThreadBuffer>();
+        newBuffer->threadId = static_cast<int>(threadBuffers.size());
+        newBuffer->threadName = (newBuffer->threadId == 0) ? "Main" : "Thread " + std::to_string(newBuffer->threadId);
+        threadBuffer = newBuffer.get();
+        threadBuffers.push_back(std::move(newBuffer));
+    }
+    return threadBuffer;
+}
+
+void Profiler::SetThreadName(const std::string& name)
+{
+    if (!IsEnabled()) {
+        return;
+    }
+    GetThreadBuffer()->threadName = name;
+}
+
+void Profiler::RecordZone(std::string name, int64_t startNanoseconds, int64_t endNanoseconds, int depth)
+{
+    GetThreadBuffer()->events.push_back({ std::move(name), startNanoseconds, endNanoseconds, depth });
+}
+
+bool Profiler::WriteChromeTrace(const std::string& filename) const
+{
+    std::ofstream output(filename);
+    if (!output) {
+        std::cerr << "ERROR: Failed to open trace output " << filename << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(registrationMutex);
+    output << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (size_t t = 0; t < threadBuffers.size(); ++t) {
+        const ThreadBuffer& buffer = *threadBuffers[t];
+        output << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer.threadId
+               << ",\"args\":{\"name\":\"" << JSON::Escape(buffer.threadName) << "\"}}";
+        first = false;
+
+        // Chrome expects timestamps and durations in microseconds.
+        for (size_t i = 0; i < buffer.events.size(); ++i) {
+            const ZoneEvent& zone = buffer.events[i];
+            output << ",\n{\"name\":\"" << JSON::Escape(zone.name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer.threadId
+                   << ",\"ts\":" << zone.start / 1000.0 << ",\"dur\":" << (zone.end - zone.start) / 1000.0
+                   << ",\"args\":{\"depth\":" << zone.depth << "}}";
+        }
+    }
+    output << "\n]}\n";
+    return static_cast<bool>(output);
+}
+
+void Profiler::PrintSummary() const
+{
+    struct ZoneSummary
+    {
+        ZoneSummary() : count(0), total(0), longest(0) {}
+        uint64_t count;
+        int64_t total;
+        int64_t longest;
+    };
+
+    std::map<std::string, ZoneSummary> summary;
+    {
+        std::lock_guard<std::mutex> lock(registrationMutex);
+        for (size_t t = 0; t < threadBuffers.size(); ++t) {
+            for (const ZoneEvent& zone : threadBuffers[t]->events) {
+                ZoneSummary& entry = summary[zone.name];
+                const int64_t duration = zone.end - zone.start;
+                ++entry.count;
+                entry.total += duration;
+                entry.longest = std::max(entry.longest, duration);
+            }
+        }
+    }
+
+    std::cout << "====================== PROFILER START ======================" << std::endl;
+    for (const auto& entry : summary) {
+        std::cout << entry.first << ": " << entry.second.count << " calls, " << entry.second.total / 1e9 << " seconds total, "
+                  << entry.second.longest / 1e9 << " seconds longest" << std::endl;
+    }
+    std::cout << "====================== PROFILER END ========================" << std::endl;
+}
+
+ProfilerZone::ProfilerZone(const char* name):
+    active(Profiler::IsEnabled())
+{
+    if (active) {
+        zoneName = name;
+        Begin();
+    }
+}
+
+ProfilerZone::ProfilerZone(const std::string& name):
+    active(Profiler::IsEnabled())
+{
+    if (active) {
+        zoneName = name;
+        Begin();
+    }
+}
+
+void ProfilerZone::Begin()
+{
+    ++Profiler::CurrentDepth();
+    startTime = Profiler::Get()->GetTimestamp();
+}
+
+ProfilerZone::~ProfilerZone()
+{
+    if (!active) {
+        return;
+    }
+    const int depth = --Profiler::CurrentDepth();
+    Profiler::Get()->RecordZone(std::move(zoneName), startTime, Profiler::Get()->GetTimestamp(), depth);
+}
+
+#endif
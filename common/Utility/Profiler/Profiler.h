@@ -0,0 +1,90 @@
+#pragma once
+
+#define PROFILER_ON 1
+
+#if PROFILER_ON
+#define PROFILE_ZONE(N,D) ProfilerZone N(D)
+#define PROFILE_SET_THREAD_NAME(D) Profiler::Get()->SetThreadName(D)
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Hierarchical scoped-zone profiler. Zones are recorded per thread into buffers owned by the profiler, so recording
+// never takes a lock; only the first zone of a new thread registers its buffer. When the profiler is disabled a zone
+// costs a single relaxed atomic load.
+//
+// The recorded zones can be written out as Chrome trace-event JSON (chrome://tracing, Perfetto) or aggregated per zone name.
+// Both must only be called once all threads that recorded zones are done.
+class Profiler
+{
+public:
+    Profiler();
+
+    static Profiler* Get();
+
+    static bool IsEnabled()
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    void Enable(bool input);
+    void SetThreadName(const std::string& name);
+
+    void RecordZone(std::string name, int64_t startNanoseconds, int64_t endNanoseconds, int depth);
+    int64_t GetTimestamp() const;
+
+    // Zone depth of the calling thread.
+    static int& CurrentDepth();
+
+    bool WriteChromeTrace(const std::string& filename) const;
+    void PrintSummary() const;
+
+private:
+    struct ZoneEvent
+    {
+        std::string name;
+        int64_t start;
+        int64_t end;
+        int depth;
+    };
+
+    struct ThreadBuffer
+    {
+        int threadId;
+        std::string threadName;
+        std::vector<ZoneEvent> events;
+    };
+
+    ThreadBuffer* GetThreadBuffer();
+
+    static std::atomic<bool> enabled;
+
+    std::chrono::steady_clock::time_point epoch;
+    mutable std::mutex registrationMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> threadBuffers;
+};
+
+class ProfilerZone
+{
+public:
+    ProfilerZone(const char* name);
+    ProfilerZone(const std::string& name);
+    ~ProfilerZone();
+
+private:
+    void Begin();
+
+    bool active;
+    std::string zoneName;
+    int64_t startTime;
+};
+
+#else
+#define PROFILE_ZONE(N,D)
+#define PROFILE_SET_THREAD_NAME(D)
+#endif
@@ -0,0 +1,255 @@
+#include "common/Utility/Scene/Generation/SceneGenerator.h"
+#include "common/Scene/Scene.h"
+#include "common/Scene/SceneObject.h"
+#include "common/Scene/Geometry/Mesh/MeshObject.h"
+#include "common/Scene/Geometry/Primitives/Triangle/Triangle.h"
+#include "common/Scene/Lights/Point/PointLight.h"
+#include "common/Rendering/Material/BlinnPhong/BlinnPhongMaterial.h"
+#include "common/Scene/Geometry/Simple/Box/Box.h"
+#include <numeric>
+#include <random>
+#include <sstream>
+
+namespace SceneGenerator
+{
+
+namespace
+{
+const uint64_t TRIANGLES_PER_BOX = 12;
+
+// Adds the 12 triangles of an oriented box with flat normals.
+void AddBox(MeshObject& mesh, const glm::vec3& center, const glm::vec3& halfSize, const glm::mat3& orientation)
+{
+    static const int faceAxes[3][3] = { { 0, 1, 2 }, { 1, 2, 0 }, { 2, 0, 1 } };
+    for (int axis = 0; axis < 3; ++axis) {
+        for (int side = -1; side <= 1; side += 2) {
+            glm::vec3 normal, u, v;
+            normal[faceAxes[axis][0]] = static_cast<float>(side);
+            u[faceAxes[axis][1]] = 1.f;
+            v[faceAxes[axis][2]] = static_cast<float>(side);
+
+            glm::vec3 corners[4];
+            const glm::vec2 offsets[4] = { glm::vec2(-1.f, -1.f), glm::vec2(1.f, -1.f), glm::vec2(1.f, 1.f), glm::vec2(-1.f, 1.f) };
+            for (int i = 0; i < 4; ++i) {
+                const glm::vec3 local = (normal + u * offsets[i].x + v * offsets[i].y) * halfSize;
+                corners[i] = center + orientation * local;
+            }
+            const glm::vec3 worldNormal = glm::normalize(orientation * normal);
+
+            static const int indices[2][3] = { { 0, 1, 2 }, { 0, 2, 3 } };
+            for (int t = 0; t < 2; ++t) {
+                std::shared_ptr<Triangle> triangle = std::make_shared<Triangle>(&mesh);
+                for (int i = 0; i < 3; ++i) {
+                    triangle->SetVertexPosition(i, corners[indices[t][i]]);
+                    triangle->SetVertexNormal(i, worldNormal);
+                }
+                mesh.AddPrimitive(triangle);
+            }
+        }
+    }
+}
+
+glm::mat3 RandomOrientation(std::mt19937& generator)
+{
+    std::normal_distribution<float> normal;
+    std::uniform_real_distribution<float> angle(0.f, 2.f * PI);
+    const glm::vec3 axis = glm::normalize(glm::vec3(normal(generator), normal(generator), normal(generator)) + glm::vec3(1e-6f));
+    return glm::mat3_cast(glm::angleAxis(angle(generator), axis));
+}
+
+std::shared_ptr<BlinnPhongMaterial> CreateRandomMaterial(std::mt19937& generator)
+{
+    std::uniform_real_distribution<float> unit(0.2f, 0.8f);
+    std::shared_ptr<BlinnPhongMaterial> material = std::make_shared<BlinnPhongMaterial>();
+    material->SetDiffuse(glm::vec3(unit(generator), unit(generator), unit(generator)));
+    material->SetSpecular(glm::vec3(0.3f), 20.f);
+    return material;
+}
+
+// Splits region into one part per entry of boxCounts, with disjoint bounds. The longest axis is cut between the two
+// halves of the list in proportion to the boxes on either side, so all parts are filled with a similar density.
+void SplitRegion(const Box& region, const uint64_t* boxCounts, size_t count, std::vector<Box>& output)
+{
+    if (count == 1) {
+        output.push_back(region);
+        return;
+    }
+    const size_t half = count / 2;
+    const uint64_t lowerBoxes = std::accumulate(boxCounts, boxCounts + half, static_cast<uint64_t>(0));
+    const uint64_t upperBoxes = std::accumulate(boxCounts + half, boxCounts + count, static_cast<uint64_t>(0));
+    const glm::vec3 size = region.maxVertex - region.minVertex;
+    const int axis = (size.x >= size.y && size.x >= size.z) ? 0 : ((size.y >= size.z) ? 1 : 2);
+
+    Box lower = region;
+    Box upper = region;
+    lower.maxVertex[axis] = upper.minVertex[axis] = region.minVertex[axis] + size[axis] * lowerBoxes / static_cast<float>(lowerBoxes + upperBoxes);
+    SplitRegion(lower, boxCounts, half, output);
+    SplitRegion(upper, boxCounts + half, count - half, output);
+}
+
+// Clutter boxes with a half-size of averageSize on average, placed so that they stay within region whatever their
+// orientation.
+std::shared_ptr<MeshObject> CreateClutterMesh(std::mt19937& generator, uint64_t boxCount, const Box& region, float averageSize)
+{
+    std::uniform_real_distribution<float> scale(0.5f, 1.5f);
+    // Distance of the corners of the largest box from its center.
+    const float margin = std::sqrt(3.f) * 1.5f * averageSize;
+    const glm::vec3 low = glm::min(region.minVertex + margin, region.Center());
+    const glm::vec3 high = glm::max(region.maxVertex - margin, region.Center());
+    std::uniform_real_distribution<float> position[3] = {
+        std::uniform_real_distribution<float>(low.x, high.x),
+        std::uniform_real_distribution<float>(low.y, high.y),
+        std::uniform_real_distribution<float>(low.z, high.z)
+    };
+
+    std::shared_ptr<MeshObject> mesh = std::make_shared<MeshObject>();
+    for (uint64_t i = 0; i < boxCount; ++i) {
+        const glm::vec3 center(position[0](generator), position[1](generator), position[2](generator));
+        const glm::vec3 halfSize = averageSize * glm::vec3(scale(generator), scale(generator), scale(generator));
+        AddBox(*mesh, center, halfSize, RandomOrientation(generator));
+    }
+    return mesh;
+}
+
+// Trusses run the full width of region along one of the axes, snapped to a coarse lattice so that parallel beams
+// bunch up the way they do on real structures. The lattice has latticeSize lines across the whole volume, of the given
+// extent, and at least one across region.
+std::shared_ptr<MeshObject> CreateTrussMesh(std::mt19937& generator, uint64_t beamCount, const Box& region, float extent)
+{
+    const int latticeSize = 16;
+    std::uniform_int_distribution<int> axisDistribution(0, 2);
+    std::uniform_real_distribution<float> jitter(-0.16f, 0.16f);
+    std::uniform_real_distribution<float> length(0.25f, 1.f);
+    const float thickness = extent * 0.002f;
+
+    const glm::vec3 size = region.maxVertex - region.minVertex;
+    std::uniform_int_distribution<int> latticeDistribution[3];
+    for (int j = 0; j < 3; ++j) {
+        const int cells = std::max(1, static_cast<int>(latticeSize * size[j] / (2.f * extent)));
+        latticeDistribution[j] = std::uniform_int_distribution<int>(0, cells - 1);
+    }
+
+    std::shared_ptr<MeshObject> mesh = std::make_shared<MeshObject>();
+    for (uint64_t i = 0; i < beamCount; ++i) {
+        const int axis = axisDistribution(generator);
+        glm::vec3 center;
+        for (int j = 0; j < 3; ++j) {
+            const float cells = static_cast<float>(latticeDistribution[j].b() + 1);
+            center[j] = region.minVertex[j] + size[j] * (latticeDistribution[j](generator) + 0.5f + jitter(generator)) / cells;
+        }
+        glm::vec3 halfSize(thickness);
+        halfSize[axis] = 0.5f * size[axis] * length(generator);
+        center[axis] = region.Center()[axis];
+        AddBox(*mesh, center, halfSize, glm::mat3(1.f));
+    }
+    return mesh;
+}
+}
+
+Settings::Settings():
+    distribution(Distribution::UNIFORM_CLUTTER), totalTriangles(1000000), seed(1), center(0.f, 0.f, -500.f), extent(150.f),
+    trianglesPerObject(100000), instanceCount(64), accelerationType(AccelerationTypes::BVH)
+{
+}
+
+bool ParseDistribution(const std::string& name, Distribution& output)
+{
+    if (name == "clutter") {
+        output = Distribution::UNIFORM_CLUTTER;
+    } else if (name == "truss") {
+        output = Distribution::THIN_TRUSSES;
+    } else if (name == "instanced") {
+        output = Distribution::INSTANCED;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::string GetDistributionName(Distribution distribution)
+{
+    switch (distribution) {
+    case Distribution::UNIFORM_CLUTTER:
+        return "clutter";
+    case Distribution::THIN_TRUSSES:
+        return "truss";
+    case Distribution::INSTANCED:
+        return "instanced";
+    }
+    return "unknown";
+}
+
+std::string GetSceneDescription(const Settings& settings)
+{
+    // The acceleration structure changes how the scene is traced, not what it looks like.
+    std::ostringstream description;
+    description << GetDistributionName(settings.distribution) << " triangles " << settings.totalTriangles << " seed " << settings.seed
+        << " center " << settings.center.x << " " << settings.center.y << " " << settings.center.z << " extent " << settings.extent
+        << " per object " << settings.trianglesPerObject << " instances " << settings.instanceCount;
+    return description.str();
+}
+
+std::shared_ptr<Scene> GenerateScene(const Settings& settings)
+{
+    PROFILE_ZONE(zone, "Generate Scene");
+    std::mt19937 generator(settings.seed);
+    std::shared_ptr<Scene> scene = std::make_shared<Scene>();
+
+    const uint64_t totalBoxes = std::max<uint64_t>(settings.totalTriangles / TRIANGLES_PER_BOX, 1);
+    if (settings.distribution == Distribution::INSTANCED) {
+        const uint64_t instanceCount = std::max<uint64_t>(settings.instanceCount, 1);
+        const float instanceExtent = settings.extent / std::cbrt(static_cast<float>(instanceCount));
+        const uint64_t instanceBoxes = std::max<uint64_t>(totalBoxes / instanceCount, 1);
+        const float averageSize = 0.5f * instanceExtent / std::cbrt(static_cast<float>(instanceBoxes));
+        std::shared_ptr<MeshObject> mesh = CreateClutterMesh(generator, instanceBoxes, Box(glm::vec3(-instanceExtent), glm::vec3(instanceExtent)), averageSize);
+        mesh->SetName("Instanced Clutter");
+        mesh->SetMaterial(CreateRandomMaterial(generator));
+
+        std::uniform_real_distribution<float> position(-settings.extent, settings.extent);
+        std::uniform_real_distribution<float> angle(0.f, 2.f * PI);
+        for (uint64_t i = 0; i < instanceCount; ++i) {
+            std::shared_ptr<SceneObject> object = std::make_shared<SceneObject>();
+            object->AddMeshObject(mesh);
+            object->SetPosition(settings.center + glm::vec3(position(generator), position(generator), position(generator)));
+            object->Rotate(glm::vec3(0.f, 1.f, 0.f), angle(generator));
+            object->Rotate(glm::vec3(1.f, 0.f, 0.f), angle(generator));
+            // Every instance recreates the shared mesh's acceleration data; the mesh is only built once on Finalize.
+            object->CreateAccelerationData(settings.accelerationType);
+            scene->AddSceneObject(object);
+        }
+    } else {
+        // Each object fills its own part of the volume, so that the objects' bounds do not overlap.
+        const uint64_t boxesPerObject = std::max<uint64_t>(settings.trianglesPerObject / TRIANGLES_PER_BOX, 1);
+        std::vector<uint64_t> objectBoxes;
+        for (uint64_t created = 0; created < totalBoxes; created += boxesPerObject) {
+            objectBoxes.push_back(std::min(boxesPerObject, totalBoxes - created));
+        }
+        std::vector<Box> regions;
+        SplitRegion(Box(glm::vec3(-settings.extent), glm::vec3(settings.extent)), objectBoxes.data(), objectBoxes.size(), regions);
+        // Sized so that the whole volume is filled with a similar density regardless of the box count.
+        const float averageSize = 0.5f * settings.extent / std::cbrt(static_cast<float>(totalBoxes));
+
+        for (size_t i = 0; i < objectBoxes.size(); ++i) {
+            std::shared_ptr<MeshObject> mesh = (settings.distribution == Distribution::THIN_TRUSSES) ?
+                CreateTrussMesh(generator, objectBoxes[i], regions[i], settings.extent) : CreateClutterMesh(generator, objectBoxes[i], regions[i], averageSize);
+            mesh->SetName(GetDistributionName(settings.distribution) + " " + std::to_string(i));
+            mesh->SetMaterial(CreateRandomMaterial(generator));
+
+            std::shared_ptr<SceneObject> object = std::make_shared<SceneObject>();
+            object->AddMeshObject(mesh);
+            object->SetPosition(settings.center);
+            object->CreateAccelerationData(settings.accelerationType);
+            scene->AddSceneObject(object);
+        }
+    }
+    scene->GenerateAccelerationData(settings.accelerationType);
+
+    std::shared_ptr<Light> pointLight = std::make_shared<PointLight>();
+    pointLight->SetPosition(settings.center + glm::vec3(-2.f, 3.f, 4.f) * settings.extent);
+    pointLight->SetLightColor(glm::vec3(1.f, 1.f, 1.f));
+    scene->AddLight(pointLight);
+
+    return scene;
+}
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#ifndef __SCENE_GENERATOR__
+#define __SCENE_GENERATOR__
+
+#include "common/common.h"
+#include "common/Acceleration/AccelerationTypes.h"
+
+class Scene;
+
+namespace SceneGenerator
+{
+
+enum class Distribution
+{
+    // Small boxes scattered uniformly through the volume.
+    UNIFORM_CLUTTER,
+    // Long, thin beams along the grid axes, similar to the ISS trusses. Their triangles have huge bounding
+    // boxes relative to their area, which is the worst case for the acceleration structures.
+    THIN_TRUSSES,
+    // A single clutter mesh referenced by many scene objects with different transforms.
+    INSTANCED
+};
+
+struct Settings
+{
+    Settings();
+
+    Distribution distribution;
+    uint64_t totalTriangles;
+    unsigned int seed;
+
+    // The geometry is placed in a cube of the given half-size around the center. The defaults sit in front
+    // of the default camera, roughly where the ISS is.
+    glm::vec3 center;
+    float extent;
+
+    // Clutter and trusses are split into scene objects of at most this many triangles, each filling its own part of
+    // the volume.
+    uint64_t trianglesPerObject;
+    // Number of scene objects sharing the mesh in the INSTANCED distribution.
+    uint64_t instanceCount;
+
+    AccelerationTypes accelerationType;
+};
+
+bool ParseDistribution(const std::string& name, Distribution& output);
+std::string GetDistributionName(Distribution distribution);
+// Distribution and the settings that change the scene it generates, e.g. to tell renders of it apart.
+std::string GetSceneDescription(const Settings& settings);
+
+// Builds the scene objects, lights and acceleration data. The scene is not finalized, so that the acceleration
+// structure build can be timed separately by calling Scene::Finalize.
+std::shared_ptr<Scene> GenerateScene(const Settings& settings);
+
+}
+
+#endif
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+
+// Helpers for the JSON the profiler trace and the benchmark results are written as.
+namespace JSON
+{
+
+// The contents of a JSON string literal holding input, without the quotes.
+inline std::string Escape(const std::string& input)
+{
+    std::string output;
+    output.reserve(input.size());
+    for (size_t i = 0; i < input.size(); ++i) {
+        const char c = input[i];
+        if (c == '"' || c == '\\') {
+            output += '\\';
+            output += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[7];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(c));
+            output += escaped;
+        } else {
+            output += c;
+        }
+    }
+    return output;
+}
+
+}
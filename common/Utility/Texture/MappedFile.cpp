@@ -0,0 +1,144 @@
+#include "common/Utility/Texture/MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile():
+    data(nullptr), size(0), writable(false)
+#ifdef _WIN32
+    , fileHandle(INVALID_HANDLE_VALUE), mappingHandle(nullptr)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(const std::string& filename)
+{
+    Close();
+#ifdef _WIN32
+    fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER fileSize;
+    if (fileHandle == INVALID_HANDLE_VALUE || !GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0) {
+        Close();
+        return false;
+    }
+    mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    data = mappingHandle ? static_cast<const unsigned char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+    if (!data) {
+        Close();
+        return false;
+    }
+    size = static_cast<size_t>(fileSize.QuadPart);
+#else
+    const int fileDescriptor = open(filename.c_str(), O_RDONLY);
+    if (fileDescriptor < 0) {
+        return false;
+    }
+    struct stat fileStatus;
+    if (fstat(fileDescriptor, &fileStatus) != 0 || fileStatus.st_size == 0) {
+        close(fileDescriptor);
+        return false;
+    }
+    void* mapping = mmap(nullptr, fileStatus.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    // The mapping keeps its own reference to the file.
+    close(fileDescriptor);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    data = static_cast<const unsigned char*>(mapping);
+    size = static_cast<size_t>(fileStatus.st_size);
+#endif
+    return true;
+}
+
+bool MappedFile::OpenWritable(const std::string& filename, size_t inputSize)
+{
+    Close();
+    if (inputSize == 0) {
+        return false;
+    }
+#ifdef _WIN32
+    fileHandle = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER fileSize;
+    fileSize.QuadPart = static_cast<LONGLONG>(inputSize);
+    if (fileHandle == INVALID_HANDLE_VALUE || !SetFilePointerEx(fileHandle, fileSize, nullptr, FILE_BEGIN) || !SetEndOfFile(fileHandle)) {
+        Close();
+        return false;
+    }
+    mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+    data = mappingHandle ? static_cast<const unsigned char*>(MapViewOfFile(mappingHandle, FILE_MAP_WRITE, 0, 0, 0)) : nullptr;
+    if (!data) {
+        Close();
+        return false;
+    }
+#else
+    const int fileDescriptor = open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fileDescriptor < 0) {
+        return false;
+    }
+    if (ftruncate(fileDescriptor, static_cast<off_t>(inputSize)) != 0) {
+        close(fileDescriptor);
+        return false;
+    }
+    void* mapping = mmap(nullptr, inputSize, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+    close(fileDescriptor);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    data = static_cast<const unsigned char*>(mapping);
+#endif
+    size = inputSize;
+    writable = true;
+    return true;
+}
+
+bool MappedFile::Flush(size_t offset, size_t length)
+{
+    if (!writable || offset + length > size) {
+        return false;
+    }
+#ifdef _WIN32
+    return FlushViewOfFile(data + offset, length) && FlushFileBuffers(fileHandle);
+#else
+    // msync wants a page aligned start.
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t start = offset - offset % pageSize;
+    return msync(const_cast<unsigned char*>(data) + start, offset + length - start, MS_SYNC) == 0;
+#endif
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+    if (data) {
+        UnmapViewOfFile(data);
+    }
+    if (mappingHandle) {
+        CloseHandle(mappingHandle);
+    }
+    if (fileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(fileHandle);
+    }
+    fileHandle = INVALID_HANDLE_VALUE;
+    mappingHandle = nullptr;
+#else
+    if (data) {
+        munmap(const_cast<unsigned char*>(data), size);
+    }
+#endif
+    data = nullptr;
+    size = 0;
+    writable = false;
+}
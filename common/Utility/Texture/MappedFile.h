@@ -0,0 +1,37 @@
+#pragma once
+
+#include "common/common.h"
+
+// Memory mapping of a whole file, read-only unless opened with OpenWritable. Pages are only read from disk when they
+// are first touched.
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool Open(const std::string& filename);
+    // Maps filename shared and writable, creating it or resizing it to size bytes first. Writes reach the file
+    // whenever the system writes the pages back, even if the process is killed, and at the latest on Flush.
+    bool OpenWritable(const std::string& filename, size_t size);
+    void Close();
+
+    const unsigned char* GetData() const { return data; }
+    // NULL unless opened with OpenWritable.
+    unsigned char* GetWritableData() { return writable ? const_cast<unsigned char*>(data) : nullptr; }
+    size_t GetSize() const { return size; }
+
+    // Blocks until the given bytes of a writable mapping are on disk.
+    bool Flush(size_t offset, size_t length);
+private:
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* data;
+    size_t size;
+    bool writable;
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#endif
+};
@@ -0,0 +1,138 @@
+#include "common/Utility/Texture/TextureCache.h"
+
+namespace
+{
+// Default budget of 512 MB; about 32k tiles of 64x64 RGBA8.
+const size_t DEFAULT_MEMORY_BUDGET = static_cast<size_t>(512) << 20;
+
+uint64_t MixKey(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdull;
+    key ^= key >> 33;
+    return key;
+}
+}
+
+TextureCache::TextureCache():
+    memoryBudget(DEFAULT_MEMORY_BUDGET), threadCacheHits(0), sharedCacheHits(0), misses(0), evictions(0), bytesRead(0), residentBytes(0)
+{
+    for (int i = 0; i < SHARD_COUNT; ++i) {
+        shards[i].residentBytes = 0;
+    }
+}
+
+TextureCache* TextureCache::Get()
+{
+    static TextureCache cache;
+    return &cache;
+}
+
+void TextureCache::SetMemoryBudget(size_t bytes)
+{
+    memoryBudget = bytes;
+    for (int i = 0; i < SHARD_COUNT; ++i) {
+        std::lock_guard<std::mutex> lock(shards[i].mutex);
+        EvictToBudget(shards[i]);
+    }
+}
+
+uint64_t TextureCache::MakeTileKey(uint32_t textureId, int level, int tileX, int tileY)
+{
+    // 24 bits of texture, 6 bits of level and 17 bits per tile coordinate.
+    assert(textureId < (1u << 24) && level < 64 && tileX < (1 << 17) && tileY < (1 << 17));
+    return (static_cast<uint64_t>(textureId) << 40) | (static_cast<uint64_t>(level) << 34) | (static_cast<uint64_t>(tileY) << 17) | static_cast<uint64_t>(tileX);
+}
+
+TextureCache::Shard& TextureCache::GetShard(uint64_t key)
+{
+    return shards[MixKey(key) % SHARD_COUNT];
+}
+
+void TextureCache::EvictToBudget(Shard& shard)
+{
+    // Always keep the most recently used tile, even if it alone is over budget.
+    const size_t shardBudget = memoryBudget.load(std::memory_order_relaxed) / SHARD_COUNT;
+    while (shard.residentBytes > shardBudget && shard.lru.size() > 1) {
+        auto entry = shard.entries.find(shard.lru.back());
+        assert(entry != shard.entries.end());
+        const size_t tileBytes = entry->second.data->size();
+        shard.residentBytes -= tileBytes;
+        residentBytes -= tileBytes;
+        shard.entries.erase(entry);
+        shard.lru.pop_back();
+        ++evictions;
+    }
+}
+
+TextureCache::ThreadCacheEntry& TextureCache::GetThreadCacheEntry(uint64_t key)
+{
+    static thread_local ThreadCacheEntry threadCache[THREAD_CACHE_SIZE];
+    return threadCache[MixKey(key) % THREAD_CACHE_SIZE];
+}
+
+TextureCache::TileData TextureCache::FindTile(uint64_t key)
+{
+    ThreadCacheEntry& threadEntry = GetThreadCacheEntry(key);
+    if (threadEntry.key == key) {
+        threadCacheHits.fetch_add(1, std::memory_order_relaxed);
+        return threadEntry.data;
+    }
+
+    Shard& shard = GetShard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto entry = shard.entries.find(key);
+    if (entry == shard.entries.end()) {
+        return nullptr;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, entry->second.lruPosition);
+    sharedCacheHits.fetch_add(1, std::memory_order_relaxed);
+    threadEntry.key = key;
+    threadEntry.data = entry->second.data;
+    return threadEntry.data;
+}
+
+TextureCache::TileData TextureCache::InsertTile(uint64_t key, TileData tile)
+{
+    assert(tile);
+    misses.fetch_add(1, std::memory_order_relaxed);
+    bytesRead.fetch_add(tile->size(), std::memory_order_relaxed);
+
+    Shard& shard = GetShard(key);
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto entry = shard.entries.find(key);
+        if (entry != shard.entries.end()) {
+            shard.lru.splice(shard.lru.begin(), shard.lru, entry->second.lruPosition);
+            tile = entry->second.data;
+        } else {
+            shard.lru.push_front(key);
+            CacheEntry& newEntry = shard.entries[key];
+            newEntry.data = tile;
+            newEntry.lruPosition = shard.lru.begin();
+            shard.residentBytes += tile->size();
+            residentBytes += tile->size();
+            EvictToBudget(shard);
+        }
+    }
+
+    ThreadCacheEntry& threadEntry = GetThreadCacheEntry(key);
+    threadEntry.key = key;
+    threadEntry.data = tile;
+    return tile;
+}
+
+void TextureCache::PrintStatistics() const
+{
+    const uint64_t totalLookups = threadCacheHits + sharedCacheHits + misses;
+    if (!totalLookups) {
+        return;
+    }
+    std::cout << "======== TEXTURE CACHE ========" << std::endl;
+    std::cout << "Tile Lookups: " << totalLookups << std::endl;
+    std::cout << "Thread Cache Hits: " << threadCacheHits << " (" << 100.0 * threadCacheHits / totalLookups << "%)" << std::endl;
+    std::cout << "Shared Cache Hits: " << sharedCacheHits << " (" << 100.0 * sharedCacheHits / totalLookups << "%)" << std::endl;
+    std::cout << "Misses: " << misses << " (" << (bytesRead >> 20) << " MB read)" << std::endl;
+    std::cout << "Evictions: " << evictions << std::endl;
+    std::cout << "Resident: " << (residentBytes >> 20) << " MB of " << (GetMemoryBudget() >> 20) << " MB" << std::endl;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "common/common.h"
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+// Process-wide cache of texture tiles with an LRU memory budget, shared by all TiledTextures.
+//
+// Tiles are spread over independently locked shards, each of which evicts least recently used tiles once it holds
+// more than its share of the budget. Tiles are reference counted, so a tile stays valid for as long as a caller
+// holds on to it even if it has been evicted. On top of the shards every thread keeps a few recently used tiles,
+// which serves most lookups of a bilinear footprint without taking a lock.
+class TextureCache
+{
+public:
+    typedef std::shared_ptr<const std::vector<unsigned char>> TileData;
+
+    TextureCache();
+
+    static TextureCache* Get();
+
+    void SetMemoryBudget(size_t bytes);
+    size_t GetMemoryBudget() const { return memoryBudget.load(std::memory_order_relaxed); }
+
+    // Returns nullptr on a miss. Keys must be unique across all textures.
+    TileData FindTile(uint64_t key);
+    // Adds a tile loaded after a miss. If another thread added the same tile in the meantime, its copy is returned.
+    TileData InsertTile(uint64_t key, TileData tile);
+
+    static uint64_t MakeTileKey(uint32_t textureId, int level, int tileX, int tileY);
+
+    void PrintStatistics() const;
+private:
+    struct CacheEntry
+    {
+        TileData data;
+        std::list<uint64_t>::iterator lruPosition;
+    };
+
+    struct Shard
+    {
+        std::mutex mutex;
+        // Front is most recently used.
+        std::list<uint64_t> lru;
+        std::unordered_map<uint64_t, CacheEntry> entries;
+        size_t residentBytes;
+    };
+
+    static const int SHARD_COUNT = 64;
+    static const int THREAD_CACHE_SIZE = 16;
+
+    struct ThreadCacheEntry
+    {
+        ThreadCacheEntry() : key(~0ull) {}
+
+        uint64_t key;
+        TileData data;
+    };
+
+    Shard& GetShard(uint64_t key);
+    static ThreadCacheEntry& GetThreadCacheEntry(uint64_t key);
+    void EvictToBudget(Shard& shard);
+
+    Shard shards[SHARD_COUNT];
+    std::atomic<size_t> memoryBudget;
+
+    std::atomic<uint64_t> threadCacheHits;
+    std::atomic<uint64_t> sharedCacheHits;
+    std::atomic<uint64_t> misses;
+    std::atomic<uint64_t> evictions;
+    std::atomic<uint64_t> bytesRead;
+    std::atomic<size_t> residentBytes;
+};
@@ -1,17 +1,33 @@
 #include "common/Utility/Texture/TextureLoader.h"
 #include "common/Rendering/Textures/Texture2D.h"
+#include "common/Rendering/Textures/TiledTexture.h"
+#include "common/Utility/Texture/TiledTextureFile.h"
+#include "common/Utility/Texture/TextureRegistry.h"
 #include "FreeImage.h"
 #include <bitset>
+#include <fstream>
 
 namespace TextureLoader
 {
 
-unsigned char* LoadRawData(const std::string& filename, int& width, int& height)
+namespace
+{
+std::string GetCompleteFilename(const std::string& filename)
 {
 #ifndef ASSET_PATH
     static_assert(false, "ASSET_PATH is not defined. Check to make sure your projects are setup correctly");
 #endif
-    const std::string completeFilename = std::string(STRINGIFY(ASSET_PATH)) + "/" + filename;
+    return std::string(STRINGIFY(ASSET_PATH)) + "/" + filename;
+}
+
+bool FileExists(const std::string& filename)
+{
+    return static_cast<bool>(std::ifstream(filename));
+}
+
+FIBITMAP* LoadImage(const std::string& completeFilename)
+{
+    PROFILE_ZONE(zone, "Decode Texture " + completeFilename);
     // Determine File type
     FREE_IMAGE_FORMAT fif = FreeImage_GetFileType(completeFilename.c_str());
     if (fif == FIF_UNKNOWN) {
@@ -19,51 +35,204 @@ unsigned char* LoadRawData(const std::string& filename, int& width, int& height)
     }
 
     if (fif == FIF_UNKNOWN) {
-        std::cerr << "ERROR: Failed to determine the filetype for " << filename << std::endl;
+        std::cerr << "ERROR: Failed to determine the filetype for " << completeFilename << std::endl;
         return nullptr;
     }
 
+    FIBITMAP* inputImage = FreeImage_Load(fif, completeFilename.c_str(), 0);
+    if (!inputImage) {
+        std::cerr << "ERROR: Failed to read in the texture from - " << completeFilename << std::endl;
+    }
+    return inputImage;
+}
+}
+
+unsigned char* LoadRawData(const std::string& filename, int& width, int& height)
+{
+    return LoadRawDataFromPath(GetCompleteFilename(filename), width, height);
+}
+
+unsigned char* LoadRawDataFromPath(const std::string& completeFilename, int& width, int& height)
+{
     // Load image and make sure it's an RGBA texture.
     // This requirement is completely arbitrary.
-    FIBITMAP* inputImage = FreeImage_Load(fif, completeFilename.c_str(), 0);
+    FIBITMAP* inputImage = LoadImage(completeFilename);
     if (!inputImage) {
-        std::cerr << "ERROR: Failed to read in the texture from - " << filename << std::endl;
         return nullptr;
     }
 
-    // Create OpenGL texture and store it in our wrapper.
-    width = FreeImage_GetWidth(inputImage);
-    height = FreeImage_GetHeight(inputImage);
+    // Convert whole scanlines from FreeImage's 32-bit layout rather than going through FreeImage_GetPixelColor per pixel.
+    FIBITMAP* convertedImage = FreeImage_ConvertTo32Bits(inputImage);
+    FreeImage_Unload(inputImage);
+    if (!convertedImage) {
+        std::cerr << "ERROR: Failed to convert the texture from - " << completeFilename << std::endl;
+        return nullptr;
+    }
 
-    unsigned char* textureRawData = new unsigned char[width * height * 4];
+    width = FreeImage_GetWidth(convertedImage);
+    height = FreeImage_GetHeight(convertedImage);
 
-    RGBQUAD rgb;
+    unsigned char* textureRawData = new unsigned char[static_cast<size_t>(width) * height * 4];
     for (int y = 0; y < height; ++y) {
+        const BYTE* scanline = FreeImage_GetScanLine(convertedImage, y);
+        unsigned char* destination = textureRawData + static_cast<size_t>(y) * width * 4;
         for (int x = 0; x < width; ++x) {
-            FreeImage_GetPixelColor(inputImage, x, y, &rgb);
-            int idx = x * 4 + y * width * 4;
-            textureRawData[idx] = (unsigned char)rgb.rgbRed;
-            textureRawData[idx + 1] = (unsigned char)rgb.rgbGreen;
-            textureRawData[idx + 2] = (unsigned char)rgb.rgbBlue;
-            textureRawData[idx + 3] = 255;
+            destination[0] = scanline[FI_RGBA_RED];
+            destination[1] = scanline[FI_RGBA_GREEN];
+            destination[2] = scanline[FI_RGBA_BLUE];
+            destination[3] = 255;
+            scanline += 4;
+            destination += 4;
         }
     }
 
-    FreeImage_Unload(inputImage);
+    FreeImage_Unload(convertedImage);
 
     return textureRawData;
 }
 
+float* LoadFloatDataFromPath(const std::string& completeFilename, int& width, int& height)
+{
+    FIBITMAP* inputImage = LoadImage(completeFilename);
+    if (!inputImage) {
+        return nullptr;
+    }
+
+    FIBITMAP* convertedImage = FreeImage_ConvertToRGBAF(inputImage);
+    FreeImage_Unload(inputImage);
+    if (!convertedImage) {
+        std::cerr << "ERROR: Failed to convert the texture from - " << completeFilename << std::endl;
+        return nullptr;
+    }
+
+    width = FreeImage_GetWidth(convertedImage);
+    height = FreeImage_GetHeight(convertedImage);
+
+    float* textureFloatData = new float[static_cast<size_t>(width) * height * 4];
+    for (int y = 0; y < height; ++y) {
+        const FIRGBAF* scanline = reinterpret_cast<const FIRGBAF*>(FreeImage_GetScanLine(convertedImage, y));
+        float* destination = textureFloatData + static_cast<size_t>(y) * width * 4;
+        for (int x = 0; x < width; ++x) {
+            destination[0] = scanline[x].red;
+            destination[1] = scanline[x].green;
+            destination[2] = scanline[x].blue;
+            destination[3] = scanline[x].alpha;
+            destination += 4;
+        }
+    }
+
+    FreeImage_Unload(convertedImage);
+
+    return textureFloatData;
+}
+
+namespace
+{
 // The FreeImage PDF documentation is useful to parse what's going on here.
 // Link to the download: http://sourceforge.net/projects/freeimage/files/Source%20Documentation/3.17.0/FreeImage3170.pdf/download?use_mirror=iweb
 // The PDF is also included in the external/freeimage folder.
 // This function is based off of: http://r3dux.org/2014/10/how-to-load-an-opengl-texture-using-the-freeimage-library-or-freeimageplus-technically/
-std::shared_ptr<Texture2D> LoadTexture(const std::string& filename)
+std::shared_ptr<Texture> DecodeTexture(const std::string& completeFilename, TextureFormat format)
 {
+    // Prefer a preconverted tiled texture in the same format, which is mapped instead of decoded.
+    const std::string tiledFilename = GetTiledFilename(completeFilename);
+    if (FileExists(tiledFilename)) {
+        std::shared_ptr<TiledTexture> mappedTexture = TiledTexture::Open(tiledFilename, TiledTexture::AccessMode::MEMORY_MAPPED);
+        if (mappedTexture && mappedTexture->GetFormat() == format) {
+            return mappedTexture;
+        }
+    }
+
     int width, height;
-    unsigned char* textureRawData = LoadRawData(filename, width, height);
-    std::shared_ptr<Texture2D> newTexture = std::make_shared<Texture2D>(textureRawData, width, height);
+    if (format == TextureFormat::RGBA16F) {
+        float* textureFloatData = LoadFloatDataFromPath(completeFilename, width, height);
+        return std::make_shared<Texture2D>(textureFloatData, width, height, format);
+    }
+    unsigned char* textureRawData = LoadRawDataFromPath(completeFilename, width, height);
+    std::shared_ptr<Texture2D> newTexture = std::make_shared<Texture2D>(textureRawData, width, height, format);
     return newTexture;
 }
 
+std::shared_ptr<Texture> OpenTiledTexture(const std::string& completeFilename, TextureFormat format, TiledTexture::AccessMode mode)
+{
+    const std::string tiledFilename = GetTiledFilename(completeFilename);
+    if (FileExists(tiledFilename)) {
+        std::shared_ptr<TiledTexture> texture = TiledTexture::Open(tiledFilename, mode);
+        if (texture && texture->GetFormat() == format) {
+            return texture;
+        }
+    }
+    if (!ConvertToTiledTexture(completeFilename, tiledFilename, format)) {
+        return nullptr;
+    }
+    return TiledTexture::Open(tiledFilename, mode);
+}
+
+// Tiled textures are registered under their format and access mode, apart from the decoded ones.
+std::string GetTiledOptions(TextureFormat format, TiledTexture::AccessMode mode)
+{
+    return std::string("tiled ") + TextureFormats::GetFormatName(format) + ((mode == TiledTexture::AccessMode::MEMORY_MAPPED) ? " mapped" : " cached");
+}
+}
+
+std::shared_ptr<Texture> LoadTexture(const std::string& filename, TextureFormat format)
+{
+    const std::string completeFilename = GetCompleteFilename(filename);
+    return TextureRegistry::Get()->Acquire(completeFilename, TextureFormats::GetFormatName(format), [completeFilename, format]() {
+        return DecodeTexture(completeFilename, format);
+    });
+}
+
+std::shared_ptr<TiledTexture> LoadTiledTexture(const std::string& filename, TextureFormat format, TiledTexture::AccessMode mode)
+{
+    const std::string completeFilename = GetCompleteFilename(filename);
+    // Only TiledTextures are registered under these options.
+    return std::static_pointer_cast<TiledTexture>(TextureRegistry::Get()->Acquire(completeFilename, GetTiledOptions(format, mode), [completeFilename, format, mode]() {
+        return OpenTiledTexture(completeFilename, format, mode);
+    }));
+}
+
+TextureFuture LoadTextureAsync(const std::string& filename, TextureFormat format)
+{
+    const std::string completeFilename = GetCompleteFilename(filename);
+    return TextureRegistry::Get()->AcquireAsync(completeFilename, TextureFormats::GetFormatName(format), [completeFilename, format]() {
+        return DecodeTexture(completeFilename, format);
+    });
+}
+
+TextureFuture LoadTiledTextureAsync(const std::string& filename, TextureFormat format, TiledTexture::AccessMode mode)
+{
+    const std::string completeFilename = GetCompleteFilename(filename);
+    return TextureRegistry::Get()->AcquireAsync(completeFilename, GetTiledOptions(format, mode), [completeFilename, format, mode]() {
+        return OpenTiledTexture(completeFilename, format, mode);
+    });
+}
+
+std::string GetTiledFilename(const std::string& filename)
+{
+    return filename + ".ttex";
+}
+
+bool ConvertToTiledTexture(const std::string& inputFilename, const std::string& outputFilename, TextureFormat format, uint32_t tileSize)
+{
+    int width, height;
+    if (format == TextureFormat::RGBA16F) {
+        float* textureFloatData = LoadFloatDataFromPath(inputFilename, width, height);
+        if (!textureFloatData) {
+            return false;
+        }
+        const bool written = TiledTextureFile::Write(outputFilename, textureFloatData, width, height, format, tileSize);
+        delete[] textureFloatData;
+        return written;
+    }
+
+    unsigned char* textureRawData = LoadRawDataFromPath(inputFilename, width, height);
+    if (!textureRawData) {
+        return false;
+    }
+    const bool written = TiledTextureFile::Write(outputFilename, textureRawData, width, height, format, tileSize);
+    delete[] textureRawData;
+    return written;
+}
+
 }
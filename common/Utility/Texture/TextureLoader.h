@@ -4,13 +4,41 @@
 #define __TEXTURE_LOADER__
 
 #include "common/common.h"
+#include "common/Utility/Texture/TiledTextureFile.h"
+#include "common/Rendering/Textures/TextureFormat.h"
+#include "common/Rendering/Textures/TiledTexture.h"
+#include <future>
 
-class Texture2D;
+class Texture;
 
 namespace TextureLoader
 {
+typedef std::shared_future<std::shared_ptr<Texture>> TextureFuture;
+
+// Filenames are relative to the asset directory unless noted otherwise.
 unsigned char* LoadRawData(const std::string& filename, int& width, int& height);
-std::shared_ptr<Texture2D> LoadTexture(const std::string& filename);
+unsigned char* LoadRawDataFromPath(const std::string& completeFilename, int& width, int& height);
+// RGBA32F texels, keeps the range of HDR images.
+float* LoadFloatDataFromPath(const std::string& completeFilename, int& width, int& height);
+
+// Maps the preconverted tiled texture (see texconvert) if there is one in the given format, otherwise decodes the image
+// into a Texture2D stored in that format. Textures are shared through the TextureRegistry, so asking for the same file
+// and format again returns the same texture.
+std::shared_ptr<Texture> LoadTexture(const std::string& filename, TextureFormat format = TextureFormat::RGBA8);
+
+// Opens the tiled version of the texture, stored in the given format, for demand paging through the TextureCache or
+// mapped into memory. If it does not exist yet or is stored in another format, the image is decoded once and
+// converted, so later runs start without decoding it.
+std::shared_ptr<TiledTexture> LoadTiledTexture(const std::string& filename, TextureFormat format = TextureFormat::RGBA8, TiledTexture::AccessMode mode = TiledTexture::AccessMode::CACHED);
+
+// Same as above, but decoded on the shared ThreadPool so that loading overlaps with mesh loading and acceleration
+// structure builds. Materials take the future directly and resolve it when the scene is finalized.
+TextureFuture LoadTextureAsync(const std::string& filename, TextureFormat format = TextureFormat::RGBA8);
+TextureFuture LoadTiledTextureAsync(const std::string& filename, TextureFormat format = TextureFormat::RGBA8, TiledTexture::AccessMode mode = TiledTexture::AccessMode::CACHED);
+
+std::string GetTiledFilename(const std::string& filename);
+// Decodes an image at the given path and writes it as a tiled texture stored in the given format.
+bool ConvertToTiledTexture(const std::string& inputFilename, const std::string& outputFilename, TextureFormat format = TextureFormat::RGBA8, uint32_t tileSize = TiledTextureFile::DEFAULT_TILE_SIZE);
 
 }
 #endif
@@ -0,0 +1,125 @@
+#include "common/Utility/Texture/TextureRegistry.h"
+#include "common/Rendering/Textures/Texture.h"
+#include "common/Utility/Threading/ThreadPool.h"
+#include <climits>
+#include <cstdlib>
+
+TextureRegistry::TextureRegistry():
+    hits(0), misses(0)
+{
+}
+
+TextureRegistry* TextureRegistry::Get()
+{
+    static TextureRegistry registry;
+    return &registry;
+}
+
+std::string TextureRegistry::GetCanonicalPath(const std::string& filename)
+{
+    // Resolves relative components and links so that different spellings of a path share an entry. Files that do
+    // not exist keep their name and simply fail to load once.
+#ifdef _WIN32
+    char resolved[_MAX_PATH];
+    if (_fullpath(resolved, filename.c_str(), _MAX_PATH)) {
+        return resolved;
+    }
+#else
+    char resolved[PATH_MAX];
+    if (realpath(filename.c_str(), resolved)) {
+        return resolved;
+    }
+#endif
+    return filename;
+}
+
+std::string TextureRegistry::MakeKey(const std::string& completeFilename, const std::string& options)
+{
+    return GetCanonicalPath(completeFilename) + "|" + options;
+}
+
+std::shared_ptr<Texture> TextureRegistry::Acquire(const std::string& completeFilename, const std::string& options, const LoadFunction& load)
+{
+    const std::string key = MakeKey(completeFilename, options);
+    std::promise<std::shared_ptr<Texture>> promise;
+    TextureFuture existingTexture;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto existing = entries.find(key);
+        if (existing != entries.end()) {
+            ++hits;
+            existingTexture = existing->second;
+        } else {
+            ++misses;
+            entries.emplace(key, promise.get_future().share());
+        }
+    }
+    if (existingTexture.valid()) {
+        return existingTexture.get();
+    }
+
+    // Load outside the lock; other requests for this key wait on the promise.
+    try {
+        std::shared_ptr<Texture> texture = load();
+        promise.set_value(texture);
+        return texture;
+    } catch (...) {
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+}
+
+TextureRegistry::TextureFuture TextureRegistry::AcquireAsync(const std::string& completeFilename, const std::string& options, const LoadFunction& load)
+{
+    const std::string key = MakeKey(completeFilename, options);
+    std::lock_guard<std::mutex> lock(mutex);
+    auto existing = entries.find(key);
+    if (existing != entries.end()) {
+        ++hits;
+        return existing->second;
+    }
+    ++misses;
+    TextureFuture texture = ThreadPool::Get().Submit(load).share();
+    entries.emplace(key, texture);
+    return texture;
+}
+
+void TextureRegistry::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+}
+
+void TextureRegistry::PrintStatistics() const
+{
+    const uint64_t totalRequests = hits + misses;
+    if (!totalRequests) {
+        return;
+    }
+
+    size_t residentBytes = 0;
+    size_t loadedTextures = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& entry : entries) {
+            // Textures that are still decoding are not counted.
+            if (entry.second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                continue;
+            }
+            try {
+                std::shared_ptr<Texture> texture = entry.second.get();
+                if (texture) {
+                    residentBytes += texture->GetMemoryBytes();
+                    ++loadedTextures;
+                }
+            } catch (...) {
+            }
+        }
+    }
+
+    std::cout << "======== TEXTURE REGISTRY ========" << std::endl;
+    std::cout << "Requests: " << totalRequests << std::endl;
+    std::cout << "Hits: " << hits << " (" << 100.0 * hits / totalRequests << "%)" << std::endl;
+    std::cout << "Loaded Textures: " << loadedTextures << std::endl;
+    std::cout << "Resident: " << residentBytes / (1024.0 * 1024.0) << " MB" << std::endl;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "common/common.h"
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <unordered_map>
+
+class Texture;
+
+// Process-wide registry of loaded textures, keyed by canonical path and load options, so that every material that
+// references the same image shares one decoded copy. Entries are futures: a request that arrives while the same
+// texture is still being decoded waits for that decode instead of starting another one.
+class TextureRegistry
+{
+public:
+    typedef std::shared_future<std::shared_ptr<Texture>> TextureFuture;
+    typedef std::function<std::shared_ptr<Texture>()> LoadFunction;
+
+    TextureRegistry();
+
+    static TextureRegistry* Get();
+
+    // Returns the registered texture or runs load on the calling thread.
+    std::shared_ptr<Texture> Acquire(const std::string& completeFilename, const std::string& options, const LoadFunction& load);
+    // Returns the registered texture or queues load on the ThreadPool.
+    TextureFuture AcquireAsync(const std::string& completeFilename, const std::string& options, const LoadFunction& load);
+
+    // Drops the registry's references. Textures still used by materials stay alive.
+    void Clear();
+
+    void PrintStatistics() const;
+private:
+    static std::string MakeKey(const std::string& completeFilename, const std::string& options);
+    static std::string GetCanonicalPath(const std::string& filename);
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, TextureFuture> entries;
+
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+};
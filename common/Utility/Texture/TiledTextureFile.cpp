@@ -0,0 +1,147 @@
+#include "common/Utility/Texture/TiledTextureFile.h"
+#include "common/Rendering/Textures/Texture2D.h"
+#include <cstdio>
+#include <fstream>
+
+namespace TiledTextureFile
+{
+
+namespace
+{
+uint64_t AlignOffset(uint64_t offset)
+{
+    return (offset + PAGE_ALIGNMENT - 1) / PAGE_ALIGNMENT * PAGE_ALIGNMENT;
+}
+
+// Encodes the tiles of one level from RGBA8 or RGBA32F texels.
+template<typename T>
+void WriteLevelTiles(std::ostream& output, const Header& header, const LevelInfo& level, const T* rgbaData)
+{
+    const uint32_t tileSize = header.tileSize;
+    std::vector<T> tile(static_cast<size_t>(tileSize) * tileSize * 4);
+    std::vector<unsigned char> encodedTile(GetTileBytes(header));
+    for (uint32_t tileY = 0; tileY < level.tilesY; ++tileY) {
+        for (uint32_t tileX = 0; tileX < level.tilesX; ++tileX) {
+            const uint32_t startX = tileX * tileSize;
+            const uint32_t startY = tileY * tileSize;
+            for (uint32_t y = 0; y < tileSize; ++y) {
+                const uint32_t sourceY = std::min(startY + y, level.height - 1);
+                for (uint32_t x = 0; x < tileSize; ++x) {
+                    const uint32_t sourceX = std::min(startX + x, level.width - 1);
+                    const T* source = rgbaData + (sourceY * static_cast<uint64_t>(level.width) + sourceX) * 4;
+                    std::copy(source, source + 4, tile.begin() + (static_cast<size_t>(y) * tileSize + x) * 4);
+                }
+            }
+            TextureFormats::EncodeLevel(GetFormat(header), tile.data(), static_cast<int>(tileSize), static_cast<int>(tileSize), encodedTile.data());
+            output.write(reinterpret_cast<const char*>(encodedTile.data()), encodedTile.size());
+        }
+    }
+}
+
+template<typename T>
+bool WriteFile(const std::string& filename, const T* rgbaData, int width, int height, TextureFormat format, uint32_t tileSize)
+{
+    PROFILE_ZONE(zone, "Write Tiled Texture " + filename);
+    assert(rgbaData && width > 0 && height > 0 && tileSize > 0);
+    if (format == TextureFormat::BC1 && tileSize % 4 != 0) {
+        std::cerr << "ERROR: BC1 tiled textures need a tile size that is a multiple of 4." << std::endl;
+        return false;
+    }
+
+    Header header = { MAGIC, VERSION, static_cast<uint32_t>(width), static_cast<uint32_t>(height), tileSize, 0, static_cast<uint32_t>(format) };
+    std::vector<LevelInfo> levels;
+    for (glm::ivec2 size(width, height);; size = Texture2D::GetNextMipSize(size)) {
+        const LevelInfo level = { static_cast<uint32_t>(size.x), static_cast<uint32_t>(size.y), (size.x + tileSize - 1) / tileSize, (size.y + tileSize - 1) / tileSize, 0 };
+        levels.push_back(level);
+        if (size.x == 1 && size.y == 1) {
+            break;
+        }
+    }
+    header.levelCount = static_cast<uint32_t>(levels.size());
+
+    uint64_t offset = AlignOffset(sizeof(Header) + levels.size() * sizeof(LevelInfo));
+    for (size_t i = 0; i < levels.size(); ++i) {
+        levels[i].offset = offset;
+        offset = AlignOffset(offset + static_cast<uint64_t>(levels[i].tilesX) * levels[i].tilesY * GetTileBytes(header));
+    }
+
+    const std::string temporaryFilename = filename + ".partial";
+    {
+        std::ofstream output(temporaryFilename, std::ios::binary);
+        if (!output) {
+            std::cerr << "ERROR: Failed to open " << temporaryFilename << " for writing." << std::endl;
+            return false;
+        }
+        output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        output.write(reinterpret_cast<const char*>(levels.data()), levels.size() * sizeof(LevelInfo));
+
+        // Only the current and the next level are kept in memory.
+        std::vector<T> currentLevel;
+        std::vector<T> nextLevel;
+        const T* levelData = rgbaData;
+        for (size_t i = 0; i < levels.size(); ++i) {
+            output.seekp(levels[i].offset);
+            WriteLevelTiles(output, header, levels[i], levelData);
+            if (i + 1 < levels.size()) {
+                nextLevel.resize(static_cast<size_t>(levels[i + 1].width) * levels[i + 1].height * 4);
+                Texture2D::DownsampleLevel(levelData, glm::ivec2(levels[i].width, levels[i].height), nextLevel.data());
+                currentLevel.swap(nextLevel);
+                levelData = currentLevel.data();
+            }
+        }
+
+        // Pad the last level so that every tile can be mapped as whole pages.
+        if (static_cast<uint64_t>(output.tellp()) < offset) {
+            output.seekp(offset - 1);
+            output.put(0);
+        }
+
+        if (!output) {
+            std::cerr << "ERROR: Failed to write " << temporaryFilename << std::endl;
+            output.close();
+            std::remove(temporaryFilename.c_str());
+            return false;
+        }
+    }
+
+    // Removing first lets the rename replace the file on Windows too. Mappings of the old file stay valid.
+    std::remove(filename.c_str());
+    if (std::rename(temporaryFilename.c_str(), filename.c_str()) != 0) {
+        std::cerr << "ERROR: Failed to rename " << temporaryFilename << " to " << filename << std::endl;
+        std::remove(temporaryFilename.c_str());
+        return false;
+    }
+    return true;
+}
+}
+
+bool Write(const std::string& filename, const unsigned char* rgbaData, int width, int height, TextureFormat format, uint32_t tileSize)
+{
+    return WriteFile(filename, rgbaData, width, height, format, tileSize);
+}
+
+bool Write(const std::string& filename, const float* rgbaData, int width, int height, TextureFormat format, uint32_t tileSize)
+{
+    return WriteFile(filename, rgbaData, width, height, format, tileSize);
+}
+
+bool ReadHeader(std::istream& input, Header& header, std::vector<LevelInfo>& levels)
+{
+    if (!input.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != MAGIC) {
+        std::cerr << "ERROR: Not a tiled texture file." << std::endl;
+        return false;
+    }
+    if (header.version != VERSION || header.tileSize == 0 || header.levelCount == 0 || header.levelCount > 32 ||
+        header.format > static_cast<uint32_t>(TextureFormat::BC1) || (GetFormat(header) == TextureFormat::BC1 && header.tileSize % 4 != 0)) {
+        std::cerr << "ERROR: Unsupported tiled texture file (version " << header.version << ")." << std::endl;
+        return false;
+    }
+    levels.resize(header.levelCount);
+    if (!input.read(reinterpret_cast<char*>(levels.data()), levels.size() * sizeof(LevelInfo))) {
+        std::cerr << "ERROR: Truncated tiled texture file." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#ifndef __TILED_TEXTURE_FILE__
+#define __TILED_TEXTURE_FILE__
+
+#include "common/common.h"
+#include "common/Rendering/Textures/TextureFormat.h"
+
+// On-disk container for textures that are paged in tile by tile (.ttex).
+//
+// The file starts with a Header followed by one LevelInfo per mip level. The tiles of each level follow in row-major
+// order, each level starting on a PAGE_ALIGNMENT boundary. Every tile is tileSize x tileSize texels encoded in the
+// header's format, laid out as a Texture2D level of that size; tiles on the right and bottom edges repeat the last
+// column and row so that all tiles have the same size. All values are little-endian.
+namespace TiledTextureFile
+{
+
+const uint32_t MAGIC = 0x58455454; // "TTEX"
+const uint32_t VERSION = 2;
+const uint32_t DEFAULT_TILE_SIZE = 64;
+const uint64_t PAGE_ALIGNMENT = 4096;
+
+struct Header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t tileSize;
+    uint32_t levelCount;
+    // A TextureFormat. Block-compressed formats need a tile size that is a multiple of the block size.
+    uint32_t format;
+};
+
+struct LevelInfo
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t tilesX;
+    uint32_t tilesY;
+    uint64_t offset;
+};
+
+inline TextureFormat GetFormat(const Header& header)
+{
+    return static_cast<TextureFormat>(header.format);
+}
+
+inline uint64_t GetTileBytes(const Header& header)
+{
+    return TextureFormats::GetLevelBytes(GetFormat(header), static_cast<int>(header.tileSize), static_cast<int>(header.tileSize));
+}
+
+inline uint64_t GetTileOffset(const Header& header, const LevelInfo& level, uint32_t tileX, uint32_t tileY)
+{
+    return level.offset + (static_cast<uint64_t>(tileY) * level.tilesX + tileX) * GetTileBytes(header);
+}
+
+// Writes the full mip chain of an RGBA8 or RGBA32F image, stored in the given format. The file is written under a
+// temporary name and then renamed, so that textures still mapping an older version keep theirs. Returns false if the
+// file could not be written.
+bool Write(const std::string& filename, const unsigned char* rgbaData, int width, int height, TextureFormat format = TextureFormat::RGBA8, uint32_t tileSize = DEFAULT_TILE_SIZE);
+bool Write(const std::string& filename, const float* rgbaData, int width, int height, TextureFormat format = TextureFormat::RGBA16F, uint32_t tileSize = DEFAULT_TILE_SIZE);
+
+// Reads and validates the header and level table.
+bool ReadHeader(std::istream& input, Header& header, std::vector<LevelInfo>& levels);
+
+}
+
+#endif
@@ -0,0 +1,45 @@
+#include "common/Utility/Threading/ThreadPool.h"
+
+ThreadPool& ThreadPool::Get()
+{
+    static ThreadPool pool(std::max(1, static_cast<int>(std::thread::hardware_concurrency())));
+    return pool;
+}
+
+ThreadPool::ThreadPool(int threadCount):
+    stopping(false)
+{
+    for (int i = 0; i < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueCondition.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::WorkerLoop()
+{
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCondition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            // Queued work is still finished on shutdown so that no future is left without a value.
+            if (tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "common/common.h"
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+
+// Fixed set of worker threads for background work such as decoding assets while the scene is being built.
+class ThreadPool
+{
+public:
+    // Shared pool with one worker per hardware thread.
+    static ThreadPool& Get();
+
+    explicit ThreadPool(int threadCount);
+    ~ThreadPool();
+
+    // Queues the task and returns a future for its result. Exceptions thrown by the task are rethrown from get().
+    template<typename Function>
+    std::future<typename std::result_of<Function()>::type> Submit(Function task)
+    {
+        typedef typename std::result_of<Function()>::type ResultType;
+        // std::function needs a copyable target, so the packaged_task is shared.
+        std::shared_ptr<std::packaged_task<ResultType()>> packagedTask = std::make_shared<std::packaged_task<ResultType()>>(std::bind(&ThreadPool::RunTask<Function>, std::move(task)));
+        std::future<ResultType> result = packagedTask->get_future();
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            tasks.emplace_back([packagedTask]() { (*packagedTask)(); });
+        }
+        queueCondition.notify_one();
+        return result;
+    }
+
+    int GetThreadCount() const { return static_cast<int>(workers.size()); }
+
+private:
+    struct ScopedDiagnosticsFlush
+    {
+        ~ScopedDiagnosticsFlush() { DIAGNOSTICS_FLUSH_THREAD(); }
+    };
+
+    // Workers live as long as the pool, so the diagnostics a task gathers are merged into the totals when it ends,
+    // before its future becomes ready, like the render threads do when they finish.
+    template<typename Function>
+    static typename std::result_of<Function()>::type RunTask(Function& task)
+    {
+        ScopedDiagnosticsFlush flush;
+        return task();
+    }
+
+    void WorkerLoop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    bool stopping;
+};
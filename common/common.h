@@ -22,6 +22,7 @@
 
 #include "common/Utility/Timer/Timer.h"
 #include "common/Utility/Diagnostics/Diagnostics.h"
+#include "common/Utility/Profiler/Profiler.h"
 
 const float PI = 3.14159265359f;
 const float LARGE_EPSILON = 1e-2f;
@@ -1,4 +1,12 @@
 #include "common/RayTracer.h"
+#include "common/Output/ImageWriter.h"
+#include "common/Output/ToneMapping/ToneMapper.h"
+#include "common/Sampling/ColorSampler.h"
+#include "common/Scene/Scene.h"
+#include "common/Utility/Scene/Generation/SceneGenerator.h"
+#include "common/Utility/Texture/TextureCache.h"
+#include "common/Utility/Texture/TextureRegistry.h"
+#include <cstring>
 
 #ifdef _WIN32
 #define WAIT_ON_EXIT 1
@@ -9,12 +17,129 @@
 int main(int argc, char** argv)  
 {
     RayTracer rayTracer;
+    std::string traceFilename;
+    bool usePerformanceCounters = false;
+    bool generateScene = false;
+    SceneGenerator::Settings generatorSettings;
+    std::shared_ptr<ToneMapper> toneMapper;
+    float exposure = 0.f;
+    ImageAOV aov;
+    bool progressive = false;
+    float timeBudget = 0.f;
+    float targetChange = 0.f;
+    std::shared_ptr<ColorSampler> sampler;
+    int samplesPerPixel = 16;
+    size_t photonCount = 0;
+    int gatherPhotons = 0;
+    float gatherRadius = 0.f;
+    int finalGatherRays = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            rayTracer.SetThreadCount(atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--cloud-tolerance") && i + 1 < argc) {
+            rayTracer.SetCloudTolerance(static_cast<float>(atof(argv[++i])));
+        } else if (!strcmp(argv[i], "--tone-map") && i + 1 < argc && (toneMapper = ToneMapper::Create(argv[i + 1]))) {
+            ++i;
+        } else if (!strcmp(argv[i], "--exposure") && i + 1 < argc) {
+            exposure = static_cast<float>(atof(argv[++i]));
+        } else if (!strcmp(argv[i], "--srgb")) {
+            rayTracer.SetSRGBOutput(true);
+        } else if (!strcmp(argv[i], "--stream")) {
+            rayTracer.SetStreamingOutput(true);
+        } else if (!strcmp(argv[i], "--sampler") && i + 1 < argc && (sampler = ColorSampler::Create(argv[i + 1]))) {
+            ++i;
+        } else if (!strcmp(argv[i], "--samples") && i + 1 < argc) {
+            samplesPerPixel = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--progressive")) {
+            progressive = true;
+        } else if (!strcmp(argv[i], "--time-budget") && i + 1 < argc) {
+            timeBudget = static_cast<float>(atof(argv[++i]));
+        } else if (!strcmp(argv[i], "--target-change") && i + 1 < argc) {
+            targetChange = static_cast<float>(atof(argv[++i]));
+        } else if (!strcmp(argv[i], "--photons") && i + 1 < argc) {
+            photonCount = strtoull(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--gather") && i + 1 < argc) {
+            gatherPhotons = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--gather-radius") && i + 1 < argc) {
+            gatherRadius = static_cast<float>(atof(argv[++i]));
+        } else if (!strcmp(argv[i], "--final-gather") && i + 1 < argc) {
+            finalGatherRays = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--checkpoint")) {
+            rayTracer.SetCheckpointing(true, false);
+        } else if (!strcmp(argv[i], "--resume")) {
+            rayTracer.SetCheckpointing(true, true);
+        } else if (!strcmp(argv[i], "--output") && i + 1 < argc) {
+            rayTracer.SetOutputFilename(argv[++i]);
+        } else if (!strcmp(argv[i], "--aov") && i + 1 < argc && ImageWriter::ParseAOV(argv[i + 1], aov)) {
+            rayTracer.EnableAOV(aov);
+            ++i;
+        } else if (!strcmp(argv[i], "--trace") && i + 1 < argc) {
+            traceFilename = argv[++i];
+        } else if (!strcmp(argv[i], "--perf-counters")) {
+            usePerformanceCounters = true;
+        } else if (!strcmp(argv[i], "--generate") && i + 1 < argc && SceneGenerator::ParseDistribution(argv[i + 1], generatorSettings.distribution)) {
+            generateScene = true;
+            ++i;
+        } else if (!strcmp(argv[i], "--triangles") && i + 1 < argc) {
+            generatorSettings.totalTriangles = strtoull(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--texture-budget") && i + 1 < argc) {
+            TextureCache::Get()->SetMemoryBudget(static_cast<size_t>(atoi(argv[++i])) << 20);
+        } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            generatorSettings.seed = static_cast<unsigned int>(atoi(argv[++i]));
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--threads N] [--cloud-tolerance T] [--tone-map exposure|reinhard|filmic] [--exposure EV] [--srgb] [--stream] [--checkpoint | --resume]"
+                << " [--sampler jitter|adaptive [--samples N]] [--progressive [--time-budget S] [--target-change T]]"
+                << " [--photons N [--gather K] [--gather-radius R] [--final-gather RAYS]]"
+                << " [--output image.png|.pfm|.exr] [--aov depth|normal|albedo]..."
+                << " [--trace trace.json] [--perf-counters] [--texture-budget MB]"
+                << " [--generate clutter|truss|instanced [--triangles N] [--seed S]]" << std::endl;
+            return 1;
+        }
+    }
+
+    // An exposure alone only scales.
+    if (!toneMapper && exposure != 0.f) {
+        toneMapper = ToneMapper::Create("exposure");
+    }
+    if (toneMapper) {
+        toneMapper->SetExposure(exposure);
+        rayTracer.SetToneMapper(toneMapper);
+    }
+    rayTracer.SetProgressive(progressive, timeBudget, targetChange);
+    if (sampler) {
+        rayTracer.SetSampler(sampler, samplesPerPixel);
+    }
+    rayTracer.SetPhotonMapping(photonCount, gatherPhotons, gatherRadius, finalGatherRays);
+
+#if PROFILER_ON
+    Profiler::Get()->Enable(!traceFilename.empty());
+#endif
+#if DIAGNOSTICS_ON
+    if (usePerformanceCounters) {
+        Diagnostics::Get()->EnablePhases(true);
+    }
+#endif
 
     DIAGNOSTICS_TIMER(timer, "Ray Tracer");
+    if (generateScene) {
+        std::shared_ptr<Scene> scene = SceneGenerator::GenerateScene(generatorSettings);
+        scene->Finalize();
+        rayTracer.SetScene(scene, SceneGenerator::GetSceneDescription(generatorSettings));
+    }
     rayTracer.Run();
     DIAGNOSTICS_END_TIMER(timer);
 
     DIAGNOSTICS_PRINT();
+    TextureCache::Get()->PrintStatistics();
+    TextureRegistry::Get()->PrintStatistics();
+
+#if PROFILER_ON
+    if (!traceFilename.empty()) {
+        Profiler::Get()->PrintSummary();
+        Profiler::Get()->WriteChromeTrace(traceFilename);
+    }
+#endif
 
 #if defined(_WIN32) && WAIT_ON_EXIT
     int exit = 0;
@@ -0,0 +1,81 @@
+#include "common/Rendering/Textures/Texture2D.h"
+#include "common/Rendering/Textures/TiledTexture.h"
+#include "common/Utility/Texture/TiledTextureFile.h"
+#include <cstdio>
+
+// Every mip level of a texture whose value grows linearly with u and v has to sample the same value at the same
+// coordinate, as long as the lookup stays away from the repeating border. A level that is shifted against the one
+// above it shows up as an offset that grows down the chain.
+namespace
+{
+const float TOLERANCE = 2e-3f;
+
+// Odd sizes along the chain exercise the filter footprints that are not 2x2.
+const int WIDTH = 320;
+const int HEIGHT = 200;
+
+float* CreateGradient()
+{
+    float* data = new float[static_cast<size_t>(WIDTH) * HEIGHT * 4];
+    for (int y = 0; y < HEIGHT; ++y) {
+        for (int x = 0; x < WIDTH; ++x) {
+            float* texel = data + (static_cast<size_t>(y) * WIDTH + x) * 4;
+            texel[0] = (x + 0.5f) / WIDTH;
+            texel[1] = (y + 0.5f) / HEIGHT;
+            texel[2] = 0.5f;
+            texel[3] = 1.f;
+        }
+    }
+    return data;
+}
+
+template<typename T>
+int CheckLevels(const char* name, const T& texture)
+{
+    int failures = 0;
+    for (int level = 0; level < texture.GetTotalMipLevels(); ++level) {
+        const glm::ivec2 size = glm::ivec2(WIDTH, HEIGHT) / (1 << level);
+        // Bilinear lookups need a texel on both sides, so only levels with a few texels left are checked.
+        if (size.x < 4 || size.y < 4) {
+            break;
+        }
+        float maxError = 0.f;
+        for (int i = 0; i <= 16; ++i) {
+            for (int j = 0; j <= 16; ++j) {
+                const glm::vec2 coord = glm::vec2(0.3f) + glm::vec2(i, j) * (0.4f / 16.f);
+                const glm::vec4 value = texture.SampleLevel(coord, static_cast<float>(level));
+                maxError = std::max(maxError, std::max(std::abs(value.r - coord.x), std::abs(value.g - coord.y)));
+            }
+        }
+        if (maxError > TOLERANCE) {
+            std::printf("FAILED: %s level %d is off the gradient by up to %g\n", name, level, maxError);
+            ++failures;
+        }
+    }
+    return failures;
+}
+}
+
+int main()
+{
+    int failures = CheckLevels("Texture2D", Texture2D(CreateGradient(), WIDTH, HEIGHT, TextureFormat::RGBA16F));
+
+    const std::string filename = "TextureMipTest.ttex";
+    float* data = CreateGradient();
+    const bool written = TiledTextureFile::Write(filename, data, WIDTH, HEIGHT, TextureFormat::RGBA16F);
+    delete[] data;
+    std::shared_ptr<TiledTexture> tiledTexture = written ? TiledTexture::Open(filename, TiledTexture::AccessMode::MEMORY_MAPPED) : nullptr;
+    if (tiledTexture) {
+        failures += CheckLevels("TiledTexture", *tiledTexture);
+    } else {
+        std::printf("FAILED: could not write and open %s\n", filename.c_str());
+        ++failures;
+    }
+    tiledTexture.reset();
+    std::remove(filename.c_str());
+
+    if (!failures) {
+        std::printf("All mip levels line up\n");
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,50 @@
+#include "common/Utility/Texture/TextureLoader.h"
+#include "common/Utility/Texture/TiledTextureFile.h"
+#include <chrono>
+#include <cstring>
+
+// Converts images into tiled textures (.ttex) ahead of time. TextureLoader maps a converted texture instead of
+// decoding the image, so that startup does not wait on image decoding.
+int main(int argc, char** argv)
+{
+    uint32_t tileSize = TiledTextureFile::DEFAULT_TILE_SIZE;
+    TextureFormat format = TextureFormat::RGBA8;
+    std::string outputFilename;
+    std::vector<std::string> inputFilenames;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--tile-size") && i + 1 < argc) {
+            tileSize = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--format") && i + 1 < argc && TextureFormats::ParseFormat(argv[i + 1], format)) {
+            ++i;
+        } else if (!strcmp(argv[i], "--output") && i + 1 < argc) {
+            outputFilename = argv[++i];
+        } else if (argv[i][0] != '-') {
+            inputFilenames.push_back(argv[i]);
+        } else {
+            inputFilenames.clear();
+            break;
+        }
+    }
+
+    if (inputFilenames.empty() || tileSize == 0 || (!outputFilename.empty() && inputFilenames.size() > 1)) {
+        std::cerr << "Usage: " << argv[0] << " [--tile-size N] [--format R8|RG8|RGB8|RGBA8|RGBA16F|BC1] [--output file.ttex] image..." << std::endl;
+        std::cerr << "Each image is written next to itself as <image>.ttex unless --output is given for a single image." << std::endl;
+        std::cerr << "Textures are only mapped when loaded in the format they were converted to, RGBA8 by default." << std::endl;
+        return 1;
+    }
+
+    int failures = 0;
+    for (size_t i = 0; i < inputFilenames.size(); ++i) {
+        const std::string output = outputFilename.empty() ? TextureLoader::GetTiledFilename(inputFilenames[i]) : outputFilename;
+        const auto startTime = std::chrono::high_resolution_clock::now();
+        if (TextureLoader::ConvertToTiledTexture(inputFilenames[i], output, format, tileSize)) {
+            const std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+            std::cout << inputFilenames[i] << " -> " << output << " (" << elapsed.count() << "s)" << std::endl;
+        } else {
+            std::cerr << "ERROR: Failed to convert " << inputFilenames[i] << std::endl;
+            ++failures;
+        }
+    }
+    return failures ? 1 : 0;
+}